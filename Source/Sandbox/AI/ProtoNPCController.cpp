@@ -0,0 +1,136 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProtoNPCController.h"
+#include "NavigationSystem.h"
+#include "Navigation/PathFollowingComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "SandboxUtilitySubsystem.h"
+#include "Sandbox/Characters/ProtoCharacter/ProtoCharacter.h"
+#include "Sandbox/GAS/ProtoAttributeSet.h"
+
+
+#pragma region Constructors
+AProtoNPCController::AProtoNPCController()
+{
+	// The npcs aren't players, and the decisions come from the utility subsystem
+	bWantsPlayerState = false;
+	Noise.GenerateNewSeed();
+}
+
+
+void AProtoNPCController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	CurrentAction = INDEX_NONE;
+	if (USandboxUtilitySubsystem* UtilityAI = GetWorld()->GetSubsystem<USandboxUtilitySubsystem>()) UtilityAI->RegisterNPC(this);
+}
+
+
+void AProtoNPCController::OnUnPossess()
+{
+	if (USandboxUtilitySubsystem* UtilityAI = GetWorld()->GetSubsystem<USandboxUtilitySubsystem>()) UtilityAI->UnregisterNPC(this);
+	Super::OnUnPossess();
+}
+
+
+void AProtoNPCController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USandboxUtilitySubsystem* UtilityAI = GetWorld()->GetSubsystem<USandboxUtilitySubsystem>()) UtilityAI->UnregisterNPC(this);
+	Super::EndPlay(EndPlayReason);
+}
+#pragma endregion
+
+
+#pragma region Utility AI
+void AProtoNPCController::GatherInputs(FProtoUtilityBatch& Batch, int32 Row, const UProtoUtilityProfile& InProfile, const TArray<FVector>& PlayerLocations, double Now)
+{
+	const ACharacter* Character = GetCharacter();
+	const FVector Location = Character ? Character->GetActorLocation() : FVector::ZeroVector;
+
+	// Health, full if there's no attribute set (or it was never initialized)
+	float Health = 1.f;
+	const AProtoCharacter* ProtoCharacter = Cast<AProtoCharacter>(Character);
+	if (ProtoCharacter && ProtoCharacter->Attributes && ProtoCharacter->AreAttributesInitialized() && InProfile.MaxHealth > 0.f)
+	{
+		Health = ProtoCharacter->Attributes->Health.GetCurrentValue() / InProfile.MaxHealth;
+	}
+
+	// The closest player
+	float ClosestDistanceSquared = FMath::Square(InProfile.SenseRadius);
+	bHasTarget = false;
+	for (const FVector& PlayerLocation : PlayerLocations)
+	{
+		const float DistanceSquared = FVector::DistSquared(PlayerLocation, Location);
+		if (DistanceSquared < ClosestDistanceSquared)
+		{
+			ClosestDistanceSquared = DistanceSquared;
+			TargetLocation = PlayerLocation;
+			bHasTarget = true;
+		}
+	}
+
+	const UCharacterMovementComponent* Movement = Character ? Character->GetCharacterMovement() : nullptr;
+	const float MaxSpeed = Movement ? Movement->GetMaxSpeed() : 0.f;
+
+	Batch.GetInput(EProtoUtilityInput::Health)[Row] = FMath::Clamp(Health, 0.f, 1.f);
+	Batch.GetInput(EProtoUtilityInput::TargetDistance)[Row] = bHasTarget && InProfile.SenseRadius > 0.f ? FMath::Sqrt(ClosestDistanceSquared) / InProfile.SenseRadius : 1.f;
+	Batch.GetInput(EProtoUtilityInput::Speed)[Row] = MaxSpeed > 0.f && Character ? FMath::Clamp(Character->GetVelocity().Size() / MaxSpeed, 0.f, 1.f) : 0.f;
+	Batch.GetInput(EProtoUtilityInput::ActionTime)[Row] = InProfile.ActionTimeScale > 0.f ? FMath::Clamp(static_cast<float>(Now - ActionStartTime) / InProfile.ActionTimeScale, 0.f, 1.f) : 0.f;
+	Batch.GetInput(EProtoUtilityInput::Noise)[Row] = Noise.FRand();
+	Batch.CurrentActions[Row] = CurrentAction;
+}
+
+
+void AProtoNPCController::SetAction(const UProtoUtilityProfile& InProfile, int32 ActionIndex, double Now)
+{
+	if (!InProfile.Actions.IsValidIndex(ActionIndex)) return;
+
+	const bool bChanged = ActionIndex != CurrentAction;
+	if (bChanged)
+	{
+		CurrentAction = ActionIndex;
+		ActionStartTime = Now;
+	}
+	RunBehavior(InProfile.Actions[ActionIndex].Behavior, bChanged);
+}
+
+
+void AProtoNPCController::RunBehavior(EProtoUtilityBehavior Behavior, bool bChanged)
+{
+	const APawn* ControlledPawn = GetPawn();
+	if (!ControlledPawn) return;
+
+	// Keep going with the move we have unless the action changed, the chase is the only one that follows its target around
+	const bool bMoving = GetMoveStatus() != EPathFollowingStatus::Idle;
+	switch (Behavior)
+	{
+	case EProtoUtilityBehavior::Idle:
+		if (bChanged) StopMovement();
+		break;
+	case EProtoUtilityBehavior::Wander:
+		if (bChanged || !bMoving)
+		{
+			const UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+			FNavLocation Destination;
+			if (NavSystem && NavSystem->GetRandomReachablePointInRadius(ControlledPawn->GetActorLocation(), WanderRadius, Destination)) MoveToLocation(Destination.Location, AcceptanceRadius);
+		}
+		break;
+	case EProtoUtilityBehavior::Chase:
+		if (bHasTarget) MoveToLocation(TargetLocation, AcceptanceRadius);
+		else if (bChanged) StopMovement();
+		break;
+	case EProtoUtilityBehavior::Flee:
+		if (bHasTarget && (bChanged || !bMoving))
+		{
+			const FVector Away = (ControlledPawn->GetActorLocation() - TargetLocation).GetSafeNormal2D();
+			MoveToLocation(ControlledPawn->GetActorLocation() + Away * FleeDistance, AcceptanceRadius);
+		}
+		break;
+	default:
+		break;
+	}
+}
+#pragma endregion
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "ProtoUtilityAI.h"
+#include "ProtoNPCController.generated.h"
+
+
+/**
+ * Runs a proto character npc with the utility ai (see ProtoUtilityAI.h)
+ * The utility subsystem decides which action the npc does, this gathers the npc's inputs for it and carries out the behavior of whatever it picks
+ */
+UCLASS()
+class SANDBOX_API AProtoNPCController : public AAIController
+{
+	GENERATED_BODY()
+
+
+public:
+	AProtoNPCController();
+
+	/** Fills the npc's row of the batch, PlayerLocations are the pawns of every player */
+	void GatherInputs(FProtoUtilityBatch& Batch, int32 Row, const UProtoUtilityProfile& Profile, const TArray<FVector>& PlayerLocations, double Now);
+
+	/** Switches to an action of the profile (or refreshes the current one), called after every decision */
+	void SetAction(const UProtoUtilityProfile& Profile, int32 ActionIndex, double Now);
+
+	UProtoUtilityProfile* GetProfile() const { return Profile; }
+	int32 GetCurrentAction() const { return CurrentAction; }
+
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, Category = "Utility AI") // The actions to pick from, the subsystem's default profile if this is empty
+		UProtoUtilityProfile* Profile;
+	UPROPERTY(EditAnywhere, Category = "Utility AI") // How far the wander destinations can be
+		float WanderRadius = 2000.f;
+	UPROPERTY(EditAnywhere, Category = "Utility AI") // How far away from the player a flee goes
+		float FleeDistance = 1500.f;
+	UPROPERTY(EditAnywhere, Category = "Utility AI")
+		float AcceptanceRadius = 100.f;
+
+
+private:
+	/** Starts the action's behavior, or a new move if the last one finished */
+	void RunBehavior(EProtoUtilityBehavior Behavior, bool bChanged);
+
+	int32 CurrentAction = INDEX_NONE;
+	double ActionStartTime = 0.0;
+	FVector TargetLocation = FVector::ZeroVector; // The closest player's location from the last gather
+	bool bHasTarget = false;
+	FRandomStream Noise;
+};
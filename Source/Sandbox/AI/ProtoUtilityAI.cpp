@@ -0,0 +1,167 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProtoUtilityAI.h"
+
+
+namespace
+{
+	FProtoUtilityConsideration MakeConsideration(EProtoUtilityInput Input, EProtoUtilityCurve Curve, bool bInvert, float Slope = 1.f, float Exponent = 2.f, float Shift = 0.f, float Offset = 0.f)
+	{
+		FProtoUtilityConsideration Consideration;
+		Consideration.Input = Input;
+		Consideration.Curve = Curve;
+		Consideration.bInvert = bInvert;
+		Consideration.Slope = Slope;
+		Consideration.Exponent = Exponent;
+		Consideration.Shift = Shift;
+		Consideration.Offset = Offset;
+		return Consideration;
+	}
+
+
+	FProtoUtilityAction MakeAction(FName Name, EProtoUtilityBehavior Behavior, float Weight, TArray<FProtoUtilityConsideration>&& Considerations)
+	{
+		FProtoUtilityAction Action;
+		Action.Name = Name;
+		Action.Behavior = Behavior;
+		Action.Weight = Weight;
+		Action.Considerations = MoveTemp(Considerations);
+		return Action;
+	}
+
+
+	/** Multiplies the scores by the consideration's curve over its column, one loop per curve so the inner loop is just the math */
+	void ApplyConsideration(const FProtoUtilityConsideration& Consideration, const float* RESTRICT Column, float* RESTRICT Scores, int32 Num)
+	{
+		const float Sign = Consideration.bInvert ? -1.f : 1.f;
+		const float Base = Consideration.bInvert ? 1.f : 0.f;
+		const float Slope = Consideration.Slope;
+		const float Exponent = Consideration.Exponent;
+		const float Shift = Consideration.Shift;
+		const float Offset = Consideration.Offset;
+
+		switch (Consideration.Curve)
+		{
+		case EProtoUtilityCurve::Linear:
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				const float X = Base + Sign * Column[Index];
+				Scores[Index] *= FMath::Clamp(Slope * (X - Shift) + Offset, 0.f, 1.f);
+			}
+			break;
+		case EProtoUtilityCurve::Quadratic:
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				const float X = Base + Sign * Column[Index];
+				Scores[Index] *= FMath::Clamp(Slope * FMath::Pow(FMath::Max(X - Shift, 0.f), Exponent) + Offset, 0.f, 1.f);
+			}
+			break;
+		case EProtoUtilityCurve::Logistic:
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				const float X = Base + Sign * Column[Index];
+				Scores[Index] *= FMath::Clamp(Slope / (1.f + FMath::Exp(-Exponent * (X - Shift))) + Offset, 0.f, 1.f);
+			}
+			break;
+		case EProtoUtilityCurve::Step:
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				const float X = Base + Sign * Column[Index];
+				Scores[Index] *= FMath::Clamp((X >= Shift ? Slope : 0.f) + Offset, 0.f, 1.f);
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+
+#pragma region Considerations
+float FProtoUtilityConsideration::Evaluate(float X) const
+{
+	float Score = 1.f;
+	ApplyConsideration(*this, &X, &Score, 1);
+	return Score;
+}
+
+
+UProtoUtilityProfile::UProtoUtilityProfile()
+{
+	// Wander around until a player shows up, then chase them while we're healthy and run away when we aren't
+	Actions.Add(MakeAction(TEXT("Idle"), EProtoUtilityBehavior::Idle, 0.3f, {
+		MakeConsideration(EProtoUtilityInput::ActionTime, EProtoUtilityCurve::Linear, true),					// Gets boring
+		MakeConsideration(EProtoUtilityInput::Noise, EProtoUtilityCurve::Linear, false, 0.5f, 2.f, 0.f, 0.5f)
+	}));
+	Actions.Add(MakeAction(TEXT("Wander"), EProtoUtilityBehavior::Wander, 0.5f, {
+		MakeConsideration(EProtoUtilityInput::TargetDistance, EProtoUtilityCurve::Logistic, false, 1.f, 10.f, 0.5f),	// Nobody close
+		MakeConsideration(EProtoUtilityInput::Noise, EProtoUtilityCurve::Linear, false, 0.5f, 2.f, 0.f, 0.5f)
+	}));
+	Actions.Add(MakeAction(TEXT("Chase"), EProtoUtilityBehavior::Chase, 1.f, {
+		MakeConsideration(EProtoUtilityInput::TargetDistance, EProtoUtilityCurve::Quadratic, true),				// Somebody close
+		MakeConsideration(EProtoUtilityInput::Health, EProtoUtilityCurve::Logistic, false, 1.f, 10.f, 0.3f)		// And we're healthy
+	}));
+	Actions.Add(MakeAction(TEXT("Flee"), EProtoUtilityBehavior::Flee, 1.f, {
+		MakeConsideration(EProtoUtilityInput::TargetDistance, EProtoUtilityCurve::Linear, true),
+		MakeConsideration(EProtoUtilityInput::Health, EProtoUtilityCurve::Quadratic, true)						// Hurt
+	}));
+}
+#pragma endregion
+
+
+#pragma region Batches
+void FProtoUtilityBatch::Reset(int32 InNum)
+{
+	Num = InNum;
+	for (TArray<float>& Column : Inputs) Column.SetNumUninitialized(Num, false);
+	CurrentActions.SetNumUninitialized(Num, false);
+	BestActions.SetNumUninitialized(Num, false);
+	BestScores.SetNumUninitialized(Num, false);
+	Scores.SetNumUninitialized(Num, false);
+}
+
+
+namespace ProtoUtilityAI
+{
+	int32 ScoreBatch(const UProtoUtilityProfile& Profile, FProtoUtilityBatch& Batch)
+	{
+		const int32 Num = Batch.Num;
+		int32 NumEvaluations = 0;
+		for (int32 Index = 0; Index < Num; Index++)
+		{
+			Batch.BestActions[Index] = INDEX_NONE;
+			Batch.BestScores[Index] = -1.f;
+		}
+
+		for (int32 ActionIndex = 0; ActionIndex < Profile.Actions.Num(); ActionIndex++)
+		{
+			const FProtoUtilityAction& Action = Profile.Actions[ActionIndex];
+			float* RESTRICT Scores = Batch.Scores.GetData();
+			for (int32 Index = 0; Index < Num; Index++) Scores[Index] = 1.f;
+
+			for (const FProtoUtilityConsideration& Consideration : Action.Considerations)
+			{
+				ApplyConsideration(Consideration, Batch.GetInput(Consideration.Input), Scores, Num);
+			}
+			NumEvaluations += Action.Considerations.Num() * Num;
+
+			// Multiplying the considerations drags the actions with more of them down, make up some of the difference
+			const float Compensation = Action.Considerations.Num() > 0 ? 1.f - 1.f / Action.Considerations.Num() : 0.f;
+			for (int32 Index = 0; Index < Num; Index++)
+			{
+				float Score = Scores[Index];
+				Score += (1.f - Score) * Compensation * Score;
+				Score *= Action.Weight * (Batch.CurrentActions[Index] == ActionIndex ? Profile.Momentum : 1.f);
+				if (Score > Batch.BestScores[Index])
+				{
+					Batch.BestScores[Index] = Score;
+					Batch.BestActions[Index] = ActionIndex;
+				}
+			}
+		}
+
+		return NumEvaluations;
+	}
+}
+#pragma endregion
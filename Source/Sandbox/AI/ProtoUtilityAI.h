@@ -0,0 +1,149 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/DataAsset.h"
+#include "ProtoUtilityAI.generated.h"
+
+
+/*
+	Utility AI for the proto character npcs
+
+	Every decision scores each action of the npc's profile and the npc does whichever scores the highest. An action's score is its weight times each of its considerations,
+	a curve over one of the inputs below (all of them 0 to 1), with the usual compensation for the number of considerations so actions with more of them aren't punished for it.
+	The current action gets a little extra (Momentum) so the npcs don't flip between two actions that score about the same.
+
+	The scoring is batched: the npcs that are due to decide are gathered into columns (one array per input, see FProtoUtilityBatch), and each consideration is one pass over its column
+	for every npc with the same profile, so the curve is picked once per pass instead of once per npc and the inner loops are straight float math.
+	The scheduling (which npcs decide this frame) is in USandboxUtilitySubsystem, and the behaviors (what the actions do) are in AProtoNPCController.
+	Everything runs on the server, the npcs' movement replicates through their characters like any other character.
+*/
+
+
+/** What a consideration looks at, each one is normalized to 0 - 1 when it's gathered */
+UENUM(BlueprintType)
+enum class EProtoUtilityInput : uint8
+{
+	Health,				// Health / the profile's MaxHealth, 1 if the character doesn't have health set up
+	TargetDistance,		// Distance to the closest player / the profile's SenseRadius, 1 if nobody is in range
+	Speed,				// Speed / the max walk speed
+	ActionTime,			// Seconds in the current action / the profile's ActionTimeScale
+	Noise,				// A new random number every decision, so the npcs don't all do the same thing at once
+	MAX UMETA(Hidden)
+};
+
+
+/** The response curves (x is the input, flipped first if bInvert) */
+UENUM(BlueprintType)
+enum class EProtoUtilityCurve : uint8
+{
+	Linear,				// Slope * (x - Shift) + Offset
+	Quadratic,			// Slope * (x - Shift)^Exponent + Offset, zero below Shift
+	Logistic,			// Slope / (1 + e^(-Exponent * (x - Shift))) + Offset
+	Step				// Slope + Offset past Shift, otherwise Offset
+};
+
+
+/** What the npc does while an action is chosen */
+UENUM(BlueprintType)
+enum class EProtoUtilityBehavior : uint8
+{
+	Idle,				// Stand still
+	Wander,				// Walk to random spots on the navmesh
+	Chase,				// Follow the closest player
+	Flee				// Run away from the closest player
+};
+
+
+USTRUCT(BlueprintType)
+struct SANDBOX_API FProtoUtilityConsideration
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		EProtoUtilityInput Input = EProtoUtilityInput::Noise;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		EProtoUtilityCurve Curve = EProtoUtilityCurve::Linear;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // Use 1 - x
+		bool bInvert = false;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		float Slope = 1.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // The power of the quadratic, or the steepness of the logistic
+		float Exponent = 2.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		float Shift = 0.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		float Offset = 0.f;
+
+	/** The score for a single input, clamped to 0 - 1 (the batch passes do the same math) */
+	float Evaluate(float X) const;
+};
+
+
+USTRUCT(BlueprintType)
+struct SANDBOX_API FProtoUtilityAction
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		FName Name;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		EProtoUtilityBehavior Behavior = EProtoUtilityBehavior::Idle;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // Multiplies the score after the considerations
+		float Weight = 1.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		TArray<FProtoUtilityConsideration> Considerations;
+};
+
+
+/**
+ * The actions an npc picks from, and how its inputs are normalized. The npcs that share a profile are scored together
+ * A new profile starts with idle, wander, chase and flee actions (the npcs without a profile use those too)
+ */
+UCLASS(BlueprintType)
+class SANDBOX_API UProtoUtilityProfile : public UDataAsset
+{
+	GENERATED_BODY()
+
+
+public:
+	UProtoUtilityProfile();
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		TArray<FProtoUtilityAction> Actions;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // The current action's score is multiplied by this
+		float Momentum = 1.2f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI")
+		float MaxHealth = 100.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // How far away the npc notices players
+		float SenseRadius = 3000.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Utility AI") // How many seconds in an action is an ActionTime of 1
+		float ActionTimeScale = 10.f;
+};
+
+
+/** The inputs and scores of the npcs being scored together, one array per column */
+struct SANDBOX_API FProtoUtilityBatch
+{
+	int32 Num = 0;
+	TArray<float> Inputs[static_cast<int32>(EProtoUtilityInput::MAX)];
+	TArray<int32> CurrentActions; // INDEX_NONE if the npc hasn't picked one yet
+
+	// The results
+	TArray<int32> BestActions;
+	TArray<float> BestScores;
+	TArray<float> Scores; // The action being scored
+
+	/** Sizes every column for InNum npcs (keeps the allocations) */
+	void Reset(int32 InNum);
+
+	FORCEINLINE float* GetInput(EProtoUtilityInput Input) { return Inputs[static_cast<int32>(Input)].GetData(); }
+};
+
+
+namespace ProtoUtilityAI
+{
+	/** Scores every action of the profile for every npc in the batch and picks the best ones, returns how many consideration evaluations that took */
+	SANDBOX_API int32 ScoreBatch(const UProtoUtilityProfile& Profile, FProtoUtilityBatch& Batch);
+}
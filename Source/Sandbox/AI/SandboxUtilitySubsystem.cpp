@@ -0,0 +1,338 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxUtilitySubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "ProtoNPCController.h"
+#include "Sandbox/Characters/ProtoCharacter/ProtoCharacter.h"
+
+
+DECLARE_STATS_GROUP(TEXT("SandboxAI"), STATGROUP_SandboxAI, STATCAT_Advanced);
+DECLARE_CYCLE_STAT(TEXT("Utility Decisions"), STAT_SandboxAI_UtilityDecisions, STATGROUP_SandboxAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("NPCs"), STAT_SandboxAI_NPCs, STATGROUP_SandboxAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Decisions"), STAT_SandboxAI_Decisions, STATGROUP_SandboxAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Consideration Evaluations"), STAT_SandboxAI_Evaluations, STATGROUP_SandboxAI);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Decisions Waiting"), STAT_SandboxAI_Waiting, STATGROUP_SandboxAI);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Scheduler Latency Avg (ms)"), STAT_SandboxAI_LatencyAvg, STATGROUP_SandboxAI);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Scheduler Latency Max (ms)"), STAT_SandboxAI_LatencyMax, STATGROUP_SandboxAI);
+
+
+#pragma region Console
+static float GSandboxUtilityBudgetMs = 0.5f;
+static FAutoConsoleVariableRef CVarSandboxUtilityBudgetMs(
+	TEXT("Sandbox.UtilityAI.BudgetMs"),
+	GSandboxUtilityBudgetMs,
+	TEXT("How long (in milliseconds) the utility ai decisions can take each frame, the npcs that don't fit wait for the next frame. At least one batch is decided every frame"),
+	ECVF_Default
+);
+
+static int32 GSandboxUtilityBatchSize = 64;
+static FAutoConsoleVariableRef CVarSandboxUtilityBatchSize(
+	TEXT("Sandbox.UtilityAI.BatchSize"),
+	GSandboxUtilityBatchSize,
+	TEXT("The most npcs scored together, the budget is checked between batches"),
+	ECVF_Default
+);
+
+static float GSandboxUtilityDecisionInterval = 0.25f;
+static FAutoConsoleVariableRef CVarSandboxUtilityDecisionInterval(
+	TEXT("Sandbox.UtilityAI.DecisionInterval"),
+	GSandboxUtilityDecisionInterval,
+	TEXT("How often (in seconds) each npc is due for a decision"),
+	ECVF_Default
+);
+#pragma endregion
+
+
+#pragma region Subsystem
+bool USandboxUtilitySubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+void USandboxUtilitySubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+	DefaultProfile = NewObject<UProtoUtilityProfile>(this, TEXT("DefaultUtilityProfile"), RF_Transient);
+}
+
+
+bool USandboxUtilitySubsystem::IsTickable() const
+{
+	return Agents.Num() > 0;
+}
+
+
+TStatId USandboxUtilitySubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USandboxUtilitySubsystem, STATGROUP_Tickables);
+}
+
+
+void USandboxUtilitySubsystem::RegisterNPC(AProtoNPCController* Controller)
+{
+	if (!Controller || Agents.ContainsByPredicate([Controller](const FProtoUtilityAgent& Agent) { return Agent.Controller == Controller; })) return;
+	if (Agents.Num() == 0) ResetStats();
+
+	// Spread the first decision over the interval, so a lot of npcs spawned at once aren't all due on the same frame
+	FProtoUtilityAgent Agent;
+	Agent.Controller = Controller;
+	Agent.DueTime = GetWorld()->GetTimeSeconds() + FMath::FRand() * GSandboxUtilityDecisionInterval;
+	Agents.Add(Agent);
+}
+
+
+void USandboxUtilitySubsystem::UnregisterNPC(AProtoNPCController* Controller)
+{
+	const int32 Index = Agents.IndexOfByPredicate([Controller](const FProtoUtilityAgent& Agent) { return Agent.Controller == Controller; });
+	if (Index != INDEX_NONE) Agents.RemoveAtSwap(Index, 1, false);
+}
+
+
+const UProtoUtilityProfile* USandboxUtilitySubsystem::GetProfile(const AProtoNPCController* Controller) const
+{
+	const UProtoUtilityProfile* Profile = Controller ? Controller->GetProfile() : nullptr;
+	return Profile && Profile->Actions.Num() > 0 ? Profile : DefaultProfile;
+}
+#pragma endregion
+
+
+#pragma region Scheduler
+void USandboxUtilitySubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_SandboxAI_UtilityDecisions);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const uint64 BudgetCycles = static_cast<uint64>(GSandboxUtilityBudgetMs / 1000.0 / FPlatformTime::GetSecondsPerCycle64());
+	const double Now = GetWorld()->GetTimeSeconds();
+	const int32 BatchSize = FMath::Max(GSandboxUtilityBatchSize, 1);
+
+	Agents.RemoveAllSwap([](const FProtoUtilityAgent& Agent) { return !Agent.Controller.IsValid(); }, false);
+	PlayerLocations.Reset();
+	for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+	{
+		const APlayerController* PlayerController = It->Get();
+		if (const APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr) PlayerLocations.Add(Pawn->GetActorLocation());
+	}
+
+	// Batches of the due npcs, round robin from where we stopped last frame, until we've been round everyone or we're out of time
+	int32 NumExamined = 0;
+	int32 NumDecisions = 0;
+	int32 NumEvaluations = 0;
+	double LatencySum = 0.0;
+	double MaxLatency = 0.0;
+	while (NumExamined < Agents.Num())
+	{
+		Due.Reset();
+		while (Due.Num() < BatchSize && NumExamined < Agents.Num())
+		{
+			if (NextAgent >= Agents.Num()) NextAgent = 0;
+			if (Agents[NextAgent].DueTime <= Now) Due.Add(NextAgent);
+			NextAgent++;
+			NumExamined++;
+		}
+		if (Due.Num() == 0) continue;
+
+		for (const int32 Index : Due)
+		{
+			const double Latency = (Now - Agents[Index].DueTime) * 1000.0;
+			LatencySum += Latency;
+			MaxLatency = FMath::Max(MaxLatency, Latency);
+			Agents[Index].DueTime = Now + GSandboxUtilityDecisionInterval;
+		}
+		NumEvaluations += DecideBatch(Due, Now);
+		NumDecisions += Due.Num();
+
+		if (FPlatformTime::Cycles64() - StartCycles > BudgetCycles) break;
+	}
+
+	int32 NumWaiting = 0;
+	for (const FProtoUtilityAgent& Agent : Agents) NumWaiting += Agent.DueTime <= Now ? 1 : 0;
+
+	StatsFrames++;
+	StatsEvaluations += NumEvaluations;
+	StatsDecisions += NumDecisions;
+	StatsCycles += FPlatformTime::Cycles64() - StartCycles;
+	StatsLatencySum += LatencySum;
+	StatsMaxLatency = FMath::Max(StatsMaxLatency, MaxLatency);
+
+	SET_DWORD_STAT(STAT_SandboxAI_NPCs, Agents.Num());
+	SET_DWORD_STAT(STAT_SandboxAI_Decisions, NumDecisions);
+	SET_DWORD_STAT(STAT_SandboxAI_Evaluations, NumEvaluations);
+	SET_DWORD_STAT(STAT_SandboxAI_Waiting, NumWaiting);
+	SET_FLOAT_STAT(STAT_SandboxAI_LatencyAvg, NumDecisions > 0 ? LatencySum / NumDecisions : 0.0);
+	SET_FLOAT_STAT(STAT_SandboxAI_LatencyMax, MaxLatency);
+}
+
+
+int32 USandboxUtilitySubsystem::DecideBatch(const TArray<int32>& DueAgents, double Now)
+{
+	// The npcs with the same profile are scored together, so sort them into runs of the same profile
+	TArray<int32, TInlineAllocator<256>> Sorted(DueAgents);
+	Sorted.Sort([this](int32 A, int32 B) { return GetProfile(Agents[A].Controller.Get()) < GetProfile(Agents[B].Controller.Get()); });
+
+	int32 NumEvaluations = 0;
+	for (int32 RunStart = 0; RunStart < Sorted.Num();)
+	{
+		const UProtoUtilityProfile* Profile = GetProfile(Agents[Sorted[RunStart]].Controller.Get());
+		int32 RunEnd = RunStart + 1;
+		while (RunEnd < Sorted.Num() && GetProfile(Agents[Sorted[RunEnd]].Controller.Get()) == Profile) RunEnd++;
+
+		// Gather the inputs into the columns, score every action in passes over the columns, then hand each npc its action
+		Batch.Reset(RunEnd - RunStart);
+		for (int32 Row = 0; Row < Batch.Num; Row++)
+		{
+			Agents[Sorted[RunStart + Row]].Controller->GatherInputs(Batch, Row, *Profile, PlayerLocations, Now);
+		}
+		NumEvaluations += ProtoUtilityAI::ScoreBatch(*Profile, Batch);
+		for (int32 Row = 0; Row < Batch.Num; Row++)
+		{
+			Agents[Sorted[RunStart + Row]].Controller->SetAction(*Profile, Batch.BestActions[Row], Now);
+		}
+
+		RunStart = RunEnd;
+	}
+
+	return NumEvaluations;
+}
+#pragma endregion
+
+
+#pragma region Spawning
+int32 USandboxUtilitySubsystem::SpawnNPCs(int32 Count, TSubclassOf<AProtoCharacter> CharacterClass)
+{
+	UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client || !CharacterClass) return 0;
+
+	FVector Origin = FVector::ZeroVector;
+	const APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (const APawn* Player = PlayerController ? PlayerController->GetPawn() : nullptr)
+	{
+		Origin = Player->GetActorLocation();
+	}
+	else
+	{
+		TActorIterator<APlayerStart> PlayerStart(World);
+		if (PlayerStart) Origin = PlayerStart->GetActorLocation();
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	int32 NumSpawned = 0;
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		// A spiral out from the origin so they don't spawn in each other
+		const float Angle = Index * 2.4f;
+		const float Radius = 400.f + 80.f * FMath::Sqrt(static_cast<float>(Agents.Num() + Index));
+		const FVector Location = Origin + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f);
+		AProtoCharacter* Character = World->SpawnActor<AProtoCharacter>(CharacterClass, Location, FRotator(0.f, FMath::RadiansToDegrees(Angle), 0.f), SpawnParams);
+		if (!Character) continue;
+
+		Character->AIControllerClass = AProtoNPCController::StaticClass();
+		Character->SpawnDefaultController();
+		if (!Cast<AProtoNPCController>(Character->GetController()))
+		{
+			Character->Destroy();
+			continue;
+		}
+		NumSpawned++;
+	}
+
+	return NumSpawned;
+}
+
+
+void USandboxUtilitySubsystem::RemoveNPCs()
+{
+	const TArray<FProtoUtilityAgent> AgentsToRemove = Agents;
+	for (const FProtoUtilityAgent& Agent : AgentsToRemove)
+	{
+		AProtoNPCController* Controller = Agent.Controller.Get();
+		if (!Controller) continue;
+		if (APawn* Pawn = Controller->GetPawn()) Pawn->Destroy();
+		Controller->Destroy();
+	}
+	Agents.Empty();
+	NextAgent = 0;
+}
+#pragma endregion
+
+
+#pragma region Stats
+void USandboxUtilitySubsystem::ResetStats()
+{
+	StatsFrames = 0;
+	StatsEvaluations = 0;
+	StatsDecisions = 0;
+	StatsCycles = 0;
+	StatsLatencySum = 0.0;
+	StatsMaxLatency = 0.0;
+}
+
+
+void USandboxUtilitySubsystem::LogStats() const
+{
+	if (StatsFrames == 0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.UtilityAI.Stats: No utility ai frames to report"));
+		return;
+	}
+
+	const double Ms = StatsCycles * FPlatformTime::GetSecondsPerCycle64() * 1000.0;
+	UE_LOG(LogTemp, Log, TEXT("Sandbox.UtilityAI.Stats: %d npcs over %d frames. %.3f ms/frame, %.1f decisions/frame, %.0f evaluations/frame, scheduler latency %.2f ms avg, %.2f ms max"),
+		Agents.Num(), StatsFrames, Ms / StatsFrames, static_cast<double>(StatsDecisions) / StatsFrames, static_cast<double>(StatsEvaluations) / StatsFrames,
+		StatsDecisions > 0 ? StatsLatencySum / StatsDecisions : 0.0, StatsMaxLatency);
+}
+
+
+static FAutoConsoleCommand SpawnNPCsCommand(
+	TEXT("Sandbox.UtilityAI.Spawn"),
+	TEXT("Spawns utility ai npcs around the first player. Usage: Sandbox.UtilityAI.Spawn [Count=32] [CharacterClass=/Script/Sandbox.ProtoCharacter]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USandboxUtilitySubsystem* UtilityAI = World ? World->GetSubsystem<USandboxUtilitySubsystem>() : nullptr;
+		if (!UtilityAI) return;
+
+		const int32 Count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 32;
+		UClass* CharacterClass = Args.Num() > 1 ? LoadClass<AProtoCharacter>(nullptr, *Args[1]) : AProtoCharacter::StaticClass();
+		if (!CharacterClass)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Sandbox.UtilityAI.Spawn: %s isn't a proto character class"), *Args[1]);
+			return;
+		}
+
+		const int32 NumSpawned = UtilityAI->SpawnNPCs(Count, CharacterClass);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.UtilityAI.Spawn: Spawned %d of %d npcs, %d npcs in total"), NumSpawned, Count, UtilityAI->GetNumNPCs());
+	})
+);
+
+
+static FAutoConsoleCommand RemoveNPCsCommand(
+	TEXT("Sandbox.UtilityAI.Remove"),
+	TEXT("Removes every utility ai npc and its character"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (USandboxUtilitySubsystem* UtilityAI = World ? World->GetSubsystem<USandboxUtilitySubsystem>() : nullptr) UtilityAI->RemoveNPCs();
+	})
+);
+
+
+static FAutoConsoleCommand UtilityStatsCommand(
+	TEXT("Sandbox.UtilityAI.Stats"),
+	TEXT("Logs the utility ai cost, evaluations and decisions per frame, and the scheduler latency since the last reset. Usage: Sandbox.UtilityAI.Stats [Reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USandboxUtilitySubsystem* UtilityAI = World ? World->GetSubsystem<USandboxUtilitySubsystem>() : nullptr;
+		if (!UtilityAI) return;
+
+		UtilityAI->LogStats();
+		if (Args.Num() > 0 && Args[0].Equals(TEXT("Reset"), ESearchCase::IgnoreCase)) UtilityAI->ResetStats();
+	})
+);
+#pragma endregion
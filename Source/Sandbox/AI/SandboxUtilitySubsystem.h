@@ -0,0 +1,81 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ProtoUtilityAI.h"
+#include "SandboxUtilitySubsystem.generated.h"
+
+
+/** An npc the scheduler decides for */
+struct FProtoUtilityAgent
+{
+	TWeakObjectPtr<class AProtoNPCController> Controller;
+	double DueTime = 0.0; // When the npc's next decision is due
+};
+
+
+/**
+ * The global scheduler for the utility ai decisions (see ProtoUtilityAI.h)
+ * Each npc is due for a decision every Sandbox.UtilityAI.DecisionInterval. Every frame the scheduler goes round the npcs from where it stopped, takes up to Sandbox.UtilityAI.BatchSize due ones,
+ * scores them together (grouped by profile), and keeps going until everyone's been looked at or Sandbox.UtilityAI.BudgetMs is used up. The npcs that didn't fit wait for the next frame,
+ * so adding npcs makes the decisions later (the scheduler latency) instead of making the frame longer. New npcs are spread over the interval so spawning a lot at once doesn't spike either.
+ *
+ * "stat SandboxAI" has the evaluations, decisions and latency per frame, and "Sandbox.UtilityAI.Stats [Reset]" the averages since the last reset
+ */
+UCLASS()
+class SANDBOX_API USandboxUtilitySubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterNPC(class AProtoNPCController* Controller);
+	void UnregisterNPC(class AProtoNPCController* Controller);
+
+	/** Spawns npcs around the first player (or a player start), returns how many were spawned */
+	int32 SpawnNPCs(int32 Count, TSubclassOf<class AProtoCharacter> CharacterClass);
+
+	/** Destroys every npc and its character */
+	void RemoveNPCs();
+
+	void LogStats() const;
+	void ResetStats();
+
+	int32 GetNumNPCs() const { return Agents.Num(); }
+
+
+private:
+	/** Gathers, scores and applies the decisions of the due agents (indices into Agents), returns the number of consideration evaluations */
+	int32 DecideBatch(const TArray<int32>& DueAgents, double Now);
+
+	/** The profile an npc is scored with */
+	const UProtoUtilityProfile* GetProfile(const class AProtoNPCController* Controller) const;
+
+	/** For the npcs without a profile */
+	UPROPERTY()
+		UProtoUtilityProfile* DefaultProfile;
+
+	TArray<FProtoUtilityAgent> Agents;
+	int32 NextAgent = 0;
+
+	// Reused every frame
+	FProtoUtilityBatch Batch;
+	TArray<int32> Due;
+	TArray<FVector> PlayerLocations;
+
+	// Since the last stats reset
+	int32 StatsFrames = 0;
+	int64 StatsEvaluations = 0;
+	int64 StatsDecisions = 0;
+	uint64 StatsCycles = 0;
+	double StatsLatencySum = 0.0;
+	double StatsMaxLatency = 0.0;
+};
@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopBenchmarkCourse.h"
+#include "Components/SceneComponent.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/World.h"
+#include "Engine/CollisionProfile.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/Pawn.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "UObject/ConstructorHelpers.h"
+
+
+namespace
+{
+	constexpr float FloorThickness = 20.f;
+	constexpr float MaxCourseHeight = 4000.f; // The ramps and stairs turn back down past this, so the course doesn't climb forever
+}
+
+
+#pragma region Constructors
+ABhopBenchmarkCourse::ABhopBenchmarkCourse()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	CourseRoot = CreateDefaultSubobject<USceneComponent>(TEXT("CourseRoot"));
+	CourseRoot->SetMobility(EComponentMobility::Static);
+	SetRootComponent(CourseRoot);
+
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> CubeMesh(TEXT("/Engine/BasicShapes/Cube.Cube"));
+	PieceMesh = CubeMesh.Object;
+}
+
+
+void ABhopBenchmarkCourse::OnConstruction(const FTransform& Transform)
+{
+	Super::OnConstruction(Transform);
+	BuildCourse();
+}
+#pragma endregion
+
+
+#pragma region Course
+void ABhopBenchmarkCourse::BuildCourse()
+{
+	for (UStaticMeshComponent* Piece : Pieces)
+	{
+		if (IsValid(Piece)) Piece->DestroyComponent(); // Rerunning the construction script already destroys them in the editor
+	}
+	Pieces.Reset();
+	if (!PieceMesh) return;
+
+	// Always start with a straight so the characters have somewhere to spawn, then whatever the seed picks
+	FRandomStream Stream(Seed);
+	float X = 0.f;
+	float Z = 0.f;
+	BuildStraight(Stream, X, Z);
+	for (int32 Segment = 0; Segment < NumSegments; Segment++)
+	{
+		switch (static_cast<EBhopCourseSegment>(Stream.RandRange(0, static_cast<int32>(EBhopCourseSegment::MAX) - 1)))
+		{
+		case EBhopCourseSegment::Straight:		BuildStraight(Stream, X, Z); break;
+		case EBhopCourseSegment::Ramp:			BuildRamp(Stream, X, Z); break;
+		case EBhopCourseSegment::SurfWalls:		BuildSurfWalls(Stream, X, Z); break;
+		case EBhopCourseSegment::Stairs:		BuildStairs(Stream, X, Z); break;
+		case EBhopCourseSegment::ThinGeometry:	BuildThinGeometry(Stream, X, Z); break;
+		default: break;
+		}
+	}
+
+	// A wall at the end to stop anyone that makes it all the way
+	AddPiece(FVector(X + 50.f, 0.f, Z + 500.f), FVector(100.f, GetCourseWidth(), 1000.f));
+	CourseLength = X;
+}
+
+
+FTransform ABhopBenchmarkCourse::GetStartTransform(int32 Index) const
+{
+	const int32 Lane = Index % NumLanes;
+	const int32 Row = Index / NumLanes;
+	const FVector Location(300.f + Row * 200.f, -GetCourseWidth() * 0.5f + LaneWidth * (Lane + 0.5f), 120.f);
+	return FTransform(GetActorRotation(), GetActorTransform().TransformPosition(Location));
+}
+
+
+void ABhopBenchmarkCourse::AddPiece(const FVector& Center, const FVector& Size, const FQuat& Rotation)
+{
+	UStaticMeshComponent* Piece = NewObject<UStaticMeshComponent>(this, NAME_None, RF_Transient);
+	Piece->CreationMethod = EComponentCreationMethod::UserConstructionScript;
+	Piece->SetMobility(EComponentMobility::Static);
+	Piece->SetStaticMesh(PieceMesh);
+	Piece->SetCollisionProfileName(UCollisionProfile::BlockAll_ProfileName);
+	Piece->SetRelativeTransform(FTransform(Rotation, Center, Size / 100.f));
+	Piece->SetupAttachment(CourseRoot);
+	Piece->RegisterComponent();
+	Pieces.Add(Piece);
+}
+#pragma endregion
+
+
+#pragma region Segments
+void ABhopBenchmarkCourse::BuildStraight(FRandomStream& Stream, float& X, float& Z)
+{
+	const float Length = Stream.FRandRange(2000.f, 6000.f);
+	AddPiece(FVector(X + Length * 0.5f, 0.f, Z - FloorThickness * 0.5f), FVector(Length, GetCourseWidth(), FloorThickness));
+	X += Length;
+}
+
+
+void ABhopBenchmarkCourse::BuildRamp(FRandomStream& Stream, float& X, float& Z)
+{
+	const float Angle = FMath::DegreesToRadians(Stream.FRandRange(5.f, 40.f));
+	const float Length = Stream.FRandRange(1000.f, 2500.f);
+	const float Rise = Length * FMath::Tan(Angle);
+
+	// Up or down, but never below the start or past the max height
+	float Direction = Stream.FRand() < 0.5f ? 1.f : -1.f;
+	if (Z - Rise < 0.f) Direction = 1.f;
+	else if (Z + Rise > MaxCourseHeight) Direction = -1.f;
+
+	// A slab from (X, Z) to (X + Length, Z + Rise), sunk by half its thickness so its top surface meets the floors on each side
+	const FQuat Rotation(FVector::RightVector, -Direction * Angle);
+	const FVector Center = FVector(X + Length * 0.5f, 0.f, Z + Direction * Rise * 0.5f) - Rotation.GetUpVector() * FloorThickness * 0.5f;
+	AddPiece(Center, FVector(Length / FMath::Cos(Angle), GetCourseWidth(), FloorThickness), Rotation);
+
+	X += Length;
+	Z += Direction * Rise;
+	BuildStraight(Stream, X, Z);
+}
+
+
+void ABhopBenchmarkCourse::BuildSurfWalls(FRandomStream& Stream, float& X, float& Z)
+{
+	const float Angle = FMath::DegreesToRadians(Stream.FRandRange(50.f, 70.f));
+	const float Length = Stream.FRandRange(2000.f, 5000.f);
+	const float WallWidth = Stream.FRandRange(500.f, 900.f);
+	const float Gap = 100.f;
+
+	// A floor under the gap, then a wall on each side rising away from it
+	AddPiece(FVector(X + Length * 0.5f, 0.f, Z - FloorThickness * 0.5f), FVector(Length, GetCourseWidth() + WallWidth * 2.f, FloorThickness));
+	for (const float Side : { -1.f, 1.f })
+	{
+		const FQuat Rotation(FVector::ForwardVector, Side * Angle);
+		const FVector Center(X + Length * 0.5f, Side * (Gap * 0.5f + WallWidth * 0.5f * FMath::Cos(Angle)), Z + WallWidth * 0.5f * FMath::Sin(Angle));
+		AddPiece(Center - Rotation.GetUpVector() * FloorThickness * 0.5f, FVector(Length, WallWidth, FloorThickness), Rotation);
+	}
+
+	X += Length;
+}
+
+
+void ABhopBenchmarkCourse::BuildStairs(FRandomStream& Stream, float& X, float& Z)
+{
+	const int32 NumSteps = Stream.RandRange(6, 16);
+	const float StepHeight = Stream.FRandRange(10.f, 45.f);
+	const float StepDepth = Stream.FRandRange(30.f, 80.f);
+	const float Direction = Z + NumSteps * StepHeight > MaxCourseHeight ? -1.f : 1.f;
+
+	// Each step is a block from the bottom of the flight to its own height, going down is the same flight mirrored
+	for (int32 Step = 0; Step < NumSteps; Step++)
+	{
+		const float Top = Direction > 0.f ? Z + (Step + 1) * StepHeight : Z - Step * StepHeight;
+		const float Bottom = FMath::Min(Z, Z + Direction * NumSteps * StepHeight) - FloorThickness;
+		AddPiece(FVector(X + (Step + 0.5f) * StepDepth, 0.f, (Top + Bottom) * 0.5f), FVector(StepDepth, GetCourseWidth(), Top - Bottom));
+	}
+
+	X += NumSteps * StepDepth;
+	Z = Direction > 0.f ? Z + NumSteps * StepHeight : Z - (NumSteps - 1) * StepHeight;
+	BuildStraight(Stream, X, Z);
+}
+
+
+void ABhopBenchmarkCourse::BuildThinGeometry(FRandomStream& Stream, float& X, float& Z)
+{
+	const float Length = Stream.FRandRange(2000.f, 4000.f);
+	const float HalfWidth = GetCourseWidth() * 0.5f;
+	AddPiece(FVector(X + Length * 0.5f, 0.f, Z - FloorThickness * 0.5f), FVector(Length, GetCourseWidth(), FloorThickness));
+
+	const int32 NumPieces = Stream.RandRange(20, 60);
+	for (int32 Index = 0; Index < NumPieces; Index++)
+	{
+		const float PieceX = X + Stream.FRandRange(200.f, Length - 200.f);
+		const float PieceY = Stream.FRandRange(-HalfWidth, HalfWidth);
+		switch (Stream.RandRange(0, 2))
+		{
+		case 0: // A post
+			AddPiece(FVector(PieceX, PieceY, Z + 100.f), FVector(Stream.FRandRange(2.f, 6.f), Stream.FRandRange(2.f, 6.f), 200.f));
+			break;
+		case 1: // A wall along the course
+			AddPiece(FVector(PieceX, PieceY, Z + 75.f), FVector(Stream.FRandRange(100.f, 400.f), Stream.FRandRange(1.f, 4.f), 150.f), FQuat(FVector::UpVector, FMath::DegreesToRadians(Stream.FRandRange(-20.f, 20.f))));
+			break;
+		default: // A floating plate
+			AddPiece(FVector(PieceX, PieceY, Z + Stream.FRandRange(40.f, 200.f)), FVector(Stream.FRandRange(100.f, 300.f), Stream.FRandRange(100.f, 300.f), Stream.FRandRange(1.f, 4.f)));
+			break;
+		}
+	}
+
+	X += Length;
+}
+#pragma endregion
+
+
+#pragma region Console
+static FAutoConsoleCommand SpawnBenchmarkCourseCommand(
+	TEXT("Sandbox.BenchmarkCourse.Spawn"),
+	TEXT("Spawns the benchmark course high above the level and moves the local players to its start. Usage: Sandbox.BenchmarkCourse.Spawn [Seed=1337]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World) return;
+
+		const int32 Seed = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1337;
+		const FTransform SpawnTransform(FVector(0.f, 0.f, 50000.f));
+		ABhopBenchmarkCourse* Course = World->SpawnActorDeferred<ABhopBenchmarkCourse>(ABhopBenchmarkCourse::StaticClass(), SpawnTransform);
+		if (!Course) return;
+		Course->SetSeed(Seed);
+		Course->FinishSpawning(SpawnTransform);
+
+		int32 NumPlayers = 0;
+		for (FConstPlayerControllerIterator It = World->GetPlayerControllerIterator(); It; ++It)
+		{
+			const APlayerController* PlayerController = It->Get();
+			APawn* Pawn = PlayerController ? PlayerController->GetPawn() : nullptr;
+			if (Pawn) Pawn->TeleportTo(Course->GetStartTransform(NumPlayers++).GetLocation(), Course->GetActorRotation());
+		}
+
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.BenchmarkCourse.Spawn: Seed %d, %d pieces, %.0f units long, moved %d players to the start"), Seed, Course->GetNumPieces(), Course->GetCourseLength(), NumPlayers);
+	})
+);
+#pragma endregion
@@ -0,0 +1,100 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "BhopBenchmarkCourse.generated.h"
+
+
+/*
+	Benchmark course
+
+	A level that's built from code, so the movement benchmarks don't depend on the imported bhop map (which isn't in the repo). The course is a line of segments along +x,
+	and the seed decides the order and shape of each one, so the same seed is always the same course on every machine:
+		- Straights (long flat runs to build up speed)
+		- Ramps from 5 to 40 degrees, up and down (ramp slides and trimps)
+		- Surf walls, a pair of 50 to 70 degree walls in a V (too steep to walk on)
+		- Stairs with 10 to 45 unit steps (step ups and floor checks)
+		- Thin geometry, posts and walls a few units thick and thin floating plates (sweeps that barely hit)
+
+	Everything is the engine's cube mesh with BlockAll collision, so it also works with -nullrhi on a dedicated server. Place one in a level, spawn one with
+	"Sandbox.BenchmarkCourse.Spawn [Seed]", or run the headless benchmark (see SandboxMovementBenchmarkCommandlet.h).
+*/
+
+
+/** The kinds of course segments */
+UENUM()
+enum class EBhopCourseSegment : uint8
+{
+	Straight,
+	Ramp,
+	SurfWalls,
+	Stairs,
+	ThinGeometry,
+
+	MAX UMETA(Hidden)
+};
+
+
+/**
+ * A seeded, procedurally generated movement course for benchmarks and load tests
+ */
+UCLASS()
+class SANDBOX_API ABhopBenchmarkCourse : public AActor
+{
+	GENERATED_BODY()
+
+
+public:
+	ABhopBenchmarkCourse();
+	virtual void OnConstruction(const FTransform& Transform) override;
+
+	/** Removes the old pieces and generates the course from the seed */
+	void BuildCourse();
+
+	/** Where the Index'th character starts, the characters are spread across the lanes and then rows behind each other */
+	FTransform GetStartTransform(int32 Index) const;
+
+	/** Sets the seed before the course is built (spawn it deferred, or call BuildCourse again) */
+	FORCEINLINE void SetSeed(int32 InSeed) { Seed = InSeed; }
+	FORCEINLINE int32 GetSeed() const { return Seed; }
+	FORCEINLINE int32 GetNumPieces() const { return Pieces.Num(); }
+	FORCEINLINE float GetCourseLength() const { return CourseLength; }
+	FORCEINLINE int32 GetNumLanes() const { return NumLanes; }
+	FORCEINLINE float GetCourseWidth() const { return NumLanes * LaneWidth; }
+
+
+protected:
+	UPROPERTY(EditAnywhere, Category = "Bhop_Benchmark") // The same seed always builds the same course
+		int32 Seed = 1337;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Benchmark", meta = (ClampMin = "1"))
+		int32 NumSegments = 24;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Benchmark", meta = (ClampMin = "1"))
+		int32 NumLanes = 4;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Benchmark", meta = (ClampMin = "100"))
+		float LaneWidth = 400.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Benchmark") // A 100 unit cube centered on its pivot (the engine's basic shape)
+		class UStaticMesh* PieceMesh;
+
+
+private:
+	/** Adds a box with its center and size relative to the course */
+	void AddPiece(const FVector& Center, const FVector& Size, const FQuat& Rotation = FQuat::Identity);
+
+	// Each segment starts at X and the floor height Z, and moves them to where the next one starts
+	void BuildStraight(FRandomStream& Stream, float& X, float& Z);
+	void BuildRamp(FRandomStream& Stream, float& X, float& Z);
+	void BuildSurfWalls(FRandomStream& Stream, float& X, float& Z);
+	void BuildStairs(FRandomStream& Stream, float& X, float& Z);
+	void BuildThinGeometry(FRandomStream& Stream, float& X, float& Z);
+
+	UPROPERTY(VisibleAnywhere, Category = "Bhop_Benchmark")
+		class USceneComponent* CourseRoot;
+
+	UPROPERTY(Transient)
+		TArray<class UStaticMeshComponent*> Pieces;
+
+	float CourseLength = 0.f;
+};
+
@@ -0,0 +1,284 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxMovementBenchmarkCommandlet.h"
+#include "BhopBenchmarkCourse.h"
+#include "Sandbox/Characters/BhopProto/BhopAccelerationKernel.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacterMovementComponent.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+#include "Components/BoxComponent.h"
+#include "Engine/Engine.h"
+#include "Engine/TriggerBox.h"
+#include "Engine/World.h"
+#include "GameFramework/WorldSettings.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+USandboxMovementBenchmarkCommandlet::USandboxMovementBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = false;
+	IsServer = true;
+	LogToConsole = true;
+}
+
+
+/** The scalar and batched acceleration kernels on every character's current input (see BhopAccelerationKernel.h) */
+struct FAccelKernelBenchmark
+{
+	FBhopAccelBatch Batch;
+	TArray<FBhopAccelInput> Inputs;
+	TArray<FBhopAccelOutput> ScalarOutputs;
+	TArray<FBhopAccelOutput> Outputs;
+	uint64 ScalarCycles = 0;
+	uint64 BatchCycles = 0;
+	int64 NumEvaluations = 0;
+	int32 NumMismatches = 0; // Lanes where the batch and the scalar path disagree on applying acceleration
+	float MaxError = 0.f;
+
+	/** Evaluates the ground and air acceleration for all of the characters both ways, and compares the results */
+	void Run(const TArray<ABhopCharacter*>& Characters)
+	{
+		for (const bool bAir : { false, true })
+		{
+			Inputs.Reset();
+			for (const ABhopCharacter* Character : Characters) Inputs.Add(Character->MakeAccelInput(bAir ? Character->GetAirAccelerate() : Character->GetGroundAccelerate()));
+
+			// The scalar path is what every character does for itself
+			ScalarOutputs.Reset();
+			uint64 StartCycles = FPlatformTime::Cycles64();
+			for (const FBhopAccelInput& Input : Inputs) ScalarOutputs.Add(bAir ? BhopAccelKernel::AccelerateAir(Input) : BhopAccelKernel::AccelerateGround(Input));
+			ScalarCycles += FPlatformTime::Cycles64() - StartCycles;
+
+			// The batch includes packing the lanes
+			StartCycles = FPlatformTime::Cycles64();
+			Batch.Reset();
+			for (const FBhopAccelInput& Input : Inputs) Batch.Add(Input);
+			if (bAir) BhopAccelKernel::AccelerateAirBatch(Batch, Outputs);
+			else BhopAccelKernel::AccelerateGroundBatch(Batch, Outputs);
+			BatchCycles += FPlatformTime::Cycles64() - StartCycles;
+
+			for (int32 Index = 0; Index < Inputs.Num(); Index++)
+			{
+				if (ScalarOutputs[Index].bApplyingAccel != Outputs[Index].bApplyingAccel) NumMismatches++;
+				else MaxError = FMath::Max(MaxError, FMath::Abs(ScalarOutputs[Index].CalcMaxSpeed - Outputs[Index].CalcMaxSpeed));
+			}
+			NumEvaluations += Inputs.Num();
+		}
+	}
+};
+
+
+/** Times the moves with the engine's overlap updates and with the overlap policy, on the course so nothing in a running game is moved or overlapped */
+static bool RunOverlapPolicyBenchmark(UWorld* World, ABhopBenchmarkCourse* Course, const TArray<ABhopCharacter*>& Characters, int32 Seed, const FString& Params)
+{
+	int32 NumMoves = 2000;
+	float Distance = 200.f;
+	FParse::Value(*Params, TEXT("Moves="), NumMoves);
+	FParse::Value(*Params, TEXT("Distance="), Distance);
+	NumMoves = FMath::Max(NumMoves, 2);
+	Distance = FMath::Max(Distance, 1.f);
+
+	// Spread the characters out so their moves don't run into each other, with a trigger halfway along each one's moves so every move begins or ends an overlap
+	const FVector Direction = Course->GetActorForwardVector();
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	for (int32 Index = 0; Index < Characters.Num(); Index++)
+	{
+		const FVector Start = Course->GetStartTransform(Index % Course->GetNumLanes()).GetLocation() + Direction * (Index / Course->GetNumLanes()) * (Distance + 200.f);
+		Characters[Index]->SetActorLocation(Start, false, nullptr, ETeleportType::TeleportPhysics);
+		ATriggerBox* Trigger = World->SpawnActor<ATriggerBox>(Start + Direction * Distance * 0.5f, Course->GetActorRotation(), SpawnParams);
+		UBoxComponent* Box = Trigger ? Cast<UBoxComponent>(Trigger->GetCollisionComponent()) : nullptr;
+		if (Box) Box->SetBoxExtent(FVector(20.f, 100.f, 100.f));
+	}
+	World->Tick(LEVELTICK_All, 1.f / 60.f); // Let the physics scene pick up the triggers
+
+	uint64 EngineCycles = 0;
+	uint64 PolicyCycles = 0;
+	for (ABhopCharacter* Character : Characters)
+	{
+		UBhopCharacterMovementComponent* Movement = Character->GetBhopCharacterMovement();
+		if (!Movement || !Movement->UpdatedComponent) continue;
+
+		// The same moves both ways
+		const FVector StartLocation = Character->GetActorLocation();
+		const FQuat Rotation = Movement->UpdatedComponent->GetComponentQuat();
+		auto TimeMoves = [&](bool bPolicy)
+		{
+			Movement->SetOverlapPolicyApplied(bPolicy);
+			uint64 Cycles = 0;
+			for (int32 Move = 0; Move < NumMoves; Move++)
+			{
+				const FVector Delta = Direction * ((Move & 1) ? -Distance : Distance);
+				const FVector OldLocation = Movement->UpdatedComponent->GetComponentLocation();
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Movement->MoveUpdatedComponent(Delta, Rotation, true);
+				if (bPolicy) Movement->UpdateOverlapPolicy(OldLocation);
+				Cycles += FPlatformTime::Cycles64() - StartCycles;
+			}
+			Character->SetActorLocation(StartLocation, false, nullptr, ETeleportType::TeleportPhysics);
+			return Cycles;
+		};
+		EngineCycles += TimeMoves(false);
+		PolicyCycles += TimeMoves(true);
+		Movement->SetOverlapPolicyApplied(Movement->ShouldUseOverlapPolicy());
+	}
+
+	const int32 NumCharacters = FMath::Max(Characters.Num(), 1);
+	const double EngineMicroseconds = FPlatformTime::ToSeconds64(EngineCycles) * 1e6 / (NumCharacters * NumMoves);
+	const double PolicyMicroseconds = FPlatformTime::ToSeconds64(PolicyCycles) * 1e6 / (NumCharacters * NumMoves);
+	const double Percent = EngineMicroseconds > 0.0 ? PolicyMicroseconds / EngineMicroseconds * 100.0 : 0.0;
+	UE_LOG(LogTemp, Display, TEXT("SandboxMovementBenchmark: %d characters, %d moves of %.0f units each. Engine overlaps: %.2f us per move, Overlap policy: %.2f us per move (%.0f%%)"),
+		Characters.Num(), NumMoves, Distance, EngineMicroseconds, PolicyMicroseconds, Percent);
+
+	const FString Summary = FString::Printf(TEXT("Seed,Characters,Moves,Distance,EngineUsPerMove,PolicyUsPerMove,PolicyPercent\n%d,%d,%d,%.1f,%.4f,%.4f,%.1f\n"),
+		Seed, Characters.Num(), NumMoves, Distance, EngineMicroseconds, PolicyMicroseconds, Percent);
+	return FFileHelper::SaveStringToFile(Summary, *(FPaths::ProfilingDir() / TEXT("Bhop") / FString::Printf(TEXT("OverlapPolicyBenchmark_%d.csv"), Seed)));
+}
+
+
+int32 USandboxMovementBenchmarkCommandlet::Main(const FString& Params)
+{
+	int32 Seed = 1337;
+	int32 NumCharacters = 16;
+	int32 NumFrames = 3600;
+	float DeltaTime = 1.f / 60.f;
+	FString CharacterClassPath;
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	FParse::Value(*Params, TEXT("Characters="), NumCharacters);
+	FParse::Value(*Params, TEXT("Frames="), NumFrames);
+	FParse::Value(*Params, TEXT("DeltaTime="), DeltaTime);
+	FParse::Value(*Params, TEXT("CharacterClass="), CharacterClassPath);
+	NumCharacters = FMath::Max(NumCharacters, 1);
+	NumFrames = FMath::Max(NumFrames, 1);
+	DeltaTime = FMath::Clamp(DeltaTime, 0.001f, 0.1f);
+
+	UClass* CharacterClass = ABhopCharacter::StaticClass();
+	if (!CharacterClassPath.IsEmpty())
+	{
+		UClass* LoadedClass = LoadClass<ABhopCharacter>(nullptr, *CharacterClassPath);
+		if (!LoadedClass)
+		{
+			UE_LOG(LogTemp, Error, TEXT("SandboxMovementBenchmark: %s isn't a bhop character class"), *CharacterClassPath);
+			return 1;
+		}
+		CharacterClass = LoadedClass;
+	}
+
+	// An empty game world with just the course in it
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false, TEXT("MovementBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+	if (!World->GetBegunPlay()) World->GetWorldSettings()->NotifyBeginPlay(); // There isn't a game mode to start play
+
+	const FTransform CourseTransform = FTransform::Identity;
+	ABhopBenchmarkCourse* Course = World->SpawnActorDeferred<ABhopBenchmarkCourse>(ABhopBenchmarkCourse::StaticClass(), CourseTransform);
+	Course->SetSeed(Seed);
+	Course->FinishSpawning(CourseTransform);
+
+	// The characters don't have controllers, so let the movement component run without one
+	TArray<ABhopCharacter*> Characters;
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	for (int32 Index = 0; Index < NumCharacters; Index++)
+	{
+		const FTransform Start = Course->GetStartTransform(Index);
+		ABhopCharacter* Character = World->SpawnActor<ABhopCharacter>(CharacterClass, Start, SpawnParams);
+		if (!Character) continue;
+		Character->GetCharacterMovement()->bRunPhysicsWithNoController = true;
+		Characters.Add(Character);
+	}
+
+	if (FParse::Param(*Params, TEXT("OverlapPolicy")))
+	{
+		const bool bOverlapSaved = RunOverlapPolicyBenchmark(World, Course, Characters, Seed, Params);
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+		return bOverlapSaved ? 0 : 1;
+	}
+
+	// Record the bhop scopes for the percentiles
+	IConsoleVariable* ProfileEnable = IConsoleManager::Get().FindConsoleVariable(TEXT("Bhop.Profile.Enable"));
+	if (ProfileEnable) ProfileEnable->Set(1);
+	FBhopFrameProfiler::Get().Reset();
+	FBhopFloorQueryCounters::Get().Reset();
+
+	// Every character gets its own strafe pattern (the seed decides the period and phase), and hops every so often
+	FRandomStream Stream(Seed);
+	TArray<FVector2D> StrafePatterns;
+	for (int32 Index = 0; Index < Characters.Num(); Index++) StrafePatterns.Add(FVector2D(Stream.FRandRange(0.5f, 2.f), Stream.FRandRange(0.f, 2.f * PI)));
+
+	FAccelKernelBenchmark AccelKernel;
+	TArray<float> FrameTimes;
+	FrameTimes.Reserve(NumFrames);
+	double TotalSeconds = 0.0;
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const float Time = Frame * DeltaTime;
+		for (int32 Index = 0; Index < Characters.Num(); Index++)
+		{
+			const FVector2D& Pattern = StrafePatterns[Index];
+			const float Strafe = FMath::Sin(Time * Pattern.X * 2.f * PI + Pattern.Y);
+			Characters[Index]->ApplyScriptedInput(1.f, Strafe, FMath::Fmod(Time + Pattern.Y, 1.f) < 0.5f);
+			Characters[Index]->AddActorWorldRotation(FRotator(0.f, Strafe * 90.f * DeltaTime, 0.f)); // Turn with the strafe like an air strafe
+		}
+
+		// Outside of the frame time, so it doesn't change the frame numbers
+		AccelKernel.Run(Characters);
+
+		const double FrameStart = FPlatformTime::Seconds();
+		World->Tick(LEVELTICK_All, DeltaTime);
+		const double FrameSeconds = FPlatformTime::Seconds() - FrameStart;
+		FrameTimes.Add(FrameSeconds * 1000.0);
+		TotalSeconds += FrameSeconds;
+
+		FBhopFrameProfiler::Get().EndFrame();
+		GFrameCounter++;
+	}
+
+	// Frame time percentiles, and how far everyone made it
+	FrameTimes.Sort();
+	const auto Percentile = [&FrameTimes](float Value) { return FrameTimes[FMath::Clamp(FMath::CeilToInt(Value * FrameTimes.Num()) - 1, 0, FrameTimes.Num() - 1)]; };
+	float TotalDistance = 0.f;
+	float MaxSpeed = 0.f;
+	for (int32 Index = 0; Index < Characters.Num(); Index++)
+	{
+		TotalDistance += FMath::Max(Characters[Index]->GetActorLocation().X - Course->GetStartTransform(Index).GetLocation().X, 0.f);
+		MaxSpeed = FMath::Max(MaxSpeed, Characters[Index]->GetVelocity().Size2D());
+	}
+
+	const FBhopFloorQueryCounters& FloorCounters = FBhopFloorQueryCounters::Get();
+	const double CharacterFrames = FMath::Max<double>(FloorCounters.CharacterFrames, 1.0);
+	const double MeanMs = TotalSeconds * 1000.0 / NumFrames;
+	const double PerCharacterUs = TotalSeconds * 1000000.0 / NumFrames / FMath::Max(Characters.Num(), 1);
+	UE_LOG(LogTemp, Display, TEXT("SandboxMovementBenchmark: Seed %d, %d pieces, %d characters, %d frames at %.4f s"), Seed, Course->GetNumPieces(), Characters.Num(), NumFrames, DeltaTime);
+	UE_LOG(LogTemp, Display, TEXT("SandboxMovementBenchmark: Frame mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms, max %.3f ms, %.2f us per character"),
+		MeanMs, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), Percentile(1.f), PerCharacterUs);
+	UE_LOG(LogTemp, Display, TEXT("SandboxMovementBenchmark: Average distance %.0f, max speed %.0f, floor queries per character frame %.3f, traces %.3f"),
+		TotalDistance / FMath::Max(Characters.Num(), 1), MaxSpeed, FloorCounters.FloorQueries / CharacterFrames, FloorCounters.Traces / CharacterFrames);
+
+	const double NumEvaluations = FMath::Max<double>(AccelKernel.NumEvaluations, 1.0);
+	const double KernelScalarNs = FPlatformTime::ToSeconds64(AccelKernel.ScalarCycles) * 1e9 / NumEvaluations;
+	const double KernelBatchNs = FPlatformTime::ToSeconds64(AccelKernel.BatchCycles) * 1e9 / NumEvaluations;
+	UE_LOG(LogTemp, Display, TEXT("SandboxMovementBenchmark: Acceleration kernel scalar %.2f ns, batch %.2f ns per character (%d lanes), %d mismatched lanes, max error %f"),
+		KernelScalarNs, KernelBatchNs, FBhopAccelBatch::LaneCount, AccelKernel.NumMismatches, AccelKernel.MaxError);
+
+	const FString FileName = FString::Printf(TEXT("MovementBenchmark_%d"), Seed);
+	const FString Summary = FString::Printf(TEXT("Seed,Pieces,Characters,Frames,DeltaTime,MeanMs,P50Ms,P95Ms,P99Ms,MaxMs,PerCharacterUs,AvgDistance,FloorQueriesPerCharacterFrame,TracesPerCharacterFrame,KernelScalarNs,KernelBatchNs,KernelMismatches,KernelMaxError\n%d,%d,%d,%d,%.6f,%.4f,%.4f,%.4f,%.4f,%.4f,%.3f,%.1f,%.4f,%.4f,%.3f,%.3f,%d,%.6f\n"),
+		Seed, Course->GetNumPieces(), Characters.Num(), NumFrames, DeltaTime, MeanMs, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f), Percentile(1.f), PerCharacterUs,
+		TotalDistance / FMath::Max(Characters.Num(), 1), FloorCounters.FloorQueries / CharacterFrames, FloorCounters.Traces / CharacterFrames,
+		KernelScalarNs, KernelBatchNs, AccelKernel.NumMismatches, AccelKernel.MaxError);
+	const bool bSaved = FFileHelper::SaveStringToFile(Summary, *(FPaths::ProfilingDir() / TEXT("Bhop") / (FileName + TEXT(".csv"))));
+	FBhopFrameProfiler::Get().ExportCSV(FileName + TEXT("_Scopes"));
+	if (ProfileEnable) ProfileEnable->Set(0);
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+	return bSaved ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SandboxMovementBenchmarkCommandlet.generated.h"
+
+
+/**
+ * Runs bhop characters through the benchmark course (see BhopBenchmarkCourse.h) in a headless world, and writes the frame times so runs on different machines can be compared
+ *		UnrealEditor-Cmd Sandbox.uproject -run=SandboxMovementBenchmark -nullrhi [-Seed=1337] [-Characters=16] [-Frames=3600] [-DeltaTime=0.0166667] [-CharacterClass=/Game/.../BP_Character.BP_Character_C]
+ * 
+ * The world is ticked at a fixed delta time with scripted input (forward, a seeded strafe pattern, and jumping), so the same seed and settings always do the same work.
+ * The results are logged and written to Saved/Profiling/Bhop/MovementBenchmark_<Seed>.csv, along with the bhop scope percentiles (see BhopProfiler.h)
+ * Every frame the characters' acceleration inputs are also run through the scalar and the batched acceleration kernels (outside of the frame time), and their cost and largest difference are reported
+ * 
+ * With -OverlapPolicy [-Moves=2000] [-Distance=200] it times MoveUpdatedComponent back and forth through a trigger box for every character instead, with the engine's overlap updates
+ * and with the overlap policy (see BhopOverlapPolicy.h), and writes Saved/Profiling/Bhop/OverlapPolicyBenchmark_<Seed>.csv. Nothing but the course and the triggers are in the world, so the overlaps don't go anywhere
+ */
+UCLASS()
+class SANDBOX_API USandboxMovementBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+
+public:
+	USandboxMovementBenchmarkCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
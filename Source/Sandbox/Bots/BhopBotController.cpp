@@ -0,0 +1,195 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopBotController.h"
+#include "Components/SplineComponent.h"
+#include "NavigationSystem.h"
+#include "NavigationPath.h"
+#include "Engine/World.h"
+#include "SandboxBotSubsystem.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacterMovementComponent.h"
+#include "Sandbox/Characters/BhopProto/BhopAccelerationKernel.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Bot Steering"), STAT_Bhop_BotSteering, STATGROUP_Bhop);
+
+
+#pragma region Constructors
+ABhopBotController::ABhopBotController()
+{
+	PrimaryActorTick.bCanEverTick = true;
+
+	// The bot turns the view itself, and doesn't need a player state for anything
+	bSetControlRotationFromPawnOrientation = false;
+	bWantsPlayerState = false;
+}
+
+
+void ABhopBotController::OnPossess(APawn* InPawn)
+{
+	Super::OnPossess(InPawn);
+
+	BhopCharacter = Cast<ABhopCharacter>(InPawn);
+	if (!BhopCharacter) return;
+
+	SetControlRotation(BhopCharacter->GetActorRotation());
+	if (USandboxBotSubsystem* Bots = GetWorld()->GetSubsystem<USandboxBotSubsystem>()) Bots->RegisterBot(this);
+}
+
+
+void ABhopBotController::OnUnPossess()
+{
+	if (USandboxBotSubsystem* Bots = GetWorld()->GetSubsystem<USandboxBotSubsystem>()) Bots->UnregisterBot(this);
+	BhopCharacter = nullptr;
+	bHasTarget = false;
+
+	Super::OnUnPossess();
+}
+
+
+void ABhopBotController::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USandboxBotSubsystem* Bots = GetWorld()->GetSubsystem<USandboxBotSubsystem>()) Bots->UnregisterBot(this);
+	Super::EndPlay(EndPlayReason);
+}
+#pragma endregion
+
+
+#pragma region Decisions
+void ABhopBotController::Think(double Now)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	LastThinkTime = Now;
+	NumThinks++;
+	if (!BhopCharacter)
+	{
+		ThinkCycles += FPlatformTime::Cycles64() - StartCycles;
+		return;
+	}
+
+	const FVector Location = BhopCharacter->GetActorLocation();
+	const FVector Velocity = BhopCharacter->GetVelocity();
+	const float Speed = Velocity.Size2D();
+
+	if (PathSpline)
+	{
+		// Aim further down the spline the faster we're going, and go around again at the end
+		const float SplineLength = PathSpline->GetSplineLength();
+		const float Key = PathSpline->FindInputKeyClosestToWorldLocation(Location);
+		float Distance = PathSpline->GetDistanceAlongSplineAtSplineInputKey(Key) + FMath::Max(Speed * LookAheadTime, MinLookAheadDistance);
+		if (SplineLength > 0.f) Distance = FMath::Fmod(Distance, SplineLength);
+		TargetLocation = PathSpline->GetLocationAtDistanceAlongSpline(Distance, ESplineCoordinateSpace::World);
+		bHasTarget = true;
+	}
+	else
+	{
+		// Move on to the next path point once we're close enough, and find somewhere new to go when we run out of them or we've been stuck for a while
+		if (Speed > 50.f) StuckTime = Now;
+		while (PathPoints.IsValidIndex(PathIndex) && FVector::DistSquared2D(PathPoints[PathIndex], Location) < FMath::Square(AcceptRadius)) PathIndex++;
+		if (!PathPoints.IsValidIndex(PathIndex) || Now - StuckTime > 2.0)
+		{
+			RequestNavPath(Location);
+			StuckTime = Now;
+		}
+
+		bHasTarget = PathPoints.IsValidIndex(PathIndex);
+		if (bHasTarget) TargetLocation = PathPoints[PathIndex];
+	}
+
+	// Strafe the way the target is, and weave from side to side when it's straight ahead
+	if (bHasTarget)
+	{
+		const FVector ToTarget = TargetLocation - Location;
+		const float TargetYaw = ToTarget.Rotation().Yaw;
+		const float MoveYaw = Speed > 1.f ? Velocity.Rotation().Yaw : GetControlRotation().Yaw;
+		const float DeltaYaw = FRotator::NormalizeAxis(TargetYaw - MoveYaw);
+		if (FMath::Abs(DeltaYaw) > StraightAngle)
+		{
+			StrafeSide = FMath::Sign(DeltaYaw);
+			NextWeaveTime = Now + WeaveTime;
+		}
+		else if (Now >= NextWeaveTime)
+		{
+			StrafeSide = -StrafeSide;
+			NextWeaveTime = Now + WeaveTime;
+		}
+	}
+
+	ThinkCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+
+
+void ABhopBotController::RequestNavPath(const FVector& Location)
+{
+	PathPoints.Reset();
+	PathIndex = 0;
+
+	UNavigationSystemV1* NavSystem = FNavigationSystem::GetCurrent<UNavigationSystemV1>(GetWorld());
+	FNavLocation Destination;
+	if (!NavSystem || !NavSystem->GetRandomReachablePointInRadius(Location, WanderRadius, Destination)) return;
+
+	const UNavigationPath* Path = NavSystem->FindPathToLocationSynchronously(GetWorld(), Location, Destination.Location, BhopCharacter);
+	if (Path && Path->IsValid())
+	{
+		PathPoints = Path->PathPoints;
+		PathIndex = PathPoints.Num() > 1 ? 1 : 0; // The first point is where we are
+	}
+}
+#pragma endregion
+
+
+#pragma region Steering
+void ABhopBotController::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	Steer(DeltaTime);
+}
+
+
+void ABhopBotController::Steer(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_BotSteering);
+	if (!BhopCharacter || !bHasTarget || DeltaTime <= 0.f) return;
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const UBhopCharacterMovementComponent* MovementComponent = BhopCharacter->GetBhopCharacterMovement();
+	const FVector Velocity = BhopCharacter->GetVelocity();
+	const float Speed = Velocity.Size2D();
+	const bool bOnGround = MovementComponent && MovementComponent->IsMovingOnGround();
+
+	float ViewYaw;
+	float ForwardAxis = 0.f;
+	float RightAxis = 0.f;
+	if (Speed < StrafeMinSpeed)
+	{
+		// Too slow to strafe, just run at the target
+		ViewYaw = (TargetLocation - BhopCharacter->GetActorLocation()).Rotation().Yaw;
+		ForwardAxis = 1.f;
+	}
+	else
+	{
+		// Only the strafe key, with the wish direction at the optimal angle from the velocity: cos = (cap - accel) / speed, where accel is how much the air acceleration adds this frame.
+		// Past the cap the clamp takes over and anything at 90 degrees or less adds the most, so there the wish direction is just kept square to the velocity
+		const float AccelPerFrame = DeltaTime * BhopCharacter->GetBaseMaxWalkSpeed() * BhopCharacter->GetAirAccelerate();
+		const float OptimalAngle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp((BHOP_AIR_ACCEL_SPEED_CAP - AccelPerFrame) / Speed, 0.f, 1.f)));
+
+		// The right key moves 90 degrees to the right of the view (and the left key 90 to the left), so turn the view to put that on the optimal angle
+		ViewYaw = Velocity.Rotation().Yaw + StrafeSide * (OptimalAngle - 90.f);
+		RightAxis = StrafeSide;
+	}
+
+	// Turn like a player with a mouse would, the character faces the control rotation
+	FRotator ControlRotation = GetControlRotation();
+	const float MaxTurn = MaxTurnRate * DeltaTime;
+	ControlRotation.Yaw = FRotator::NormalizeAxis(ControlRotation.Yaw + FMath::Clamp(FRotator::NormalizeAxis(ViewYaw - ControlRotation.Yaw), -MaxTurn, MaxTurn));
+	SetControlRotation(ControlRotation);
+	BhopCharacter->FaceRotation(ControlRotation, DeltaTime);
+
+	// Hold the jump while on the ground so it jumps the frame we land
+	BhopCharacter->ApplyScriptedInput(ForwardAxis, RightAxis, bOnGround);
+
+	SteerCycles += FPlatformTime::Cycles64() - StartCycles;
+}
+#pragma endregion
@@ -0,0 +1,107 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AIController.h"
+#include "BhopBotController.generated.h"
+
+
+/*
+	Bhop bots
+
+	Bots for load testing that move like players, they drive the bhop character through the same input functions the player bindings use (ApplyScriptedInput) so the server runs the same movement logic.
+	The work is split in two:
+		- Think (the decisions): where to go next along a spline path or a navmesh path, and which way to strafe. The bot subsystem calls this for a few bots each frame,
+			round robin within Sandbox.Bots.DecisionBudgetMs, so the cost doesn't grow with the number of bots past the budget (each bot just decides less often)
+		- Steer (every tick): Quake style optimal angle strafing towards the last decision's target. In the air the wish direction is held at acos((cap - accel) / speed) from the velocity,
+			the angle where the clamped air acceleration adds the most speed, and the bot jumps the moment it lands
+	The view turns by setting the control rotation (Turn is AddControllerYawInput, which only does anything for a local player controller), capped at MaxTurnRate.
+
+	Every bot keeps count of the cycles it spends in both, "Sandbox.Bots.Stats [Reset]" prints the server cpu per bot and "stat Bhop" has the totals.
+		Sandbox.Bots.Spawn [Count] to add bots (they follow the spline of an actor tagged BotPath if there is one, otherwise they wander the navmesh), Sandbox.Bots.Remove
+
+	What the bots don't cover: they're server local (an AI controller owns the character on the server), so their characters tick the movement directly like a listen server host.
+	None of their moves go through the ServerMove rpcs, the server move queue and jitter buffer, or the move validation (see SandboxServerMoveSubsystem.h), and nothing is sent back as
+	client adjustments. They measure the server's simulation, decision and replication cost for a crowd of fast movers, not the per connection cost of receiving and validating player moves,
+	which needs real (or headless) clients connected to the server.
+*/
+
+
+/**
+ * Plays a bhop character like a player would (see above)
+ */
+UCLASS()
+class SANDBOX_API ABhopBotController : public AAIController
+{
+	GENERATED_BODY()
+
+
+public:
+	ABhopBotController();
+	virtual void Tick(float DeltaTime) override;
+
+	/** Picks the next target and strafe direction, called by the bot subsystem within its budget */
+	void Think(double Now);
+
+	/** Follows a spline instead of the navmesh */
+	void SetPathSpline(class USplineComponent* InPathSpline) { PathSpline = InPathSpline; }
+
+	double GetLastThinkTime() const { return LastThinkTime; }
+	uint64 GetThinkCycles() const { return ThinkCycles; }
+	uint64 GetSteerCycles() const { return SteerCycles; }
+	int32 GetNumThinks() const { return NumThinks; }
+	void ResetCycles() { ThinkCycles = 0; SteerCycles = 0; NumThinks = 0; }
+
+
+protected:
+	virtual void OnPossess(APawn* InPawn) override;
+	virtual void OnUnPossess() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // The fastest the bot turns its view (degrees per second), a fast flick with a mouse
+		float MaxTurnRate = 720.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // Under this speed the bot runs straight at its target instead of strafing
+		float StrafeMinSpeed = 300.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // The target has to be more than this many degrees off the velocity to strafe towards it, otherwise the bot weaves
+		float StraightAngle = 15.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // How long each side of a weave lasts when the target is straight ahead
+		float WeaveTime = 0.6f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // How far ahead along a spline path the bot aims, in seconds at its current speed
+		float LookAheadTime = 0.5f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot")
+		float MinLookAheadDistance = 400.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // How close the bot has to get to a navmesh path point to move on to the next one
+		float AcceptRadius = 300.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bot") // How far a new navmesh destination can be
+		float WanderRadius = 8000.f;
+
+	UPROPERTY()
+		class USplineComponent* PathSpline;
+	UPROPERTY()
+		class ABhopCharacter* BhopCharacter;
+
+
+private:
+	/** Finds a path on the navmesh to a random reachable point */
+	void RequestNavPath(const FVector& Location);
+
+	/** Strafes towards the target, applies the input for this tick */
+	void Steer(float DeltaTime);
+
+	// The decision (Think), read by Steer
+	FVector TargetLocation = FVector::ZeroVector;
+	float StrafeSide = 1.f;
+	bool bHasTarget = false;
+
+	// Navmesh path
+	TArray<FVector> PathPoints;
+	int32 PathIndex = 0;
+	double NextWeaveTime = 0.0;
+	double StuckTime = 0.0; // When the bot was last moving, for repathing when it gets stuck
+
+	double LastThinkTime = -1.0;
+	uint64 ThinkCycles = 0;
+	uint64 SteerCycles = 0;
+	int32 NumThinks = 0;
+};
@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxBotSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerStart.h"
+#include "Components/SplineComponent.h"
+#include "BhopBotController.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Bot Decisions"), STAT_Bhop_BotDecisions, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bots"), STAT_Bhop_Bots, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Bot Decisions"), STAT_Bhop_BotDecisionCount, STATGROUP_Bhop);
+
+
+#pragma region Console
+static float GSandboxBotDecisionBudgetMs = 0.5f;
+static FAutoConsoleVariableRef CVarSandboxBotDecisionBudgetMs(
+	TEXT("Sandbox.Bots.DecisionBudgetMs"),
+	GSandboxBotDecisionBudgetMs,
+	TEXT("How long (in milliseconds) the bot decisions can take each frame, the bots that don't get to think wait for the next frame. At least one bot thinks every frame"),
+	ECVF_Default
+);
+
+static float GSandboxBotDecisionInterval = 0.1f;
+static FAutoConsoleVariableRef CVarSandboxBotDecisionInterval(
+	TEXT("Sandbox.Bots.DecisionInterval"),
+	GSandboxBotDecisionInterval,
+	TEXT("The least time (in seconds) between the decisions of a single bot"),
+	ECVF_Default
+);
+#pragma endregion
+
+
+#pragma region Subsystem
+bool USandboxBotSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+bool USandboxBotSubsystem::IsTickable() const
+{
+	return Bots.Num() > 0;
+}
+
+
+TStatId USandboxBotSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USandboxBotSubsystem, STATGROUP_Tickables);
+}
+
+
+void USandboxBotSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_BotDecisions);
+	StatsFrames++;
+
+	// Round robin from where we stopped, until every bot has had a look or we're out of time
+	const double Now = GetWorld()->GetTimeSeconds();
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const uint64 BudgetCycles = static_cast<uint64>(GSandboxBotDecisionBudgetMs / 1000.0 / FPlatformTime::GetSecondsPerCycle64());
+	int32 NumDecisions = 0;
+	for (int32 Checked = 0; Checked < Bots.Num(); Checked++)
+	{
+		if (NextBot >= Bots.Num()) NextBot = 0;
+		ABhopBotController* Bot = Bots[NextBot].Get();
+		if (!Bot)
+		{
+			Bots.RemoveAtSwap(NextBot, 1, false);
+			Checked--;
+			continue;
+		}
+		NextBot++;
+
+		if (Bot->GetLastThinkTime() >= 0.0 && Now - Bot->GetLastThinkTime() < GSandboxBotDecisionInterval) continue;
+		Bot->Think(Now);
+		NumDecisions++;
+		if (FPlatformTime::Cycles64() - StartCycles > BudgetCycles) break;
+	}
+
+	SET_DWORD_STAT(STAT_Bhop_Bots, Bots.Num());
+	SET_DWORD_STAT(STAT_Bhop_BotDecisionCount, NumDecisions);
+}
+
+
+void USandboxBotSubsystem::RegisterBot(ABhopBotController* Bot)
+{
+	if (Bots.Num() == 0) ResetStats();
+	Bots.AddUnique(Bot);
+}
+
+
+void USandboxBotSubsystem::UnregisterBot(ABhopBotController* Bot)
+{
+	Bots.RemoveSingleSwap(Bot, false);
+}
+#pragma endregion
+
+
+#pragma region Spawning
+int32 USandboxBotSubsystem::SpawnBots(int32 Count)
+{
+	UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client) return 0;
+
+	// Spawn them as whatever the first player is playing (so they have the blueprint's mesh and settings), around the player or a player start
+	TSubclassOf<ABhopCharacter> CharacterClass = ABhopCharacter::StaticClass();
+	FVector Origin = FVector::ZeroVector;
+	const APlayerController* PlayerController = World->GetFirstPlayerController();
+	if (const ABhopCharacter* Player = PlayerController ? Cast<ABhopCharacter>(PlayerController->GetPawn()) : nullptr)
+	{
+		CharacterClass = Player->GetClass();
+		Origin = Player->GetActorLocation();
+	}
+	else
+	{
+		TActorIterator<APlayerStart> PlayerStart(World);
+		if (PlayerStart) Origin = PlayerStart->GetActorLocation();
+	}
+
+	USplineComponent* PathSpline = nullptr;
+	for (TActorIterator<AActor> It(World); It && !PathSpline; ++It)
+	{
+		if (It->ActorHasTag(TEXT("BotPath"))) PathSpline = It->FindComponentByClass<USplineComponent>();
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButDontSpawnIfColliding;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	int32 NumSpawned = 0;
+	for (int32 Index = 0; Index < Count; Index++)
+	{
+		// A spiral out from the origin so they don't spawn in each other
+		const float Angle = Index * 2.4f;
+		const float Radius = 200.f + 60.f * FMath::Sqrt(static_cast<float>(Bots.Num() + Index));
+		const FVector Location = Origin + FVector(FMath::Cos(Angle) * Radius, FMath::Sin(Angle) * Radius, 0.f);
+		ABhopCharacter* Character = World->SpawnActor<ABhopCharacter>(CharacterClass, Location, FRotator(0.f, FMath::RadiansToDegrees(Angle), 0.f), SpawnParams);
+		if (!Character) continue;
+
+		Character->AIControllerClass = ABhopBotController::StaticClass();
+		Character->SpawnDefaultController();
+		ABhopBotController* Bot = Cast<ABhopBotController>(Character->GetController());
+		if (!Bot)
+		{
+			Character->Destroy();
+			continue;
+		}
+
+		Bot->SetPathSpline(PathSpline);
+		NumSpawned++;
+	}
+
+	return NumSpawned;
+}
+
+
+void USandboxBotSubsystem::RemoveBots()
+{
+	TArray<TWeakObjectPtr<ABhopBotController>> BotsToRemove = Bots;
+	for (const TWeakObjectPtr<ABhopBotController>& Bot : BotsToRemove)
+	{
+		if (!Bot.IsValid()) continue;
+		if (APawn* Pawn = Bot->GetPawn()) Pawn->Destroy();
+		Bot->Destroy();
+	}
+	Bots.Empty();
+	NextBot = 0;
+}
+#pragma endregion
+
+
+#pragma region Stats
+void USandboxBotSubsystem::ResetStats()
+{
+	for (const TWeakObjectPtr<ABhopBotController>& Bot : Bots)
+	{
+		if (Bot.IsValid()) Bot->ResetCycles();
+	}
+	StatsFrames = 0;
+	StatsStartTime = FPlatformTime::Seconds();
+}
+
+
+void USandboxBotSubsystem::LogStats() const
+{
+	const double Seconds = FPlatformTime::Seconds() - StatsStartTime;
+	if (Bots.Num() == 0 || StatsFrames == 0 || Seconds <= 0.0)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Bots.Stats: No bot frames to report"));
+		return;
+	}
+
+	uint64 ThinkCycles = 0;
+	uint64 SteerCycles = 0;
+	int64 NumThinks = 0;
+	int32 NumBots = 0;
+	const ABhopBotController* SlowestBot = nullptr;
+	for (const TWeakObjectPtr<ABhopBotController>& Bot : Bots)
+	{
+		if (!Bot.IsValid()) continue;
+		ThinkCycles += Bot->GetThinkCycles();
+		SteerCycles += Bot->GetSteerCycles();
+		NumThinks += Bot->GetNumThinks();
+		NumBots++;
+		if (!SlowestBot || Bot->GetThinkCycles() + Bot->GetSteerCycles() > SlowestBot->GetThinkCycles() + SlowestBot->GetSteerCycles()) SlowestBot = Bot.Get();
+	}
+	if (NumBots == 0) return;
+
+	// Per frame is the cost of the bots on the server's frame, per bot is what each additional bot adds to it
+	const double MsPerCycle = FPlatformTime::GetSecondsPerCycle64() * 1000.0;
+	const double ThinkMs = ThinkCycles * MsPerCycle / StatsFrames;
+	const double SteerMs = SteerCycles * MsPerCycle / StatsFrames;
+	UE_LOG(LogTemp, Log, TEXT("Sandbox.Bots.Stats: %d bots over %d frames (%.1fs). AI %.3f ms/frame (decisions %.3f, steering %.3f), %.2f us/bot/frame, %.1f decisions/bot/s"),
+		NumBots, StatsFrames, Seconds, ThinkMs + SteerMs, ThinkMs, SteerMs, (ThinkMs + SteerMs) * 1000.0 / NumBots, NumThinks / Seconds / NumBots);
+	if (SlowestBot)
+	{
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Bots.Stats: Slowest bot %s, %.2f us/frame"),
+			*GetNameSafe(SlowestBot->GetPawn()), (SlowestBot->GetThinkCycles() + SlowestBot->GetSteerCycles()) * MsPerCycle * 1000.0 / StatsFrames);
+	}
+}
+
+
+static FAutoConsoleCommand SpawnBotsCommand(
+	TEXT("Sandbox.Bots.Spawn"),
+	TEXT("Spawns strafe jumping bots around the first player, they follow the spline of an actor tagged BotPath or wander the navmesh. Usage: Sandbox.Bots.Spawn [Count=16]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USandboxBotSubsystem* Bots = World ? World->GetSubsystem<USandboxBotSubsystem>() : nullptr;
+		if (!Bots) return;
+
+		const int32 Count = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 16;
+		const int32 NumSpawned = Bots->SpawnBots(Count);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Bots.Spawn: Spawned %d of %d bots, %d bots in total"), NumSpawned, Count, Bots->GetNumBots());
+	})
+);
+
+
+static FAutoConsoleCommand RemoveBotsCommand(
+	TEXT("Sandbox.Bots.Remove"),
+	TEXT("Removes every bot and its character"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (USandboxBotSubsystem* Bots = World ? World->GetSubsystem<USandboxBotSubsystem>() : nullptr) Bots->RemoveBots();
+	})
+);
+
+
+static FAutoConsoleCommand BotStatsCommand(
+	TEXT("Sandbox.Bots.Stats"),
+	TEXT("Logs the server cpu the bot decisions and steering use per frame and per bot since the last reset. Usage: Sandbox.Bots.Stats [Reset]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USandboxBotSubsystem* Bots = World ? World->GetSubsystem<USandboxBotSubsystem>() : nullptr;
+		if (!Bots) return;
+
+		Bots->LogStats();
+		if (Args.Num() > 0 && Args[0].Equals(TEXT("Reset"), ESearchCase::IgnoreCase)) Bots->ResetStats();
+	})
+);
+#pragma endregion
@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SandboxBotSubsystem.generated.h"
+
+
+/**
+ * Schedules the bot decisions (see BhopBotController.h)
+ * Every frame it goes round the bots from where it stopped last frame and lets each one think if it hasn't for Sandbox.Bots.DecisionInterval, until Sandbox.Bots.DecisionBudgetMs is used up.
+ * The steering still runs every tick on each bot, so with a lot of bots they just react a little later instead of taking longer frames
+ * The bots are server local, so they skip the server move rpcs, queueing and validation that connected players cost (see BhopBotController.h)
+ */
+UCLASS()
+class SANDBOX_API USandboxBotSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	void RegisterBot(class ABhopBotController* Bot);
+	void UnregisterBot(class ABhopBotController* Bot);
+
+	/** Spawns bots around the first player (or a player start), they follow the spline of an actor tagged BotPath if there is one. Returns how many were spawned */
+	int32 SpawnBots(int32 Count);
+
+	/** Destroys every bot and its character */
+	void RemoveBots();
+
+	/** Logs the server cpu the bots have used since the last reset */
+	void LogStats() const;
+	void ResetStats();
+
+	int32 GetNumBots() const { return Bots.Num(); }
+
+
+private:
+	TArray<TWeakObjectPtr<class ABhopBotController>> Bots;
+	int32 NextBot = 0; // Where the decisions start next frame
+
+	// Since the last stats reset
+	int32 StatsFrames = 0;
+	double StatsStartTime = 0.0;
+};
@@ -20,6 +20,7 @@
 #include "Components/CapsuleComponent.h"
 //#include "Components/WidgetComponent.h"
 #include "Components/PrimitiveComponent.h"
+#include "Sandbox/Characters/ProxyInterpolationComponent.h"
 
 // Types
 #include "AI/Navigation/NavigationTypes.h"
@@ -45,16 +46,26 @@ ABaseCharacterConfiguration::ABaseCharacterConfiguration(const FObjectInitialize
 	PrimaryActorTick.bCanEverTick = true;
 	SpawnCollisionHandlingMethod = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
 
-	// Create the camera arm
+	// Create the camera arm (on every target, the subobjects have to match the cooked blueprints, the server just doesn't use them)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(GetMesh()); // Attach this to the mesh because if we attach this to the root, whenever we crouch the springArm/Camera will move along with it, which is not intended
+	CharacterCam = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
+	CharacterCam->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attaches the camera to the camera's spring arm socket
+
+#if SANDBOX_WITH_COSMETICS
 	CameraBoom->TargetArmLength = 200; // Distance from the character
 	CameraBoom->SocketOffset = FVector(0, 74, 74); // Align the camera to the side of the character
 	CameraBoom->bUsePawnControlRotation = true; // Allows us to rotate the camera boom along with our controller when we're adding mouse input
-
-	CharacterCam = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	CharacterCam->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attaches the camera to the camera's spring arm socket
 	CharacterCam->bUsePawnControlRotation = false; // The follow camera should use the pawn control rotation as it's attached to the camera boom
+#else
+	// Nobody looks through the camera on the dedicated server, so the arm doesn't tick (or trace for collision), and nothing reads the pose unless it's rendered
+	CameraBoom->PrimaryComponentTick.bStartWithTickEnabled = false;
+	CameraBoom->bDoCollisionTest = false;
+	GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+#endif
+
+	// Snapshot interpolation for when this is someone else's character
+	ProxyInterpolation = CreateDefaultSubobject<UProxyInterpolationComponent>(TEXT("ProxyInterpolation"));
 
 	// Player collision
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -109,6 +120,15 @@ void ABaseCharacterConfiguration::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
 }
+
+
+void ABaseCharacterConfiguration::PostNetReceiveLocationAndRotation()
+{
+	// The proxy interpolation places the character from the snapshots (and applies the replicated movement mode), so the movement component doesn't need to smooth (or simulate) anything
+	if (ProxyInterpolation && ProxyInterpolation->ShouldInterpolate() && ProxyInterpolation->AddSnapshotFromReplicatedMovement()) return;
+
+	Super::PostNetReceiveLocationAndRotation();
+}
 #pragma endregion
 
 
@@ -216,6 +236,7 @@ void ABaseCharacterConfiguration::CrouchButtonReleased()
 #pragma region Utility
 void ABaseCharacterConfiguration::PrintToScreen(FColor color, FString message)
 {
+#if SANDBOX_WITH_COSMETICS
 	if (HasAuthority() && IsLocallyControlled())
 	{
 		UE_LOG(LogTemp, Warning, TEXT("server %s:: %s"), *GetNameSafe(this), *message);
@@ -225,5 +246,6 @@ void ABaseCharacterConfiguration::PrintToScreen(FColor color, FString message)
 	{
 		UE_LOG(LogTemp, Warning, TEXT("client:: %s"), *GetNameSafe(this), *message);
 	}
+#endif
 }
 #pragma endregion
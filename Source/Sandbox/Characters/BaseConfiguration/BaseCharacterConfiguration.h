@@ -24,6 +24,7 @@ public:
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual void Tick(float DeltaTime) override;
 	virtual void PostInitializeComponents() override;
+	virtual void PostNetReceiveLocationAndRotation() override; // Simulated proxies send the replicated transform to the proxy interpolation instead of the movement component's smoothing
 	//virtual void Destroyed() override; // This is a replicated function, handle logic pertaining to character death in here for free
 
 	//virtual void OnRep_ReplicatedMovement() override; // overriding this to replicate simulated proxies movement: https://www.udemy.com/course/unreal-engine-5-cpp-multiplayer-shooter/learn/lecture/31515548#questions
@@ -39,6 +40,8 @@ private:
 		class USpringArmComponent* CameraBoom;
 	UPROPERTY(VisibleAnywhere, Category = "Camera")
 		class UCameraComponent* CharacterCam;
+	UPROPERTY(VisibleAnywhere, Category = "Network")
+		class UProxyInterpolationComponent* ProxyInterpolation;
 
 
 
@@ -5,10 +5,12 @@
 #include "Sandbox/Characters/BaseConfiguration/BaseCharacterConfiguration.h"
 #include "GameFramework/CharacterMovementComponent.h"
 #include "Kismet/KismetMathLibrary.h"
+#include "Sandbox/SandboxMemory.h"
 
 
 void UBaseConfigurationAnimInstance::NativeInitializeAnimation()
 {
+	LLM_SCOPE_BYTAG(Sandbox_Animation);
 	Super::NativeInitializeAnimation();
 
 	Character = Cast<ABaseCharacterConfiguration>(TryGetPawnOwner());
@@ -19,6 +21,8 @@ void UBaseConfigurationAnimInstance::NativeUpdateAnimation(float DeltaTime)
 {
 	Super::NativeUpdateAnimation(DeltaTime);
 
+#if SANDBOX_WITH_COSMETICS
+	LLM_SCOPE_BYTAG(Sandbox_Animation);
 	if (Character == nullptr) Character = Cast<ABaseCharacterConfiguration>(TryGetPawnOwner());
 	if (Character == nullptr) return;
 
@@ -47,4 +51,5 @@ void UBaseConfigurationAnimInstance::NativeUpdateAnimation(float DeltaTime)
 	Lean = FMath::Clamp(Interp, -90.f, 90.f); // Clamp this value so it doesn't break the character's back 
 
 	if (Character->IsLocallyControlled()) bLocallyControlled = true;
+#endif
 }
@@ -3,6 +3,7 @@
 
 #include "CMCBaseConfiguration.h"
 #include "GameFramework/Character.h"
+#include "Sandbox/SandboxMemory.h"
 
 
 // CMC network breakdown
@@ -50,8 +51,8 @@ bool UCMCBaseConfiguration::CMCB_FSavedMove_Character::CanCombineWith(const FSav
 {
 	CMCB_FSavedMove_Character* NewBhopMove = static_cast<CMCB_FSavedMove_Character*>(NewMove.Get());
 
-	// (Sprinting scenario) Check if was sprinting (if they pressed the sprint button on the client)
-	if (Saved_bWantsToSprnt != NewBhopMove->Saved_bWantsToSprnt)
+	// (Sprinting scenario, etc.) Check if any of the movement inputs changed (if they pressed a button on the client)
+	if (Saved_MovementInput != NewBhopMove->Saved_MovementInput)
 	{
 		return false;
 	}
@@ -66,18 +67,15 @@ void UCMCBaseConfiguration::CMCB_FSavedMove_Character::Clear()
 	Super::Clear();
 
 	// Reset our logic
-	Saved_bWantsToSprnt = 0;
+	Saved_MovementInput.Clear();
 }
 
 
 // This is the minimal movement information that's sent to the server every frame for replication
+// Our own inputs are sent in the movement input bits of the network move data, so the custom flags are left free
 uint8 UCMCBaseConfiguration::CMCB_FSavedMove_Character::GetCompressedFlags() const
 {
-	uint8 Result = Super::GetCompressedFlags(); // Base flags
-
-	if (Saved_bWantsToSprnt) Result |= FLAG_Custom_0; // Flip custom flag 0 (Sprint channel), if is sprinting
-
-	return Result;
+	return Super::GetCompressedFlags(); // Base flags
 }
 
 
@@ -91,7 +89,7 @@ void UCMCBaseConfiguration::CMCB_FSavedMove_Character::SetMoveFor(ACharacter* Ch
 	UCMCBaseConfiguration* CharacterMovement = Cast<UCMCBaseConfiguration>(Character->GetCharacterMovement());
 	if (CharacterMovement)
 	{
-		Saved_bWantsToSprnt = CharacterMovement->Safe_bWantsToSprnt;
+		Saved_MovementInput = CharacterMovement->GetMovementInput();
 	}
 }
 
@@ -106,7 +104,7 @@ void UCMCBaseConfiguration::CMCB_FSavedMove_Character::PrepMoveFor(ACharacter* C
 	UCMCBaseConfiguration* CharacterMovement = Cast<UCMCBaseConfiguration>(Character->GetCharacterMovement());
 	if (CharacterMovement)
 	{
-		CharacterMovement->Safe_bWantsToSprnt = Saved_bWantsToSprnt;
+		CharacterMovement->ApplyMovementInput(Saved_MovementInput);
 	}
 }
 #pragma endregion
@@ -116,12 +114,26 @@ void UCMCBaseConfiguration::CMCB_FSavedMove_Character::PrepMoveFor(ACharacter* C
 // Bhop FNetworkPredicitonData_Client Implementation																															 			 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma region FNetworkPredictionData_Client_Character (Bhop)
-UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character::CMCB_FNetworkPredictionData_Client_Character(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character::CMCB_FNetworkPredictionData_Client_Character(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+	, MoveArena(MaxSavedMoveCount + MaxFreeMoveCount + 4) // The pending, acked, and a couple of in flight moves
+{
+}
+
+
+UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character::~CMCB_FNetworkPredictionData_Client_Character()
+{
+	// Return the moves to the arena before it's destroyed (the base destructor would do this after our members are gone)
+	SavedMoves.Empty();
+	FreeMoves.Empty();
+	PendingMove = nullptr;
+	LastAckedMove = nullptr;
+}
 
 
 FSavedMovePtr UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character::AllocateNewMove()
 {
-	return FSavedMovePtr(new CMCB_FSavedMove_Character());
+	return MoveArena.Allocate();
 }
 #pragma endregion
 
@@ -145,6 +157,7 @@ void UCMCBaseConfiguration::CMCB_FCharacterNetworkMoveData::ClientFillNetworkMov
 
 	// Send the bhop specific implementations across the network
 	const CMCB_FSavedMove_Character& BhopClientMove = static_cast<const CMCB_FSavedMove_Character&>(ClientMove);
+	MovementInput = BhopClientMove.Saved_MovementInput;
 }
 
 
@@ -154,6 +167,7 @@ bool UCMCBaseConfiguration::CMCB_FCharacterNetworkMoveData::Serialize(UCharacter
 
 	// Serialize all the information to be sent across the network (to and from)
 	//bool bLocalSuccess = true;
+	MovementInput.Serialize(Ar);
 	//SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopMaxWalkSpeed, MAX_WALK_SPEED);
 	//SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopGroundFriction, GROUND_FRICTION);
 	//SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopJumpZVelocity, JUMP_Z_VELOCITY);
@@ -175,6 +189,8 @@ bool UCMCBaseConfiguration::CMCB_FCharacterNetworkMoveData::Serialize(UCharacter
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 UCMCBaseConfiguration::UCMCBaseConfiguration()
 {
+	LLM_SCOPE_BYTAG(Sandbox_Movement);
+
 	#pragma region Character movement compendium
 	// CharacterMovement (General Settings)
 	GravityScale = 2.8f; // pertains to bhop
@@ -230,7 +246,7 @@ UCMCBaseConfiguration::UCMCBaseConfiguration()
 	NetworkMinTimeBetweenClientAdjustments = 0.1f;
 	NetworkMinTimeBetweenClientAdjustmentsLargeCorrection = 0.05f;
 	NetworkLargeClientCorrectionDistance = 15.f;
-	bNetworkAlwaysReplicateTransformUpdateTimestamp = false;
+	bNetworkAlwaysReplicateTransformUpdateTimestamp = true; // The snapshot buffer needs the server time stamp of each update (bUseHermiteProxySmoothing)
 	NetworkSimulatedSmoothLocationTime = 0.1f;
 	NetworkSimulatedSmoothRotationTime = 0.05f;
 	ListenServerNetworkSimulatedSmoothLocationTime = 0.04f;
@@ -261,6 +277,9 @@ UCMCBaseConfiguration::UCMCBaseConfiguration()
 	// These are the saved default values of the bhop variables
 	DefaultMaxWalkSpeed = MaxWalkSpeed;
 	DefaultMaxSprintSpeed = MaxWalkSpeed * 2;
+
+	// Use our own network move data so the movement input bits are sent with each move
+	SetNetworkMoveDataContainer(CMCBMoveDataContainer);
 }
 
 
@@ -270,6 +289,7 @@ FNetworkPredictionData_Client* UCMCBaseConfiguration::GetPredictionData_Client()
 
 	if (ClientPredictionData == nullptr)
 	{
+		LLM_SCOPE_BYTAG(Sandbox_SavedMoves);
 		UCMCBaseConfiguration* MutableThis = const_cast<UCMCBaseConfiguration*>(this); // This is a workaround of const (in the case the prediction data is undefined and we have to create it)
 		MutableThis->ClientPredictionData = new CMCB_FNetworkPredictionData_Client_Character(*this);
 		MutableThis->ClientPredictionData->MaxSmoothNetUpdateDist = 92.f;
@@ -282,6 +302,12 @@ FNetworkPredictionData_Client* UCMCBaseConfiguration::GetPredictionData_Client()
 
 void UCMCBaseConfiguration::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
 {
+	CMCB_FCharacterNetworkMoveData* MoveData = static_cast<CMCB_FCharacterNetworkMoveData*>(GetCurrentNetworkMoveData());
+	if (MoveData != nullptr)
+	{
+		ApplyMovementInput(MoveData->MovementInput);
+	}
+
 	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
 }
 
@@ -290,7 +316,21 @@ void UCMCBaseConfiguration::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
-	Safe_bWantsToSprnt = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+	// The custom flags are free, sprint comes from the movement input bits (see MoveAutonomous)
+}
+
+
+FMovementInputFlags UCMCBaseConfiguration::GetMovementInput() const
+{
+	FMovementInputFlags MovementInput;
+	MovementInput.Set(EMovementInput::Sprint, Safe_bWantsToSprnt);
+	return MovementInput;
+}
+
+
+void UCMCBaseConfiguration::ApplyMovementInput(const FMovementInputFlags& MovementInput)
+{
+	Safe_bWantsToSprnt = MovementInput.Get(EMovementInput::Sprint);
 }
 
 
@@ -345,3 +385,31 @@ UFUNCTION(BlueprintCallable) void UCMCBaseConfiguration::SprintReleased()
 {
 	Safe_bWantsToSprnt = false;
 }
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Simulated Proxy Smoothing																																								 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Simulated Proxy Smoothing
+void UCMCBaseConfiguration::SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation)
+{
+	// The snapshot buffer moves the capsule, and the mesh is placed in SmoothClientPosition (see ProxySnapshotBuffer.h)
+	if (!bUseHermiteProxySmoothing || !ProxySmoothing::SmoothCorrection(ProxySnapshots, this, NewLocation, NewRotation))
+	{
+		Super::SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
+		return;
+	}
+
+	bNetworkSmoothingComplete = false;
+}
+
+
+void UCMCBaseConfiguration::SmoothClientPosition(float DeltaSeconds)
+{
+	if (!bUseHermiteProxySmoothing) ProxySnapshots.Reset();
+	if (!bUseHermiteProxySmoothing || !ProxySmoothing::SmoothClientPosition(ProxySnapshots, this, ProxyInterpolationDelay, ProxyMaxExtrapolationTime))
+	{
+		Super::SmoothClientPosition(DeltaSeconds);
+	}
+}
+#pragma endregion
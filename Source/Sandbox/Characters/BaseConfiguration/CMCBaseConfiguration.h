@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Sandbox/Characters/MovementInputFlags.h"
+#include "Sandbox/Characters/SavedMoveArena.h"
+#include "Sandbox/Characters/ProxySnapshotBuffer.h"
 #include "CMCBaseConfiguration.generated.h"
 
 
@@ -96,7 +99,7 @@ public:
 		typedef FSavedMove_Character Super;
 
 		// Other values values we want to pass into the saved moves
-		uint8 Saved_bWantsToSprnt : 1;
+		FMovementInputFlags Saved_MovementInput; // Sprint, etc. (see MovementInputFlags.h)
 
 		// Functions 
 		/** Returns true if this move can be combined with NewMove for replication without changing any behavior */
@@ -129,8 +132,14 @@ public:
 	public:
 		typedef FNetworkPredictionData_Client_Character Super;
 		CMCB_FNetworkPredictionData_Client_Character(const UCharacterMovementComponent& ClientMovement);
-		/* Creates a copy of the new move */
+		virtual ~CMCB_FNetworkPredictionData_Client_Character();
+		/* Creates a copy of the new move (from the move arena) */
 		virtual FSavedMovePtr AllocateNewMove() override;
+		FORCEINLINE const TSavedMoveArena<CMCB_FSavedMove_Character>& GetMoveArena() const { return MoveArena; }
+
+	protected:
+		/** Room for every saved move, free move, and the pending and acked moves (see SavedMoveArena.h) */
+		TSavedMoveArena<CMCB_FSavedMove_Character> MoveArena;
 	};
 
 
@@ -163,6 +172,7 @@ public:
 		virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override; // Data compression for efficient transfer across the network
 
 		// Other information we want to send across the network (since it's being updated every frame)
+		FMovementInputFlags MovementInput;
 		float Saved_BhopMaxWalkSpeed = MAX_WALK_SPEED;
 		float Saved_BhopGroundFriction = JUMP_Z_VELOCITY;
 		float Saved_BhopJumpZVelocity = GROUND_FRICTION;
@@ -179,6 +189,7 @@ public:
 	*/
 	class CMCB_CharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
 	{
+	public:
 		//typedef FCharacterNetworkMoveDataContainer Super;
 		CMCB_CharacterNetworkMoveDataContainer();
 		CMCB_FCharacterNetworkMoveData CMCBDefaultMoveData[3];
@@ -206,10 +217,16 @@ public:
 	/* Get's the max speed base on the movement mode you're in */
 	virtual float GetMaxSpeed() const override;
 
+	/** Simulated proxies add the replicated transform to the snapshot buffer instead of using the engine's smoothing (see ProxySnapshotBuffer.h) */
+	virtual void SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation) override;
+
 
 protected:
 	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
 
+	/** Places the simulated proxy's mesh from the snapshot buffer */
+	virtual void SmoothClientPosition(float DeltaSeconds) override;
+
 
 	////////// Additional implementations to the original UCharacterMovement class ////////// 
 public:
@@ -217,6 +234,11 @@ public:
 	UFUNCTION(BlueprintCallable) void SprintPressed();
 	UFUNCTION(BlueprintCallable) void SprintReleased();
 
+	/** Packs the safe input variables into the movement input bits that are sent with each move */
+	FMovementInputFlags GetMovementInput() const;
+	/** Sets the safe input variables from the movement input bits of a move */
+	void ApplyMovementInput(const FMovementInputFlags& MovementInput);
+
 	// Movement variables that are hoisted to the network
 	bool Safe_bWantsToSprnt = false;
 
@@ -224,4 +246,21 @@ public:
 	UPROPERTY() float DefaultMaxWalkSpeed = MAX_WALK_SPEED;
 	UPROPERTY() float DefaultMaxSprintSpeed = MAX_WALK_SPEED * 2;
 
+
+	// Simulated proxy smoothing (Hermite interpolation between the replicated snapshots, with a bit of extrapolation when they're late)
+	UPROPERTY(EditAnywhere, Category = "Character Movement (Networking)") // Use the snapshot buffer for simulated proxies instead of NetworkSmoothingMode
+		bool bUseHermiteProxySmoothing = true;
+	UPROPERTY(EditAnywhere, Category = "Character Movement (Networking)", meta = (EditCondition = "bUseHermiteProxySmoothing")) // How many snapshot intervals behind the newest snapshot the proxy is rendered
+		float ProxyInterpolationDelay = 1.5f;
+	UPROPERTY(EditAnywhere, Category = "Character Movement (Networking)", meta = (EditCondition = "bUseHermiteProxySmoothing")) // The furthest (in seconds) a proxy is extrapolated past the newest snapshot before it holds
+		float ProxyMaxExtrapolationTime = 0.1f;
+
+
+protected:
+	// Our custom network move data, this is what carries the movement input bits to the server
+	CMCB_CharacterNetworkMoveDataContainer CMCBMoveDataContainer;
+
+	/** The replicated transforms of a simulated proxy */
+	FProxySnapshotBuffer ProxySnapshots;
+
 };
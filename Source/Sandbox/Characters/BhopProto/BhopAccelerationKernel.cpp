@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopAccelerationKernel.h"
+#include "Math/VectorRegister.h"
+
+
+#pragma region Batch
+int32 FBhopAccelBatch::Add(const FBhopAccelInput& Input)
+{
+	// Grow every array by a full set of lanes once the padding is used up
+	if (NumInputs == InputDirX.Num())
+	{
+		for (FLaneArray* Lane : { &InputDirX, &InputDirY, &InputDirZ, &VelX, &VelY, &VelZ, &PrevVelX, &PrevVelY, &PrevVelZ, &FrameTime, &DefaultMaxWalkSpeed, &Accelerate, &MaxSeaDemonSpeed })
+		{
+			Lane->AddZeroed(LaneCount);
+		}
+	}
+
+	const int32 Index = NumInputs++;
+	InputDirX[Index] = static_cast<float>(Input.InputDirection.X);
+	InputDirY[Index] = static_cast<float>(Input.InputDirection.Y);
+	InputDirZ[Index] = static_cast<float>(Input.InputDirection.Z);
+	VelX[Index] = static_cast<float>(Input.Velocity.X);
+	VelY[Index] = static_cast<float>(Input.Velocity.Y);
+	VelZ[Index] = static_cast<float>(Input.Velocity.Z);
+	PrevVelX[Index] = static_cast<float>(Input.PrevVelocity.X);
+	PrevVelY[Index] = static_cast<float>(Input.PrevVelocity.Y);
+	PrevVelZ[Index] = static_cast<float>(Input.PrevVelocity.Z);
+	FrameTime[Index] = Input.FrameTime;
+	DefaultMaxWalkSpeed[Index] = Input.DefaultMaxWalkSpeed;
+	Accelerate[Index] = Input.Accelerate;
+	MaxSeaDemonSpeed[Index] = Input.MaxSeaDemonSpeed;
+	return Index;
+}
+
+
+void FBhopAccelBatch::Reset()
+{
+	for (FLaneArray* Lane : { &InputDirX, &InputDirY, &InputDirZ, &VelX, &VelY, &VelZ, &PrevVelX, &PrevVelY, &PrevVelZ, &FrameTime, &DefaultMaxWalkSpeed, &Accelerate, &MaxSeaDemonSpeed })
+	{
+		Lane->Reset();
+	}
+	NumInputs = 0;
+}
+#pragma endregion
+
+
+#pragma region Scalar
+namespace BhopAccelKernel
+{
+	FBhopAccelOutput AccelerateGround(const FBhopAccelInput& Input)
+	{
+		FBhopAccelOutput Output;
+
+		// Takes the projection of the current velocity along the input direction - this is used to allow some acceleration to take place when turning in the same direction of strafe
+		const float ProjectedVelocity = FVector::DotProduct(FVector(Input.Velocity.X, Input.Velocity.Y, 0.f), Input.InputDirection);
+
+		// Take the length of our input vector (desired input speed)
+		const float InputSpeed = (Input.InputDirection * Input.DefaultMaxWalkSpeed).Length();
+
+		// When a movement key is pressed we subtract the velocity projection from the accel speed cap to set a max acceleration value
+		const float MaxAccelSpeed = InputSpeed - ProjectedVelocity;
+		if (MaxAccelSpeed > 0.f)
+		{
+			const float Accelspeed = FMath::Clamp((Input.FrameTime * InputSpeed * Input.Accelerate), 0.f, MaxAccelSpeed);
+
+			// The impulse we will apply for acceleration, added onto the previous velocity
+			const FVector ImpulseVector = Input.InputDirection * Accelspeed;
+
+			Output.bApplyingAccel = true;
+			Output.CalcMaxSpeed = FMath::Clamp((Input.PrevVelocity + ImpulseVector).Length(), static_cast<double>(Input.DefaultMaxWalkSpeed), static_cast<double>(Input.MaxSeaDemonSpeed));
+		}
+
+		return Output;
+	}
+
+
+	FBhopAccelOutput AccelerateAir(const FBhopAccelInput& Input)
+	{
+		FBhopAccelOutput Output;
+
+		// Takes the projection of the current velocity along the input direction - this is used to allow some acceleration to take place when turning in the same direction of strafe
+		const float ProjectedVelocity = FVector::DotProduct(Input.Velocity, Input.InputDirection);
+
+		// Take the length of our input vector (desired input speed)
+		const float InputSpeed = (Input.InputDirection * Input.DefaultMaxWalkSpeed).Length();
+
+		// Cap the acceleration from a standstill before subtracting the velocity projection
+		const float MaxAccelSpeed = FMath::Clamp(InputSpeed, 0.f, BHOP_AIR_ACCEL_SPEED_CAP) - ProjectedVelocity;
+		if (MaxAccelSpeed > 0.f)
+		{
+			const float Accelspeed = FMath::Clamp((Input.FrameTime * InputSpeed * Input.Accelerate), 0.f, MaxAccelSpeed);
+
+			// The length of the impulse plus the length of the previous velocity
+			const FVector ImpulseVector = Input.InputDirection * Accelspeed;
+
+			Output.bApplyingAccel = true;
+			Output.CalcMaxSpeed = FMath::Clamp(ImpulseVector.Length() + Input.PrevVelocity.Length(), static_cast<double>(Input.DefaultMaxWalkSpeed), static_cast<double>(Input.MaxSeaDemonSpeed));
+		}
+
+		return Output;
+	}
+}
+#pragma endregion
+
+
+#pragma region Vectorized
+namespace BhopAccelKernel
+{
+	// Vector length of three lanes worth of components
+	static FORCEINLINE VectorRegister4Float LaneLength(const VectorRegister4Float& X, const VectorRegister4Float& Y, const VectorRegister4Float& Z)
+	{
+		return VectorSqrt(VectorAdd(VectorAdd(VectorMultiply(X, X), VectorMultiply(Y, Y)), VectorMultiply(Z, Z)));
+	}
+
+
+	// Writes the lane results back out to the output array (skipping the padding at the end)
+	static FORCEINLINE void StoreLanes(int32 Base, int32 Num, const VectorRegister4Float& Mask, const VectorRegister4Float& CalcMaxSpeed, TArray<FBhopAccelOutput>& Outputs)
+	{
+		alignas(16) float Speeds[FBhopAccelBatch::LaneCount];
+		VectorStoreAligned(CalcMaxSpeed, Speeds);
+		const int32 MaskBits = VectorMaskBits(Mask);
+
+		const int32 LastLane = FMath::Min(FBhopAccelBatch::LaneCount, Num - Base);
+		for (int32 Lane = 0; Lane < LastLane; Lane++)
+		{
+			FBhopAccelOutput& Output = Outputs[Base + Lane];
+			Output.bApplyingAccel = (MaskBits & (1 << Lane)) != 0;
+			Output.CalcMaxSpeed = Output.bApplyingAccel ? Speeds[Lane] : 0.f;
+		}
+	}
+
+
+	void AccelerateGroundBatch(const FBhopAccelBatch& Batch, TArray<FBhopAccelOutput>& Outputs)
+	{
+		Outputs.SetNumUninitialized(Batch.Num());
+		const VectorRegister4Float Zero = VectorZeroFloat();
+
+		for (int32 i = 0; i < Batch.Num(); i += FBhopAccelBatch::LaneCount)
+		{
+			const VectorRegister4Float DirX = VectorLoadAligned(&Batch.InputDirX[i]);
+			const VectorRegister4Float DirY = VectorLoadAligned(&Batch.InputDirY[i]);
+			const VectorRegister4Float DirZ = VectorLoadAligned(&Batch.InputDirZ[i]);
+			const VectorRegister4Float WalkSpeed = VectorLoadAligned(&Batch.DefaultMaxWalkSpeed[i]);
+
+			// Projection of the velocity along the input direction (xy plane only)
+			const VectorRegister4Float Projected = VectorAdd(VectorMultiply(VectorLoadAligned(&Batch.VelX[i]), DirX), VectorMultiply(VectorLoadAligned(&Batch.VelY[i]), DirY));
+			const VectorRegister4Float InputSpeed = LaneLength(VectorMultiply(DirX, WalkSpeed), VectorMultiply(DirY, WalkSpeed), VectorMultiply(DirZ, WalkSpeed));
+			const VectorRegister4Float MaxAccelSpeed = VectorSubtract(InputSpeed, Projected);
+			const VectorRegister4Float Applying = VectorCompareGT(MaxAccelSpeed, Zero);
+
+			// Accelspeed = clamp(FrameTime * InputSpeed * Accelerate, 0, MaxAccelSpeed)
+			const VectorRegister4Float RawAccel = VectorMultiply(VectorMultiply(VectorLoadAligned(&Batch.FrameTime[i]), InputSpeed), VectorLoadAligned(&Batch.Accelerate[i]));
+			const VectorRegister4Float Accelspeed = VectorMin(VectorMax(RawAccel, Zero), MaxAccelSpeed);
+
+			// |PrevVelocity + InputDirection * Accelspeed|
+			const VectorRegister4Float AcceleratedSpeed = LaneLength(
+				VectorAdd(VectorLoadAligned(&Batch.PrevVelX[i]), VectorMultiply(DirX, Accelspeed)),
+				VectorAdd(VectorLoadAligned(&Batch.PrevVelY[i]), VectorMultiply(DirY, Accelspeed)),
+				VectorAdd(VectorLoadAligned(&Batch.PrevVelZ[i]), VectorMultiply(DirZ, Accelspeed))
+			);
+
+			const VectorRegister4Float CalcMaxSpeed = VectorMin(VectorMax(AcceleratedSpeed, WalkSpeed), VectorLoadAligned(&Batch.MaxSeaDemonSpeed[i]));
+			StoreLanes(i, Batch.Num(), Applying, CalcMaxSpeed, Outputs);
+		}
+	}
+
+
+	void AccelerateAirBatch(const FBhopAccelBatch& Batch, TArray<FBhopAccelOutput>& Outputs)
+	{
+		Outputs.SetNumUninitialized(Batch.Num());
+		const VectorRegister4Float Zero = VectorZeroFloat();
+		const VectorRegister4Float AirSpeedCap = VectorSetFloat1(BHOP_AIR_ACCEL_SPEED_CAP);
+
+		for (int32 i = 0; i < Batch.Num(); i += FBhopAccelBatch::LaneCount)
+		{
+			const VectorRegister4Float DirX = VectorLoadAligned(&Batch.InputDirX[i]);
+			const VectorRegister4Float DirY = VectorLoadAligned(&Batch.InputDirY[i]);
+			const VectorRegister4Float DirZ = VectorLoadAligned(&Batch.InputDirZ[i]);
+			const VectorRegister4Float WalkSpeed = VectorLoadAligned(&Batch.DefaultMaxWalkSpeed[i]);
+
+			// Projection of the velocity along the input direction
+			const VectorRegister4Float Projected = VectorAdd(
+				VectorAdd(VectorMultiply(VectorLoadAligned(&Batch.VelX[i]), DirX), VectorMultiply(VectorLoadAligned(&Batch.VelY[i]), DirY)),
+				VectorMultiply(VectorLoadAligned(&Batch.VelZ[i]), DirZ)
+			);
+			const VectorRegister4Float InputSpeed = LaneLength(VectorMultiply(DirX, WalkSpeed), VectorMultiply(DirY, WalkSpeed), VectorMultiply(DirZ, WalkSpeed));
+			const VectorRegister4Float MaxAccelSpeed = VectorSubtract(VectorMin(VectorMax(InputSpeed, Zero), AirSpeedCap), Projected);
+			const VectorRegister4Float Applying = VectorCompareGT(MaxAccelSpeed, Zero);
+
+			// Accelspeed = clamp(FrameTime * InputSpeed * Accelerate, 0, MaxAccelSpeed)
+			const VectorRegister4Float RawAccel = VectorMultiply(VectorMultiply(VectorLoadAligned(&Batch.FrameTime[i]), InputSpeed), VectorLoadAligned(&Batch.Accelerate[i]));
+			const VectorRegister4Float Accelspeed = VectorMin(VectorMax(RawAccel, Zero), MaxAccelSpeed);
+
+			// |InputDirection * Accelspeed| + |PrevVelocity|
+			const VectorRegister4Float ImpulseSpeed = LaneLength(VectorMultiply(DirX, Accelspeed), VectorMultiply(DirY, Accelspeed), VectorMultiply(DirZ, Accelspeed));
+			const VectorRegister4Float PrevSpeed = LaneLength(VectorLoadAligned(&Batch.PrevVelX[i]), VectorLoadAligned(&Batch.PrevVelY[i]), VectorLoadAligned(&Batch.PrevVelZ[i]));
+
+			const VectorRegister4Float CalcMaxSpeed = VectorMin(VectorMax(VectorAdd(ImpulseSpeed, PrevSpeed), WalkSpeed), VectorLoadAligned(&Batch.MaxSeaDemonSpeed[i]));
+			StoreLanes(i, Batch.Num(), Applying, CalcMaxSpeed, Outputs);
+		}
+	}
+}
+#pragma endregion
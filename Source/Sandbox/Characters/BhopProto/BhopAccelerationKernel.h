@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+	Quake style acceleration kernel for the bhop movement
+
+	This is the math from ABhopCharacter::AccelerateGround and ABhopCharacter::AccelerateAir pulled out into plain functions so that it can be evaluated for more than one character at a time.
+	The scalar functions are what the character uses for itself, and they're the exact same steps the character used to do (double precision vectors, with the speeds stored as floats), so the movement doesn't change.
+	The batch functions run the same steps on four lanes at once with the VectorRegister intrinsics (SSE/NEON depending on the platform). The portable vector layer is four wide, so there's no eight wide path.
+	They're single precision, which is fine for evaluating a lot of characters at once (the movement benchmark commandlet runs every character through both paths), but the results can differ from the scalar path by float rounding.
+
+	The "Sandbox.Movement.AccelKernel" automation test checks the scalar kernel against the original character math, and "Sandbox.Movement.AccelKernelBatch" checks the batch functions against the scalar kernel.
+*/
+
+
+// Cap the amount of acceleration in air from a standstill when under the cap. Without this cap you will accelerate from the standstill up to the max walkspeed
+#define BHOP_AIR_ACCEL_SPEED_CAP 80.f
+
+
+/** The values needed to calculate a single acceleration step */
+struct SANDBOX_API FBhopAccelInput
+{
+	FVector InputDirection = FVector::ZeroVector; // normalized input direction (or zero if no keys are pressed)
+	FVector Velocity = FVector::ZeroVector; // The current velocity of the character
+	FVector PrevVelocity = FVector::ZeroVector; // The velocity saved from the previous frame
+	float FrameTime = 0.f;
+	float DefaultMaxWalkSpeed = 0.f;
+	float Accelerate = 0.f; // GroundAccelerate or AirAccelerate
+	float MaxSeaDemonSpeed = 0.f;
+};
+
+
+/** The result of an acceleration step. CalcMaxSpeed is only valid if we're applying acceleration */
+struct SANDBOX_API FBhopAccelOutput
+{
+	bool bApplyingAccel = false;
+	float CalcMaxSpeed = 0.f;
+};
+
+
+/**
+ * Structure of arrays for evaluating a bunch of characters at once. Each array is padded to a multiple of the lane count so the batch functions never have to handle a remainder.
+ */
+struct SANDBOX_API FBhopAccelBatch
+{
+	static constexpr int32 LaneCount = 4;
+	typedef TArray<float, TAlignedHeapAllocator<16>> FLaneArray;
+
+	FLaneArray InputDirX, InputDirY, InputDirZ;
+	FLaneArray VelX, VelY, VelZ;
+	FLaneArray PrevVelX, PrevVelY, PrevVelZ;
+	FLaneArray FrameTime;
+	FLaneArray DefaultMaxWalkSpeed;
+	FLaneArray Accelerate;
+	FLaneArray MaxSeaDemonSpeed;
+
+	/** Adds a character to the batch (converted to single precision) and returns its index */
+	int32 Add(const FBhopAccelInput& Input);
+	void Reset();
+	FORCEINLINE int32 Num() const { return NumInputs; }
+	FORCEINLINE int32 NumPadded() const { return InputDirX.Num(); }
+
+
+private:
+	int32 NumInputs = 0;
+};
+
+
+namespace BhopAccelKernel
+{
+	/** Scalar ground acceleration (the velocity projection ignores the z axis) */
+	SANDBOX_API FBhopAccelOutput AccelerateGround(const FBhopAccelInput& Input);
+
+	/** Scalar air acceleration */
+	SANDBOX_API FBhopAccelOutput AccelerateAir(const FBhopAccelInput& Input);
+
+	/** Evaluates the ground acceleration for every character in the batch, four at a time. Outputs is resized to Batch.Num() */
+	SANDBOX_API void AccelerateGroundBatch(const FBhopAccelBatch& Batch, TArray<FBhopAccelOutput>& Outputs);
+
+	/** Evaluates the air acceleration for every character in the batch, four at a time. Outputs is resized to Batch.Num() */
+	SANDBOX_API void AccelerateAirBatch(const FBhopAccelBatch& Batch, TArray<FBhopAccelOutput>& Outputs);
+}
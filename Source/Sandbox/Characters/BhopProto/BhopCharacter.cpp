@@ -20,6 +20,7 @@
 #include "Components/CapsuleComponent.h"
 //#include "Components/WidgetComponent.h"
 #include "Components/PrimitiveComponent.h"
+#include "Sandbox/Characters/ProxyInterpolationComponent.h"
 
 // Types
 #include "AI/Navigation/NavigationTypes.h"
@@ -27,6 +28,16 @@
 
 // Bhop Character Movement Component
 #include "BhopCharacterMovementComponent.h"
+#include "BhopAccelerationKernel.h"
+#include "Sandbox/Networking/SandboxNetStats.h"
+#include "Sandbox/Cosmetics/SandboxAudioSubsystem.h"
+#include "BhopProfiler.h"
+#include "Sandbox/Surfaces/SandboxSurfaceGrid.h"
+
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Cache Hits"), STAT_Bhop_FloorCacheHits, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Grid Lookups"), STAT_Bhop_SurfaceGridLookups, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Surface Grid Traces"), STAT_Bhop_SurfaceGridTraces, STATGROUP_Bhop);
 
 
 #pragma region Constructors
@@ -40,16 +51,26 @@ ABhopCharacter::ABhopCharacter(const FObjectInitializer& ObjectInitializer) // T
 	PrimaryActorTick.bCanEverTick = true;
 	SpawnCollisionHandlingMethod = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
 
-	// Create the camera arm
+	// Create the camera arm (on every target, the subobjects have to match the cooked blueprints, the server just doesn't use them)
 	CameraBoom = CreateDefaultSubobject<USpringArmComponent>(TEXT("CameraBoom"));
 	CameraBoom->SetupAttachment(GetMesh()); // Attach this to the mesh because if we attach this to the root, whenever we crouch the springArm/Camera will move along with it, which is not intended
+	CharacterCam = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
+	CharacterCam->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attaches the camera to the camera's spring arm socket
+
+#if SANDBOX_WITH_COSMETICS
 	CameraBoom->TargetArmLength = 200; // Distance from the character
 	CameraBoom->SocketOffset = FVector(0, 74, 74); // Align the camera to the side of the character
 	CameraBoom->bUsePawnControlRotation = true; // Allows us to rotate the camera boom along with our controller when we're adding mouse input
-
-	CharacterCam = CreateDefaultSubobject<UCameraComponent>(TEXT("FollowCamera"));
-	CharacterCam->SetupAttachment(CameraBoom, USpringArmComponent::SocketName); // Attaches the camera to the camera's spring arm socket
 	CharacterCam->bUsePawnControlRotation = false; // The follow camera should use the pawn control rotation as it's attached to the camera boom
+#else
+	// Nobody looks through the camera on the dedicated server, so the arm doesn't tick (or trace for collision), and nothing reads the pose unless it's rendered
+	CameraBoom->PrimaryComponentTick.bStartWithTickEnabled = false;
+	CameraBoom->bDoCollisionTest = false;
+	GetMesh()->VisibilityBasedAnimTickOption = EVisibilityBasedAnimTickOption::OnlyTickMontagesWhenNotRendered;
+#endif
+
+	// Snapshot interpolation for when this is someone else's character
+	ProxyInterpolation = CreateDefaultSubobject<UProxyInterpolationComponent>(TEXT("ProxyInterpolation"));
 
 	// Player collision
 	GetCapsuleComponent()->InitCapsuleSize(42.f, 96.0f);
@@ -74,7 +95,7 @@ ABhopCharacter::ABhopCharacter(const FObjectInitializer& ObjectInitializer) // T
 	MinNetUpdateFrequency = 33.f; // To help with bandwidth and lagginess, allow a minNetUpdateFrequency, which is generally 33 in fps games
 	// The other important value is the server config tick rate, which is in the project defaultEngine.ini -> [/Script/OnlineSubsystemUtils.IpNetDriver] NetServerMaxTickRate = 60
 	// also this which is especially crucial for implementing the gameplay ability system [SystemSettings] net.UseAdaptiveNetUpdateFrequency = 1
-
+	// With bEnableNetPolicy these are scaled with our speed on the server instead (see UpdateNetPolicy)
 }
 
 
@@ -105,14 +126,25 @@ void ABhopCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLi
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps); // Net/UnrealNetwork is required to declare rep lifetimes
 
-	DOREPLIFETIME(ABhopCharacter, InputDirection);
+	// These are push based, so anything that changes them at runtime needs to mark them dirty (see SandboxNetStats.h)
+	FDoRepLifetimeParams PushParams;
+	PushParams.bIsPushBased = true;
 
-	DOREPLIFETIME(ABhopCharacter, FrameTime);
-	DOREPLIFETIME(ABhopCharacter, RampMomentumFactor);
-	DOREPLIFETIME(ABhopCharacter, DefaultMaxWalkSpeed);
-	DOREPLIFETIME(ABhopCharacter, bApplyingBhopCap);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABhopCharacter, InputDirection, PushParams);
+
+	DOREPLIFETIME(ABhopCharacter, FrameTime); // Changes every tick, so it's polled
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABhopCharacter, RampMomentumFactor, PushParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABhopCharacter, DefaultMaxWalkSpeed, PushParams);
+	DOREPLIFETIME_WITH_PARAMS_FAST(ABhopCharacter, bApplyingBhopCap, PushParams);
 	// ImpulseVector
 }
+
+
+void ABhopCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+	SandboxPushModel::MeasureSavedCompares(this);
+}
 #pragma endregion
 
 
@@ -122,6 +154,7 @@ void ABhopCharacter::BeginPlay()
 	Super::BeginPlay();
 
 	InitCharacterMovement();
+	BaseNetCullDistanceSquared = NetCullDistanceSquared;
 }
 
 
@@ -133,6 +166,15 @@ void ABhopCharacter::PostInitializeComponents()
 }
 
 
+void ABhopCharacter::PostNetReceiveLocationAndRotation()
+{
+	// The proxy interpolation places the character from the snapshots (and applies the replicated movement mode), so the movement component doesn't need to smooth (or simulate) anything
+	if (ProxyInterpolation && ProxyInterpolation->ShouldInterpolate() && ProxyInterpolation->AddSnapshotFromReplicatedMovement()) return;
+
+	Super::PostNetReceiveLocationAndRotation();
+}
+
+
 void ABhopCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
@@ -141,6 +183,13 @@ void ABhopCharacter::Tick(float DeltaTime)
 	FrameTime = DeltaTime;
 	PrevVelocity = GetVelocity();
 	XYspeedometer = PrevVelocity.Length();
+	FBhopFloorQueryCounters::Get().CharacterFrames++;
+
+	// Scale our replication with how fast we're going
+	if (bEnableNetPolicy && HasAuthority()) UpdateNetPolicy();
+
+	// Sample the ghost after we've moved this frame
+	if (GhostRecorder) GhostRecorder->Tick(DeltaTime, GetActorLocation(), GetBaseAimRotation());
 	//UE_LOG(LogTemp, Warning, TEXT("Time: %f, Tick::PrevVel: %s"), UKismetSystemLibrary::GetGameTimeInSeconds(this), *PrevVelocity.ToCompactString());
 }
 #pragma endregion
@@ -154,6 +203,7 @@ void ABhopCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8
 
 	// Debugging (print the movement mode information)
 	const EMovementMode NewMovementMode = CachedCharacterMovement->MovementMode;
+	if (GhostRecorder) GhostRecorder->SetMovementMode(NewMovementMode);
 	const UEnum* MovementModeEnum = FindObject<UEnum>(ANY_PACKAGE, TEXT("EMovementMode"));
 	UE_LOG(LogTemp, Warning, TEXT("CharacterName: %s, Movement mode: %s, Prev Monke mode: %s")
 		, *GetNameSafe(this)
@@ -164,27 +214,11 @@ void ABhopCharacter::OnMovementModeChanged(EMovementMode PrevMovementMode, uint8
 	// if we're in the Walking state
 	if (NewMovementMode == EMovementMode::MOVE_Walking)
 	{
-		// Is the landing sound not on cooldown?
-		if ( !(LandingSoundCooldownTotal > UKismetSystemLibrary::GetGameTimeInSeconds(this)) )
-		{
-			// Calculate the impact speed for which sound to play (the leg crack or the land hop)
-			if (GetCharacterMovement())
-			{
-				// We need to get the Z velocity when we are walking up ramps. Regular get velocity function shows 0 when walking so cannot be used.
-				// TODO: Implement condition bhop sound based on z velocity impulse
-				if (LegBonkSound) UGameplayStatics::PlaySoundAtLocation(this, LegBonkSound, GetActorLocation());
-			}
-		}
-
-		// Set the land sound cooldown variable to be up to date with the game time
-		LandingSoundCooldownTotal = LandSoundCooldown + UKismetSystemLibrary::GetGameTimeInSeconds(this);
+		// The velocity's z is already zeroed when we land, so the impact speed comes from last frame's velocity
+		EmitCosmeticEvent(EBhopCosmeticEvent::Land, FMath::Max(-PrevVelocity.Z, 0.f));
 
-		// bhop easy mode (good for ue debugging)
-		if (bEnablePogo && bJumpPressed)
-		{
-			BhopAndTrimpLogic();
-		}
-		else
+		// bhop easy mode (pogo) and the jump buffer are handled by the movement component on landing (UBhopCharacterMovementComponent::SetPostLandedPhysics), we're already back in the air if it hops
+		if (!GetBhopCharacterMovement() || !GetBhopCharacterMovement()->IsHoppingOnLanding())
 		{
 			// time window upon landing before friction applied (frame delay allows maintaining speed while bhopping) Increasing this delay more than a few frames may result in undesired effects.Default = 1 frame
 			FLatentActionInfo StuffTodoOnComplete; // https://www.reddit.com/r/unrealengine/comments/b1t1d8/how_to_wait_for/
@@ -207,11 +241,11 @@ void ABhopCharacter::BhopAndTrimpLogic()
 
 	bool handleJumpAndBhopCap = false;
 
-	// play sound if jump sound is not on cooldown
+	// play sound if jump sound is not on cooldown (the listeners play it)
 	if (JumpSoundCooldownTotal < UKismetSystemLibrary::GetGameTimeInSeconds(this))
 	{
 		Jump();
-		if (JumpSound) UGameplayStatics::PlaySoundAtLocation(this, JumpSound, GetActorLocation());
+		EmitCosmeticEvent(EBhopCosmeticEvent::Jump);
 		handleJumpAndBhopCap = true;
 	}
 	else if (GetCharacterMovement() && GetCharacterMovement()->IsWalking())
@@ -234,40 +268,103 @@ void ABhopCharacter::BhopAndTrimpLogic()
 }
 
 
+void ABhopCharacter::OnLandingHop()
+{
+	// The same jump sound a manual jump plays, only for the player that pressed it (the input only runs on their machine too)
+	if (!IsLocallyControlled()) return;
+
+	const float GameTime = UKismetSystemLibrary::GetGameTimeInSeconds(this);
+	if (JumpSoundCooldownTotal < GameTime) EmitCosmeticEvent(EBhopCosmeticEvent::Jump);
+	JumpSoundCooldownTotal = JumpSoundCooldown + GameTime;
+}
+
+
+void ABhopCharacter::EmitCosmeticEvent(EBhopCosmeticEvent Type, float Speed)
+{
+#if SANDBOX_WITH_COSMETICS
+	// The dedicated server doesn't have any listeners (this catches the editor's dedicated server, the server target compiles this out)
+	if (GetNetMode() == NM_DedicatedServer) return;
+
+	FBhopCosmeticEvent Event;
+	Event.Type = Type;
+	Event.Location = GetActorLocation();
+	Event.Speed = Speed;
+	HandleCosmeticEvent(Event);
+#endif
+}
+
+
+#if SANDBOX_WITH_COSMETICS
+void ABhopCharacter::HandleCosmeticEvent(const FBhopCosmeticEvent& Event)
+{
+	USandboxAudioSubsystem* AudioSubsystem = GetWorld() ? GetWorld()->GetSubsystem<USandboxAudioSubsystem>() : nullptr;
+	const float GameTime = UKismetSystemLibrary::GetGameTimeInSeconds(this);
+
+	if (Event.Type == EBhopCosmeticEvent::Land)
+	{
+		// Is the landing sound not on cooldown?
+		if (!(LandingSoundCooldownTotal > GameTime))
+		{
+			// Calculate the impact speed for which sound to play (the leg crack past LegBreakThreshold jumps worth of speed, otherwise the land hop)
+			USoundCue* LandSound = Event.Speed > LegBreakThreshold * DefaultJumpVelocity ? LegBonkSound : JumpLandSound;
+			if (AudioSubsystem && LandSound) AudioSubsystem->PlaySoundAtLocation(LandSound, Event.Location);
+		}
+
+		// Set the land sound cooldown variable to be up to date with the game time
+		LandingSoundCooldownTotal = LandSoundCooldown + GameTime;
+	}
+	else if (Event.Type == EBhopCosmeticEvent::Jump)
+	{
+		// The jump decides whether the sound is off cooldown (it also gates the jump, see BhopAndTrimpLogic)
+		if (AudioSubsystem && JumpSound) AudioSubsystem->PlaySoundAtLocation(JumpSound, Event.Location);
+	}
+}
+#endif
+
+
 #pragma region Apply Trimp
-void ABhopCharacter::ApplyTrimp()
+FVector ABhopCharacter::CalcTrimpImpulse(float GroundDot, const FVector& Velocity) const
 {
+	const float Speed = Velocity.Length();
+
 	// Indicates down sloping ramp
-	if (RampCheckGroundAngleDotproduct > 0.05f) // Downward trimp logic
+	if (GroundDot > 0.05f) // Downward trimp logic
 	{
 		// limit the amount of vertical reduction when jumping down ramps to ensure we can always jump
 		float ReduceJumpHeightZ = FMath::Clamp(
-			(RampCheckGroundAngleDotproduct * (-1.f / TrimpDownMultiplier) * XYspeedometer),
+			(GroundDot * (-1.f / TrimpDownMultiplier) * Speed),
 			TrimpDownVertCap * DefaultJumpVelocity * -1,
 			0.f
 		);
 		FVector ReduceJumpHeight = FVector(0.f, 0.f, ReduceJumpHeightZ);
 
 		// Combine the vertical and lateral impulses
-		TrimpImpulse = UKismetMathLibrary::Add_VectorVector(
-			UKismetMathLibrary::Multiply_VectorFloat(PrevVelocity, RampCheckGroundAngleDotproduct * TrimpDownMultiplier), // Add lateral speed
+		return UKismetMathLibrary::Add_VectorVector(
+			UKismetMathLibrary::Multiply_VectorFloat(Velocity, GroundDot * TrimpDownMultiplier), // Add lateral speed
 			ReduceJumpHeight
 		);
 	}
-	else if (RampCheckGroundAngleDotproduct < -0.05f) // Upward trimp logic
+	else if (GroundDot < -0.05f) // Upward trimp logic
 	{
 		// determine how much lateral speed to reduce when jumping up ramp
-		FVector ReduceJumpHeight = FVector(0.f, 0.f, RampCheckGroundAngleDotproduct * TrimpUpMultiplier * XYspeedometer);
+		FVector ReduceJumpHeight = FVector(0.f, 0.f, GroundDot * TrimpUpMultiplier * Speed);
 
-		TrimpImpulse = UKismetMathLibrary::Add_VectorVector(
-			UKismetMathLibrary::Multiply_VectorFloat(PrevVelocity, TrimpUpLateralSlow * RampCheckGroundAngleDotproduct),
+		return UKismetMathLibrary::Add_VectorVector(
+			UKismetMathLibrary::Multiply_VectorFloat(Velocity, TrimpUpLateralSlow * GroundDot),
 			ReduceJumpHeight
 		);
 	}
-	else // Neutral trimp logic
-	{
-		TrimpImpulse = FVector::Zero();
-	}
+
+	// Neutral trimp logic
+	return FVector::Zero();
+}
+
+
+void ABhopCharacter::ApplyTrimp()
+{
+	BHOP_PROFILE_SCOPE(ApplyTrimp);
+
+	TrimpImpulse = CalcTrimpImpulse(RampCheckGroundAngleDotproduct, PrevVelocity);
 
 	// Set trimp lateral impulse
 	TrimpLateralImpulse = FVector(TrimpImpulse.X, TrimpImpulse.Y, 0.f).Length() + XYspeedometer;
@@ -300,7 +397,7 @@ void ABhopCharacter::ApplyBhopCap()
 
 		// predict our new speed after reduction
 		bhopCapNewSpeed = SpeedOverCap + BhopCapSpeed;
-		bApplyingBhopCap = true;
+		SANDBOX_COMPARE_ASSIGN_AND_MARK_DIRTY(ABhopCharacter, bApplyingBhopCap, true, this);
 		BhopCapVector = UKismetMathLibrary::Multiply_VectorFloat(PrevVelocity.GetSafeNormal(), SpeedOverCap);
 
 		// [Not used for multiplayer] apply impulse in opposite direction of our movement
@@ -309,7 +406,7 @@ void ABhopCharacter::ApplyBhopCap()
 	}
 	else
 	{
-		bApplyingBhopCap = false;
+		SANDBOX_COMPARE_ASSIGN_AND_MARK_DIRTY(ABhopCharacter, bApplyingBhopCap, false, this);
 	}
 
 	// Apply the bhop cap
@@ -365,28 +462,66 @@ bool ABhopCharacter::RamSlide()
 // Check if the surface (ramp) is a slideable ramp (surface angle < 90 degress)
 bool ABhopCharacter::RampCheck()
 {
+	BHOP_PROFILE_SCOPE(RampCheck);
+
 	UWorld* World = GetWorld();
 	if (World)
 	{
-		// Trace a line from the actor to the ground
-		FHitResult BreakHitResult;
-		FCollisionQueryParams CollisionParams;
-		CollisionParams.AddIgnoredActor(this);
-		World->LineTraceSingleByChannel(
-			BreakHitResult,
-			GetActorLocation(),
-			GetActorLocation() - UKismetMathLibrary::Multiply_VectorFloat(GetActorUpVector(), 100.f),
-			ECollisionChannel::ECC_Visibility,
-			CollisionParams
-		);
+		// The movement component already found the floor on its last step, then the baked surface grid answers this for the static level geometry, and everything else still traces
+		FBhopFloorQueryCounters& FloorCounters = FBhopFloorQueryCounters::Get();
+		FVector GroundNormal = FVector::ZeroVector;
+		EBhopSurfaceFlags SurfaceFlags = EBhopSurfaceFlags::None;
+		bool bBakedSurface = false;
+		const USandboxSurfaceGridSubsystem* SurfaceGrid = World->GetSubsystem<USandboxSurfaceGridSubsystem>();
+		if (GetBhopCharacterMovement() && GetBhopCharacterMovement()->HasFreshFloor())
+		{
+			GroundNormal = GetBhopCharacterMovement()->GetFloorCache().Normal;
+			FloorCounters.CacheHits++;
+			INC_DWORD_STAT(STAT_Bhop_FloorCacheHits);
+		}
+		else if (SurfaceGrid && SurfaceGrid->FindSurface(GetActorLocation(), 100.f, GroundNormal, SurfaceFlags))
+		{
+			bBakedSurface = true;
+			FloorCounters.GridLookups++;
+			INC_DWORD_STAT(STAT_Bhop_SurfaceGridLookups);
+		}
+		else
+		{
+			FloorCounters.Traces++;
+			INC_DWORD_STAT(STAT_Bhop_SurfaceGridTraces);
+
+			// Trace a line from the actor to the ground
+			FHitResult BreakHitResult;
+			FCollisionQueryParams CollisionParams;
+			CollisionParams.AddIgnoredActor(this);
+			World->LineTraceSingleByChannel(
+				BreakHitResult,
+				GetActorLocation(),
+				GetActorLocation() - UKismetMathLibrary::Multiply_VectorFloat(GetActorUpVector(), 100.f),
+				ECollisionChannel::ECC_Visibility,
+				CollisionParams
+			);
+			GroundNormal = BreakHitResult.ImpactNormal;
+		}
+
+		// The baked surfaces were classified from the full precision normal, so a flat one is never a ramp (and can't trimp) no matter how its normal was quantized
+		if (bBakedSurface && !EnumHasAnyFlags(SurfaceFlags, EBhopSurfaceFlags::Slope))
+		{
+			RampCheckGroundAngleDotproduct = 0.f;
+			return false;
+		}
 
 		// get the normalized vectors of the previous and current directions we're traveling on the xy plane to find out whether we're sloping up or down a hill
-		RampCheckGroundAngleDotproduct = FVector::DotProduct(BreakHitResult.ImpactNormal, PrevVelocity.GetSafeNormal(0.0001));
-		float AngleOfRamp = UKismetMathLibrary::DegAcos(RampCheckGroundAngleDotproduct);
-		//UE_LOG(LogTemp, Warning, TEXT("RampCheck::GroundAngleDotproduct: %f, angle of ramp: %f \n"), RampCheckGroundAngleDotproduct, AngleOfRamp - 90.f);
+		RampCheckGroundAngleDotproduct = FVector::DotProduct(GroundNormal, PrevVelocity.GetSafeNormal(0.0001));
+		//UE_LOG(LogTemp, Warning, TEXT("RampCheck::GroundAngleDotproduct: %f, angle of ramp: %f \n"), RampCheckGroundAngleDotproduct, UKismetMathLibrary::DegAcos(RampCheckGroundAngleDotproduct) - 90.f);
 
-		// Check if the angle is greater than 2 degrees (90 is a flat surface)
-		if (AngleOfRamp > 92.f) return true;
+		// Check if the angle is greater than 2 degrees (90 is a flat surface), acos(dot) > 92 is the same as dot < cos(92)
+		static const float RampDotThreshold = FMath::Cos(FMath::DegreesToRadians(92.f));
+		const bool bRamp = RampCheckGroundAngleDotproduct < RampDotThreshold;
+
+		// A slope that's too shallow to trimp off doesn't give ApplyTrimp an angle to work with
+		if (bBakedSurface && !EnumHasAnyFlags(SurfaceFlags, EBhopSurfaceFlags::Trimp)) RampCheckGroundAngleDotproduct = 0.f;
+		if (bRamp) return true;
 	}
 
 	return false;
@@ -398,32 +533,25 @@ bool ABhopCharacter::RampCheck()
 #pragma region Acceleration Functions
 void ABhopCharacter::AccelerateGround()
 {
+	BHOP_PROFILE_SCOPE(AccelerateGround);
+
 	// normalized vector indicating the desired movement direction based on the currently pressed keys
 	FVector RawInputDirection = UKismetMathLibrary::Multiply_VectorFloat(InputForwardVector, InputForwardAxis) + UKismetMathLibrary::Multiply_VectorFloat(InputSideVector, InputSideAxis);
-	InputDirection = RawInputDirection.GetSafeNormal(0.0001f); 
-
-	// Takes the projection of the current velocity along the input direction - this is used to allow some acceleration to take place when turning in the same direction of strafe
-	float ProjectedVelocity = FVector::DotProduct(FVector(GetVelocity().X, GetVelocity().Y, 0.f), InputDirection);
-
-	// Take the length of our input vector (desired input speed)
-	float InputSpeed = UKismetMathLibrary::Multiply_VectorFloat(InputDirection, DefaultMaxWalkSpeed).Length();
+	const FVector NewInputDirection = RawInputDirection.GetSafeNormal(0.0001f);
+	SANDBOX_COMPARE_ASSIGN_AND_MARK_DIRTY(ABhopCharacter, InputDirection, NewInputDirection, this);
 
-	// When a movement key is pressed we subtract the velocity projection from the accel speed cap to set a max acceleration value
-	float MaxAccelSpeed = InputSpeed - ProjectedVelocity;
+	// The projection, acceleration clamp and new max walk speed are calculated in the acceleration kernel (see BhopAccelerationKernel.h)
+	const FBhopAccelOutput Accel = BhopAccelKernel::AccelerateGround(MakeAccelInput(GroundAccelerate));
 
 	// Applying acceleration?
-	if (MaxAccelSpeed > 0.f)
+	if (Accel.bApplyingAccel)
 	{
 		bApplyingGroundAccel = true;
-		float Accelspeed = FMath::Clamp((FrameTime * InputSpeed * GroundAccelerate), 0.f, MaxAccelSpeed);
-
-		// Calculate the impulse we will apply for acceleration
-		FVector ImpulseVector = UKismetMathLibrary::Multiply_VectorFloat(InputDirection, Accelspeed);
 		GroundAccelDir = InputDirection;
 
 		// Determine what new maxWalkSpeed should be to allow acceleration impulses to take effect
 		// Also the clamp is to prevent the default maxWalkSpeed from being set less than the normal walking speed
-		CalcMaxWalkSpeed = FMath::Clamp(UKismetMathLibrary::Add_VectorVector(PrevVelocity, ImpulseVector).Length(), DefaultMaxWalkSpeed, MaxSeaDemonSpeed);
+		CalcMaxWalkSpeed = Accel.CalcMaxSpeed;
 	}
 	else
 	{
@@ -440,34 +568,24 @@ void ABhopCharacter::AccelerateGround()
 
 void ABhopCharacter::AccelerateAir()
 {
+	BHOP_PROFILE_SCOPE(AccelerateAir);
+
 	// normalized vector indicating the desired movement direction based on the currently pressed keys
 	FVector RawInputDirection = UKismetMathLibrary::Multiply_VectorFloat(InputForwardVector, InputForwardAxis) + UKismetMathLibrary::Multiply_VectorFloat(InputSideVector, InputSideAxis);
-	InputDirection = RawInputDirection.GetSafeNormal(0.0001f);
-
-	// Takes the projection of the current velocity along the input direction - this is used to allow some acceleration to take place when turning in the same direction of strafe
-	float ProjectedVelocity = FVector::DotProduct(GetVelocity(), InputDirection);
-
-	// Take the length of our input vector (desired input speed)
-	float InputSpeed = UKismetMathLibrary::Multiply_VectorFloat(InputDirection, DefaultMaxWalkSpeed).Length();
+	const FVector NewInputDirection = RawInputDirection.GetSafeNormal(0.0001f);
+	SANDBOX_COMPARE_ASSIGN_AND_MARK_DIRTY(ABhopCharacter, InputDirection, NewInputDirection, this);
 
-	// Cap the amount of acceleration in air from a standstill when under the cap. Without this cap you will accelerate from the standstill up to the max walkspeed
-	float AccelSpeedCap = 80.f;
-
-	// When a movement key is pressed we subtract the velocity projection from the accel speed cap to set a max acceleration value
-	float MaxAccelSpeed = FMath::Clamp(InputSpeed, 0.f, AccelSpeedCap) - ProjectedVelocity;
+	// Same as the ground acceleration, except the projection uses the z velocity and acceleration from a standstill is capped (BHOP_AIR_ACCEL_SPEED_CAP)
+	const FBhopAccelOutput Accel = BhopAccelKernel::AccelerateAir(MakeAccelInput(AirAccelerate));
 
 	// Applying acceleration?
-	if (MaxAccelSpeed > 0.f)
+	if (Accel.bApplyingAccel)
 	{
 		bApplyingAirAccel = true;
-		float Accelspeed = FMath::Clamp((FrameTime * InputSpeed * AirAccelerate), 0.f, MaxAccelSpeed);
-
-		// Calculate the impulse we will apply for acceleration
-		FVector ImpulseVector = UKismetMathLibrary::Multiply_VectorFloat(InputDirection, Accelspeed);
 		AirAccelDir = InputDirection;
 
 		// prevent the default maxWalkSpeed from being set less than the normal walking speed
-		CalcMaxAirSpeed = FMath::Clamp(ImpulseVector.Length() + PrevVelocity.Length(), DefaultMaxWalkSpeed, MaxSeaDemonSpeed);
+		CalcMaxAirSpeed = Accel.CalcMaxSpeed;
 	}
 	else
 	{
@@ -480,12 +598,28 @@ void ABhopCharacter::AccelerateAir()
 	//GetCharacterMovement()->MaxWalkSpeed = CalcMaxWalkSpeed;
 	AddMovementInput(AirAccelDir); // add movement input node must be used for proper multiplayer replication as it utilizes predictionand network history.
 }
+
+
+FBhopAccelInput ABhopCharacter::MakeAccelInput(float Accelerate) const
+{
+	FBhopAccelInput Input;
+	Input.InputDirection = InputDirection;
+	Input.Velocity = GetVelocity();
+	Input.PrevVelocity = PrevVelocity;
+	Input.FrameTime = FrameTime;
+	Input.DefaultMaxWalkSpeed = DefaultMaxWalkSpeed;
+	Input.Accelerate = Accelerate;
+	Input.MaxSeaDemonSpeed = MaxSeaDemonSpeed;
+	return Input;
+}
 #pragma endregion
 
 
 #pragma region Movement Logic
 void ABhopCharacter::HandleMovement()
 {
+	BHOP_PROFILE_SCOPE(HandleMovement);
+
 	if (!GetWorld()) return;
 
 	if (CachedCharacterMovement->IsFalling()) // In air
@@ -590,7 +724,9 @@ void ABhopCharacter::StartJump()
 {
 	Jump();
 
-	bJumpPressed = true;
+	// The jump buffer and auto hop read this through the compressed flags
+	if (GetBhopCharacterMovement()) GetBhopCharacterMovement()->JumpPressed();
+
 	// Are we walking when we press jump? (this prevents jump sound spamming when pressing jump key in midair)
 	if (GetCharacterMovement() && GetCharacterMovement()->IsWalking())
 	{
@@ -602,11 +738,25 @@ void ABhopCharacter::StartJump()
 
 void ABhopCharacter::StopJump()
 {
-	bJumpPressed = false;
+	if (GetBhopCharacterMovement()) GetBhopCharacterMovement()->JumpReleased();
 	StopJumping();
 }
 
 
+void ABhopCharacter::ApplyScriptedInput(float ForwardAxis, float RightAxis, bool bJumpHeld)
+{
+	MoveForward(ForwardAxis);
+	MoveRight(RightAxis);
+
+	if (bJumpHeld != bScriptedJumpHeld)
+	{
+		bScriptedJumpHeld = bJumpHeld;
+		if (bJumpHeld) StartJump();
+		else StopJump();
+	}
+}
+
+
 void ABhopCharacter::Turn(float Value)
 {
 	AddControllerYawInput(Value);
@@ -655,12 +805,59 @@ void ABhopCharacter::UnEquipButtonPress()
 
 
 
+#pragma region Network relevancy
+void ABhopCharacter::UpdateNetPolicy()
+{
+	// The adaptive net update frequency will still throttle between these when nothing changes
+	NetUpdateFrequency = BhopNetPolicy::GetUpdateFrequency(NetPolicy, XYspeedometer);
+	MinNetUpdateFrequency = FMath::Min(NetPolicy.MinUpdateFrequency, NetUpdateFrequency);
+
+	// Become relevant earlier the faster we're moving
+	NetCullDistanceSquared = BhopNetPolicy::GetCullDistanceSquared(NetPolicy, BaseNetCullDistanceSquared, XYspeedometer);
+}
+
+
+float ABhopCharacter::GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, AActor* Viewer, AActor* ViewTarget, UActorChannel* InChannel, float Time, bool bLowBandwidth)
+{
+	const float Priority = Super::GetNetPriority(ViewPos, ViewDir, Viewer, ViewTarget, InChannel, Time, bLowBandwidth);
+	if (!bEnableNetPolicy) return Priority;
+
+	// Bias towards the players whose error is growing the fastest for this viewer
+	return Priority * BhopNetPolicy::GetPriorityScale(NetPolicy, GetActorLocation(), GetVelocity(), ViewPos, ViewDir);
+}
+#pragma endregion
+
+
+#pragma region Ghost Recording
+void ABhopCharacter::StartGhostRecording()
+{
+	InitCharacterMovement();
+	GhostRecorder = MakeUnique<FBhopGhostRecorder>(GhostSampleRate);
+	GhostRecorder->Start(GetActorLocation(), GetBaseAimRotation(), CachedCharacterMovement ? CachedCharacterMovement->MovementMode.GetValue() : MOVE_Walking);
+}
+
+
+bool ABhopCharacter::StopGhostRecording(const FString& Filename)
+{
+	if (!GhostRecorder) return false;
+
+	const bool bSaved = GhostRecorder->Save(Filename);
+	UE_LOG(LogTemp, Log, TEXT("%s: Recorded a ghost of %d frames in %d bytes"), *GetNameSafe(this), GhostRecorder->GetNumFrames(), GhostRecorder->GetNumBytes());
+	GhostRecorder.Reset();
+	return bSaved;
+}
+#pragma endregion
+
+
 #pragma region Getters and Setters
 void ABhopCharacter::InitCharacterMovement()
 {
 	// Get the character movement component
 	CachedCharacterMovement = GetCharacterMovement();
 	if (CachedCharacterMovement == nullptr) UE_LOG(LogTemp, Error, TEXT("ERROR: Character movement component not found, exiting OnMovementModeChanged!"));
+
+	// Pogo is an auto hop on the movement component so that it's predicted (this runs on both the server and the client)
+	if (GetBhopCharacterMovement()) GetBhopCharacterMovement()->bEnableAutoHop = bEnablePogo;
 }
 
 
@@ -682,6 +879,7 @@ inline float ABhopCharacter::GetFriction()
 
 void ABhopCharacter::PrintToScreen(FColor color, FString message)
 {
+#if SANDBOX_WITH_COSMETICS
 	if (DebugCharacterName == 0) // Server
 	{
 		if (HasAuthority() && IsLocallyControlled())
@@ -696,6 +894,7 @@ void ABhopCharacter::PrintToScreen(FColor color, FString message)
 			UE_LOG(LogTemp, Warning, TEXT("client:: %s"), *GetNameSafe(this), *message);
 		}
 	}
+#endif
 }
 
 
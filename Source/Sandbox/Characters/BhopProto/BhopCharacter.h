@@ -4,6 +4,9 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "BhopNetPolicy.h"
+#include "Sandbox/Cosmetics/SandboxCosmeticEvents.h"
+#include "Sandbox/Ghosts/BhopGhostFormat.h"
 
 #include "BhopCharacter.generated.h"
 
@@ -23,7 +26,10 @@ public:
 	virtual void Tick(float DeltaTime) override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 	virtual void PostInitializeComponents() override;
+	virtual void PostNetReceiveLocationAndRotation() override; // Simulated proxies send the replicated transform to the proxy interpolation instead of the movement component's smoothing
+	virtual float GetNetPriority(const FVector& ViewPos, const FVector& ViewDir, class AActor* Viewer, AActor* ViewTarget, class UActorChannel* InChannel, float Time, bool bLowBandwidth) override;
 	//virtual void Destroyed() override; // This is a replicated function, handle logic pertaining to character death in here for free
 
 	//virtual void OnRep_ReplicatedMovement() override; // overriding this to replicate simulated proxies movement: https://www.udemy.com/course/unreal-engine-5-cpp-multiplayer-shooter/learn/lecture/31515548#questions
@@ -39,6 +45,8 @@ private:
 		class USpringArmComponent* CameraBoom;
 	UPROPERTY(VisibleAnywhere, Category = "Camera")
 		class UCameraComponent* CharacterCam;
+	UPROPERTY(VisibleAnywhere, Category = "Network")
+		class UProxyInterpolationComponent* ProxyInterpolation;
 
 	
 //////////////////////////////////////////////////////////////////////////
@@ -60,10 +68,21 @@ protected:
 	void EquipButtonPress();
 	void UnEquipButtonPress();
 
+public:
+	/** Feeds the same input the player bindings would (benchmarks and bots), the jump is pressed and released when bJumpHeld changes */
+	void ApplyScriptedInput(float ForwardAxis, float RightAxis, bool bJumpHeld);
+
+	/** The trimp impulse for a jump moving at Velocity, GroundDot is the ground normal dotted with the direction we're moving (see RampCheck) */
+	FVector CalcTrimpImpulse(float GroundDot, const FVector& Velocity) const;
+
+	/** Called by the movement component when it hops on the move we land (buffered jump or auto hop), plays the jump cosmetics */
+	void OnLandingHop();
+
 
 private:
 	UPROPERTY()
 		bool bIsSprinting = false;
+	bool bScriptedJumpHeld = false;
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -87,6 +106,13 @@ private:
 	UPROPERTY(EditAnywhere, Category = "Audio")
 		class USoundCue* JumpSound;
 
+	/** Sends a cosmetic event (jump and landing audio) to the listeners on this machine, nothing listens on a dedicated server */
+	void EmitCosmeticEvent(EBhopCosmeticEvent Type, float Speed = 0.f);
+#if SANDBOX_WITH_COSMETICS
+	/** Plays the audio for a cosmetic event, and handles the landing sound cooldown */
+	void HandleCosmeticEvent(const FBhopCosmeticEvent& Event);
+#endif
+
 
 
 	UFUNCTION() void AccelerateGround();
@@ -139,8 +165,6 @@ private:
 		FVector InputSideVector = FVector::Zero();
 	UPROPERTY(VisibleAnywhere, Category = "Bhop_Analysis")
 		float InputSideAxis = 0.f;
-	UPROPERTY(VisibleAnywhere, Category = "Bhop_Analysis")
-		bool bJumpPressed = false;
 	UPROPERTY(VisibleAnywhere, Category = "Bhop_Analysis")
 		bool bIsRampSliding = false;
 	UPROPERTY(VisibleAnywhere, Category = "Bhop_Analysis")
@@ -166,7 +190,7 @@ private:
 		float AirAccelerate = 10.f;
 
 	UPROPERTY(EditAnywhere, Category = "Bhop_Bhop")
-		bool bEnablePogo = false; // This is buggy, and is not reliable in multiplayer. Tldr, work on it
+		bool bEnablePogo = false; // Hop on landing while the jump key is held (this is forwarded to the movement component's auto hop)
 	UPROPERTY(EditAnywhere, Category = "Bhop_Bhop")
 		bool bEnableBunnyHopCap = false;
 	UPROPERTY(EditAnywhere, Category = "Bhop_Bhop") // you monster frisbee
@@ -234,6 +258,33 @@ private:
 		uint32 DebugCharacterName = 0;
 
 
+	// Network relevancy and priority (see BhopNetPolicy.h)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network") // Scale the update frequency, priority and relevancy with our speed instead of using the flat NetUpdateFrequency
+		bool bEnableNetPolicy = true;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network")
+		FBhopNetPolicySettings NetPolicy;
+	UPROPERTY() // The relevancy distance when standing still
+		float BaseNetCullDistanceSquared = 0.f;
+
+	/** Updates the update frequency and relevancy distance from the current speed (server only) */
+	void UpdateNetPolicy();
+
+
+	// Ghost recording (see BhopGhostFormat.h)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Ghost") // How many frames a second the ghost is sampled at
+		float GhostSampleRate = 30.f;
+	TUniquePtr<FBhopGhostRecorder> GhostRecorder;
+
+public:
+	/** Starts recording a ghost from where we are, the frames are sampled in Tick */
+	void StartGhostRecording();
+
+	/** Stops recording and writes the ghost, returns false if there was nothing to save */
+	bool StopGhostRecording(const FString& Filename);
+
+	FORCEINLINE bool IsRecordingGhost() const { return GhostRecorder.IsValid(); }
+
+
 public:
 	/** Returns CharacterMovement subobject **/
 	FORCEINLINE class UBhopCharacterMovementComponent* GetBhopCharacterMovement() const { return BhopCharacterMovement; }
@@ -249,7 +300,15 @@ public:
 //////////////////////////////////////////////////////////////////////////
 public:
 	void InitCharacterMovement();
-	FORCEINLINE float GetSpeedometer() { return XYspeedometer; };
+	FORCEINLINE float GetSpeedometer() const { return XYspeedometer; };
+	FORCEINLINE bool IsNetPolicyEnabled() const { return bEnableNetPolicy; }
+	FORCEINLINE const FBhopNetPolicySettings& GetNetPolicy() const { return NetPolicy; }
+	FORCEINLINE float GetBaseNetCullDistanceSquared() const { return BaseNetCullDistanceSquared; }
+	FORCEINLINE float GetGroundAccelerate() const { return GroundAccelerate; }
+	FORCEINLINE float GetAirAccelerate() const { return AirAccelerate; }
+	FORCEINLINE float GetBaseMaxWalkSpeed() const { return DefaultMaxWalkSpeed; } // The input speed the acceleration kernel uses
+	FORCEINLINE float GetMaxSeaDemonSpeed() const { return MaxSeaDemonSpeed; }
+	struct FBhopAccelInput MakeAccelInput(float Accelerate) const; // Packs the current bhop values for the acceleration kernel (batched callers add this to an FBhopAccelBatch)
 	float GetDefaultMaxWalkSpeed();
 	float GetFriction();
 	void PrintToScreen(FColor color, FString message);
@@ -3,6 +3,36 @@
 
 #include "BhopCharacterMovementComponent.h"
 #include "GameFramework/Character.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "Engine/NetConnection.h"
+#include "Engine/Player.h"
+#include "HAL/IConsoleManager.h"
+#include "BhopProfiler.h"
+#include "BhopMoveEnvelope.h"
+#include "BhopCharacter.h"
+#include "Sandbox/Networking/SandboxServerMoveSubsystem.h"
+#include "Sandbox/SandboxMemory.h"
+#include "Sandbox/Checkpoints/SandboxCheckpointSubsystem.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Envelope Accepted Moves"), STAT_Bhop_EnvelopeAccepted, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Envelope Audited Moves"), STAT_Bhop_EnvelopeAudited, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Envelope Violations"), STAT_Bhop_EnvelopeViolations, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Floor Queries"), STAT_Bhop_FloorQueries, STATGROUP_Bhop);
+
+static bool GBhopFloorCacheEnabled = true;
+static FAutoConsoleVariableRef CVarBhopFloorCacheEnabled(
+	TEXT("Sandbox.FloorCache.Enable"),
+	GBhopFloorCacheEnabled,
+	TEXT("Whether the bhop logic uses the movement component's floor instead of tracing for it (compare the queries with Sandbox.FloorCache.Stats)")
+);
+
+static bool GBhopOverlapPolicyEnabled = true;
+static FAutoConsoleVariableRef CVarBhopOverlapPolicyEnabled(
+	TEXT("Sandbox.OverlapPolicy.Enable"),
+	GBhopOverlapPolicyEnabled,
+	TEXT("Whether the bhop characters with an overlap policy replace their capsule's overlap updates with the policy's query (see BhopOverlapPolicy.h)")
+);
 
 // CMC network breakdown
 // First on tick the perform move function is called, which executes all the movement logic
@@ -48,8 +78,14 @@ bool UBhopCharacterMovementComponent::FSavedMove_Bhop::CanCombineWith(const FSav
 {
 	FSavedMove_Bhop* NewBhopMove = static_cast<FSavedMove_Bhop*>(NewMove.Get());
 
-	// (Sprinting scenario) Check if was sprinting (if they pressed the sprint button on the client)
-	if (Saved_bWantsToSprnt != NewBhopMove->Saved_bWantsToSprnt)
+	// (Sprinting, jump held, etc.) Check if any of the movement inputs changed (if they pressed a button on the client)
+	if (Saved_MovementInput != NewBhopMove->Saved_MovementInput)
+	{
+		return false;
+	}
+
+	// Jump buffer / auto hop, the landing move has to be sent on its own for the hop to happen at the same time on the server
+	if ((Saved_JumpBufferTimeRemaining > 0.f) != (NewBhopMove->Saved_JumpBufferTimeRemaining > 0.f))
 	{
 		return false;
 	}
@@ -106,7 +142,9 @@ void UBhopCharacterMovementComponent::FSavedMove_Bhop::Clear()
 	FSavedMove_Character::Clear();
 
 	// Reset our logic
-	Saved_bWantsToSprnt = 0;
+	Saved_MovementInput.Clear();
+	Saved_bPrevJumpHeld = 0;
+	Saved_JumpBufferTimeRemaining = 0.f;
 	Saved_BhopMaxWalkSpeed = MAX_WALK_SPEED;
 	Saved_BhopGroundFriction = JUMP_Z_VELOCITY;
 	Saved_BhopJumpZVelocity = GROUND_FRICTION;
@@ -114,13 +152,10 @@ void UBhopCharacterMovementComponent::FSavedMove_Bhop::Clear()
 
 
 // This is the minimal movement information that's sent to the server every frame for replication
+// Our own inputs are sent in the movement input bits of the network move data, so the custom flags are left free
 uint8 UBhopCharacterMovementComponent::FSavedMove_Bhop::GetCompressedFlags() const
 {
-	uint8 Result = Super::GetCompressedFlags(); // Base flags
-
-	if (Saved_bWantsToSprnt) Result |= FLAG_Custom_0; // Flip custom flag 0 (Sprint channel), if is sprinting
-
-	return Result;
+	return Super::GetCompressedFlags(); // Base flags
 }
 
 
@@ -134,7 +169,9 @@ void UBhopCharacterMovementComponent::FSavedMove_Bhop::SetMoveFor(ACharacter* C,
 	UBhopCharacterMovementComponent* CharacterMovement = Cast<UBhopCharacterMovementComponent>(C->GetCharacterMovement());
 	if (CharacterMovement)
 	{
-		Saved_bWantsToSprnt = CharacterMovement->Safe_bWantsToSprnt;
+		Saved_MovementInput = CharacterMovement->GetMovementInput();
+		Saved_bPrevJumpHeld = CharacterMovement->Safe_bPrevJumpHeld;
+		Saved_JumpBufferTimeRemaining = CharacterMovement->Safe_JumpBufferTimeRemaining;
 		Saved_BhopMaxWalkSpeed = CharacterMovement->Safe_BhopMaxWalkSpeed;
 		Saved_BhopGroundFriction = CharacterMovement->Safe_BhopGroundFriction;
 		Saved_BhopJumpZVelocity = CharacterMovement->Safe_BhopJumpZVelocity;
@@ -152,7 +189,9 @@ void UBhopCharacterMovementComponent::FSavedMove_Bhop::PrepMoveFor(ACharacter* C
 	UBhopCharacterMovementComponent* CharacterMovement = Cast<UBhopCharacterMovementComponent>(C->GetCharacterMovement());
 	if (CharacterMovement)
 	{
-		CharacterMovement->Safe_bWantsToSprnt = Saved_bWantsToSprnt;
+		CharacterMovement->ApplyMovementInput(Saved_MovementInput);
+		CharacterMovement->Safe_bPrevJumpHeld = Saved_bPrevJumpHeld;
+		CharacterMovement->Safe_JumpBufferTimeRemaining = Saved_JumpBufferTimeRemaining;
 		CharacterMovement->Safe_BhopMaxWalkSpeed = Saved_BhopMaxWalkSpeed;
 		CharacterMovement->Safe_BhopGroundFriction = Saved_BhopGroundFriction;
 		CharacterMovement->Safe_BhopJumpZVelocity = Saved_BhopJumpZVelocity;
@@ -165,12 +204,26 @@ void UBhopCharacterMovementComponent::FSavedMove_Bhop::PrepMoveFor(ACharacter* C
 // Bhop FNetworkPredicitonData_Client Implementation																															 			 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #pragma region FNetworkPredictionData_Client_Character (Bhop)
-UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter::FNetworkPredictionData_Client_BhopCharacter(const UCharacterMovementComponent& ClientMovement) : Super(ClientMovement) {}
+UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter::FNetworkPredictionData_Client_BhopCharacter(const UCharacterMovementComponent& ClientMovement)
+	: Super(ClientMovement)
+	, MoveArena(MaxSavedMoveCount + MaxFreeMoveCount + 4) // The pending, acked, and a couple of in flight moves
+{
+}
+
+
+UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter::~FNetworkPredictionData_Client_BhopCharacter()
+{
+	// Return the moves to the arena before it's destroyed (the base destructor would do this after our members are gone)
+	SavedMoves.Empty();
+	FreeMoves.Empty();
+	PendingMove = nullptr;
+	LastAckedMove = nullptr;
+}
 
 
 FSavedMovePtr UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter::AllocateNewMove()
 {
-	return FSavedMovePtr(new FSavedMove_Bhop());
+	return MoveArena.Allocate();
 } 
 #pragma endregion
 
@@ -194,6 +247,7 @@ void UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData::ClientFillN
 
 	// Send the bhop specific implementations across the network
 	const FSavedMove_Bhop& BhopClientMove = static_cast<const FSavedMove_Bhop&>(ClientMove);
+	MovementInput = BhopClientMove.Saved_MovementInput;
 	Saved_BhopMaxWalkSpeed = BhopClientMove.Saved_BhopMaxWalkSpeed;
 	Saved_BhopGroundFriction = BhopClientMove.Saved_BhopGroundFriction;
 	Saved_BhopJumpZVelocity = BhopClientMove.Saved_BhopJumpZVelocity;
@@ -206,6 +260,7 @@ bool UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData::Serialize(U
 
 	// Serialize all the information to be sent across the network (to and from)
 	//bool bLocalSuccess = true;
+	MovementInput.Serialize(Ar);
 	SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopMaxWalkSpeed, MAX_WALK_SPEED);
 	SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopGroundFriction, GROUND_FRICTION);
 	SerializeOptionalValue<float>(Ar.IsSaving(), Ar, Saved_BhopJumpZVelocity, JUMP_Z_VELOCITY);
@@ -227,6 +282,8 @@ bool UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData::Serialize(U
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 UBhopCharacterMovementComponent::UBhopCharacterMovementComponent()
 {
+	LLM_SCOPE_BYTAG(Sandbox_Movement);
+
 	#pragma region Character movement compendium
 	// CharacterMovement (General Settings)
 	GravityScale = 2.8f; // pertains to bhop
@@ -282,7 +339,7 @@ UBhopCharacterMovementComponent::UBhopCharacterMovementComponent()
 	NetworkMinTimeBetweenClientAdjustments = 0.1f;
 	NetworkMinTimeBetweenClientAdjustmentsLargeCorrection = 0.05f;
 	NetworkLargeClientCorrectionDistance = 15.f;
-	bNetworkAlwaysReplicateTransformUpdateTimestamp = false;
+	bNetworkAlwaysReplicateTransformUpdateTimestamp = true; // The snapshot buffer needs the server time stamp of each update (bUseHermiteProxySmoothing)
 	NetworkSimulatedSmoothLocationTime = 0.1f;
 	NetworkSimulatedSmoothRotationTime = 0.05f;
 	ListenServerNetworkSimulatedSmoothLocationTime = 0.04f;
@@ -315,6 +372,9 @@ UBhopCharacterMovementComponent::UBhopCharacterMovementComponent()
 	DefaultMaxSprintSpeed = MaxWalkSpeed * 2;
 	DefaultGroundFriction = GroundFriction;
 	DefaultJumpZVelocity = JumpZVelocity;
+
+	// Use our own network move data so the movement input bits and bhop values are sent with each move
+	SetNetworkMoveDataContainer(BhopMoveDataContainer);
 }
 
 
@@ -324,6 +384,7 @@ FNetworkPredictionData_Client* UBhopCharacterMovementComponent::GetPredictionDat
 
 	if (ClientPredictionData == nullptr)
 	{
+		LLM_SCOPE_BYTAG(Sandbox_SavedMoves);
 		UBhopCharacterMovementComponent* MutableThis = const_cast<UBhopCharacterMovementComponent*>(this); // This is a workaround of const (in the case the prediction data is undefined and we have to create it)
 		MutableThis->ClientPredictionData = new FNetworkPredictionData_Client_BhopCharacter(*this);
 		MutableThis->ClientPredictionData->MaxSmoothNetUpdateDist = 92.f;
@@ -336,21 +397,233 @@ FNetworkPredictionData_Client* UBhopCharacterMovementComponent::GetPredictionDat
 
 void UBhopCharacterMovementComponent::MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
 {
+	BHOP_PROFILE_SCOPE(MoveAutonomous);
+
 	FBhopCharacterNetworkMoveData* MoveData = static_cast<FBhopCharacterNetworkMoveData*>(GetCurrentNetworkMoveData());
 	if (MoveData != nullptr)
 	{
+		ApplyMovementInput(MoveData->MovementInput);
 		Safe_BhopMaxWalkSpeed = MoveData->Saved_BhopMaxWalkSpeed;
 		Safe_BhopGroundFriction = MoveData->Saved_BhopGroundFriction;
 		Safe_BhopJumpZVelocity = MoveData->Saved_BhopJumpZVelocity;
 	}
 
+	// Trusted sessions can skip the simulation when the client's location is inside the envelope
+	if (bEnableEnvelopeValidation && MoveData != nullptr && TryEnvelopeMove(*MoveData, DeltaTime, CompressedFlags, NewAccel)) return;
+
+	const uint64 StartCycles = bEnableEnvelopeValidation ? FPlatformTime::Cycles64() : 0;
 	Super::MoveAutonomous(ClientTimeStamp, DeltaTime, CompressedFlags, NewAccel);
+
+	if (bEnableEnvelopeValidation)
+	{
+		FBhopMoveValidationCounters& Counters = FBhopMoveValidationCounters::Get();
+		Counters.FullSimulations++;
+		Counters.FullSimulationCycles += FPlatformTime::Cycles64() - StartCycles;
+	}
+}
+
+
+bool UBhopCharacterMovementComponent::TryEnvelopeMove(const FBhopCharacterNetworkMoveData& MoveData, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel)
+{
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	if (!CharacterOwner || !UpdatedComponent || CharacterOwner->GetLocalRole() != ROLE_Authority || DeltaTime <= 0.f) return false;
+
+	// Only plain walking and falling moves that carry an absolute end location (the new move of each packet)
+	if (MoveData.NetworkMoveType != FCharacterNetworkMoveData::ENetworkMoveType::NewMove) return false;
+	if (MoveData.MovementBase && MovementBaseUtility::UseRelativeLocation(MoveData.MovementBase)) return false;
+	if (HasAnimRootMotion() || CurrentRootMotion.HasActiveRootMotionSources()) return false;
+	if (((CompressedFlags & FSavedMove_Character::FLAG_WantsToCrouch) != 0) != IsCrouching()) return false;
+
+	TEnumAsByte<EMovementMode> ClientMovementMode;
+	TEnumAsByte<EMovementMode> ClientGroundMode;
+	uint8 ClientCustomMode = 0;
+	UnpackNetworkMovementMode(MoveData.MovementMode, ClientMovementMode, ClientCustomMode, ClientGroundMode);
+	const auto IsEnvelopeMode = [](EMovementMode Mode) { return Mode == MOVE_Walking || Mode == MOVE_Falling; };
+	if (!IsEnvelopeMode(MovementMode) || !IsEnvelopeMode(ClientMovementMode)) return false;
+
+	FBhopMoveValidationCounters& Counters = FBhopMoveValidationCounters::Get();
+	Counters.EligibleMoves++;
+
+	// Random audits, so nobody can time a cheat around them
+	MovesSinceAudit++;
+	if (MovesSinceAudit >= AuditInterval || FMath::FRand() < AuditChance)
+	{
+		MovesSinceAudit = 0;
+		Counters.AuditedMoves++;
+		INC_DWORD_STAT(STAT_Bhop_EnvelopeAudited);
+		return false;
+	}
+
+	const ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(CharacterOwner);
+	FBhopMoveEnvelope Envelope;
+	Envelope.MaxAcceleration = GetMaxAcceleration();
+	Envelope.MaxGroundSpeed = FMath::Max3(MaxWalkSpeed, DefaultMaxWalkSpeed, DefaultMaxSprintSpeed);
+	Envelope.MaxSeaDemonSpeed = BhopCharacter ? BhopCharacter->GetMaxSeaDemonSpeed() : Envelope.MaxGroundSpeed;
+	Envelope.JumpZVelocity = FMath::Max(JumpZVelocity, DefaultJumpZVelocity);
+	Envelope.GravityZ = GetGravityZ();
+	const float WalkableZ = FMath::Clamp(GetWalkableFloorZ(), KINDA_SMALL_NUMBER, 1.f);
+	Envelope.SlopeFactor = FMath::Sqrt(1.f - WalkableZ * WalkableZ) / WalkableZ;
+	Envelope.Tolerance = EnvelopeTolerance;
+
+	const FVector OldLocation = UpdatedComponent->GetComponentLocation();
+	const FVector ClientLocation = FRepMovement::RebaseOntoLocalOrigin(MoveData.Location, this);
+	if (!BhopMoveEnvelope::IsInside(Envelope, OldLocation, Velocity, ClientLocation, DeltaTime))
+	{
+		Counters.ViolationMoves++;
+		INC_DWORD_STAT(STAT_Bhop_EnvelopeViolations);
+		return false;
+	}
+
+	// Keep the input and jump bookkeeping the same as a simulated move, so the next full simulation starts from the same state as the client
+	UpdateFromCompressedFlags(CompressedFlags);
+	CharacterOwner->CheckJumpInput(DeltaTime);
+	Acceleration = ConstrainInputAcceleration(NewAccel).GetClampedToMaxSize(GetMaxAcceleration());
+	AnalogInputModifier = ComputeAnalogInputModifier();
+	UpdateCharacterStateBeforeMovement(DeltaTime);
+
+	// Then take the client's location, the velocity is the average over the move (corrected to the end of the move for gravity when falling)
+	const FVector OldVelocity = Velocity;
+	UpdatedComponent->SetWorldLocation(ClientLocation, false, nullptr, ETeleportType::None);
+	Velocity = (ClientLocation - OldLocation) / DeltaTime;
+	if (MovementMode != ClientMovementMode) SetMovementMode(ClientMovementMode);
+	if (IsMovingOnGround())
+	{
+		Velocity.Z = 0.f;
+		bForceNextFloorCheck = true;
+	}
+	else
+	{
+		Velocity.Z += GetGravityZ() * DeltaTime * 0.5f;
+	}
+	UpdateComponentVelocity();
+	CharacterOwner->ClearJumpInput(DeltaTime);
+	OnMovementUpdated(DeltaTime, OldLocation, OldVelocity);
+
+	Counters.AcceptedMoves++;
+	Counters.AcceptedCycles += FPlatformTime::Cycles64() - StartCycles;
+	INC_DWORD_STAT(STAT_Bhop_EnvelopeAccepted);
+	return true;
+}
+
+
+void UBhopCharacterMovementComponent::ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData)
+{
+	// Queue the move for the subsystem to prepare and perform with everyone else's
+	if (!bPerformingQueuedServerMove && SandboxServerMoves::ShouldQueueMoves() && CharacterOwner && CharacterOwner->HasAuthority())
+	{
+		if (USandboxServerMoveSubsystem* ServerMoves = GetWorld()->GetSubsystem<USandboxServerMoveSubsystem>())
+		{
+			ServerMoves->QueueMove(this, static_cast<const FBhopCharacterNetworkMoveData&>(MoveData));
+			return;
+		}
+	}
+
+	Super::ServerMove_PerformMovement(MoveData);
+}
+
+
+void UBhopCharacterMovementComponent::ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer)
+{
+	// All the moves in a packet arrive at the same time, so the jitter is measured from the newest one
+	const FCharacterNetworkMoveData* NewMoveData = MoveDataContainer.GetNewMoveData();
+	if (NewMoveData && SandboxServerMoves::IsJitterBufferEnabled() && CharacterOwner && CharacterOwner->HasAuthority())
+	{
+		if (USandboxServerMoveSubsystem* ServerMoves = GetWorld()->GetSubsystem<USandboxServerMoveSubsystem>())
+		{
+			ServerMoves->OnMovePacketReceived(this, NewMoveData->TimeStamp);
+		}
+	}
+
+	Super::ServerMove_HandleMoveData(MoveDataContainer);
+}
+
+
+void UBhopCharacterMovementComponent::PerformQueuedServerMove(FBhopCharacterNetworkMoveData& MoveData)
+{
+	// MoveAutonomous reads the bhop values from the current move data, so point it at the queued copy while it's performed
+	TGuardValue<bool> PerformingGuard(bPerformingQueuedServerMove, true);
+	SetCurrentNetworkMoveData(&MoveData);
+	ServerMove_PerformMovement(MoveData);
+	SetCurrentNetworkMoveData(nullptr);
+}
+
+
+float UBhopCharacterMovementComponent::GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const
+{
+	const float BaseDeltaTime = Super::GetClientNetSendDeltaTime(PC, ClientData, NewMove);
+	CurrentNetSendInterval = BaseDeltaTime;
+	if (!bAdaptiveNetSendRate || !ClientData || !NewMove.IsValid()) return BaseDeltaTime;
+
+	// Compare the new move with the one before it (the new move has already been added to the saved moves)
+	const int32 NumSavedMoves = ClientData->SavedMoves.Num();
+	const FSavedMove_Bhop* PrevMove = static_cast<const FSavedMove_Bhop*>(NumSavedMoves > 1 ? ClientData->SavedMoves[NumSavedMoves - 2].Get() : ClientData->LastAckedMove.Get());
+	const FSavedMove_Bhop* BhopMove = static_cast<const FSavedMove_Bhop*>(NewMove.Get());
+
+	float Steadiness = 0.f;
+	if (PrevMove && PrevMove->GetCompressedFlags() == BhopMove->GetCompressedFlags() && PrevMove->Saved_MovementInput == BhopMove->Saved_MovementInput && PrevMove->EndPackedMovementMode == BhopMove->EndPackedMovementMode)
+	{
+		// Holding the same keys in the same direction
+		const FVector PrevAccelDir = PrevMove->Acceleration.GetSafeNormal();
+		const FVector NewAccelDir = BhopMove->Acceleration.GetSafeNormal();
+		const bool bSameInput = PrevAccelDir.IsZero() == NewAccelDir.IsZero();
+		const float AccelAngle = bSameInput && !NewAccelDir.IsZero() ? FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(PrevAccelDir | NewAccelDir, -1.f, 1.f))) : 0.f;
+		const float AccelAlpha = bSameInput ? 1.f - FMath::Clamp(AccelAngle / FMath::Max(SteadyAccelAngle, KINDA_SMALL_NUMBER), 0.f, 1.f) : 0.f;
+
+		// And not turning (air strafing is all mouse movement)
+		const float YawRate = FMath::Abs(FRotator::NormalizeAxis(BhopMove->SavedControlRotation.Yaw - PrevMove->SavedControlRotation.Yaw)) / FMath::Max(BhopMove->DeltaTime, KINDA_SMALL_NUMBER);
+		const float YawAlpha = 1.f - FMath::Clamp(YawRate / FMath::Max(SteadyYawRate, KINDA_SMALL_NUMBER), 0.f, 1.f);
+		Steadiness = AccelAlpha * YawAlpha;
+	}
+
+	// Go back to the full rate the moment something changes, but only stretch the interval out once we've been steady for a bit
+	if (Steadiness < NetSendSteadiness) NetSendSteadiness = Steadiness;
+	else NetSendSteadiness += (Steadiness - NetSendSteadiness) * FMath::Min(BhopMove->DeltaTime * 4.f, 1.f);
+
+	float MaxInterval = FMath::Max(AdaptiveMaxNetSendInterval, BaseDeltaTime);
+	UNetConnection* Connection = PC ? PC->GetNetConnection() : nullptr;
+
+	// With a high ping a correction already takes a while to come back, don't add as much on top of it
+	const APlayerState* PlayerState = PC ? PC->PlayerState : nullptr;
+	if (PlayerState && AdaptiveHighPingTime > 0.f)
+	{
+		const float RoundTripTime = PlayerState->GetPingInMilliseconds() * 0.001f;
+		MaxInterval = FMath::Lerp(MaxInterval, FMath::Max((MaxInterval + BaseDeltaTime) * 0.5f, BaseDeltaTime), FMath::Clamp(RoundTripTime / AdaptiveHighPingTime, 0.f, 1.f));
+	}
+
+	float Interval = FMath::Lerp(BaseDeltaTime, MaxInterval, NetSendSteadiness);
+
+	// Back off when we're using most of the connection's bandwidth, or it's already saturated
+	if (Connection)
+	{
+		const int32 NetSpeed = PC->Player ? PC->Player->CurrentNetSpeed : 0;
+		const float BandwidthUsed = NetSpeed > 0 ? static_cast<float>(Connection->OutBytesPerSecond) / NetSpeed : 0.f;
+		Interval = FMath::Lerp(Interval, MaxInterval, FMath::Clamp((BandwidthUsed - 0.5f) / 0.4f, 0.f, 1.f));
+		if (!Connection->IsNetReady(false)) Interval = MaxInterval;
+	}
+
+	CurrentNetSendInterval = Interval;
+	return Interval;
 }
 
 
 void UBhopCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity)
 {
+	BHOP_PROFILE_SCOPE(OnMovementUpdated);
+
 	Super::OnMovementUpdated(DeltaSeconds, OldLocation, OldVelocity);
+	UpdateFloorCache();
+
+	// The overlaps (this also picks up Sandbox.OverlapPolicy.Enable changing)
+	const bool bUseOverlapPolicy = ShouldUseOverlapPolicy();
+	if (bUseOverlapPolicy != OverlapTracker.IsApplied()) SetOverlapPolicyApplied(bUseOverlapPolicy);
+	if (bUseOverlapPolicy) UpdateOverlapPolicy(OldLocation);
+
+	// Time the runs through the checkpoints with this move's segment (see BhopCheckpointIndex.h)
+	if (CharacterOwner && CharacterOwner->HasAuthority())
+	{
+		USandboxCheckpointSubsystem* Checkpoints = GetWorld()->GetSubsystem<USandboxCheckpointSubsystem>();
+		if (Checkpoints && Checkpoints->HasCheckpoints()) Checkpoints->TestMove(CharacterOwner, OldLocation, UpdatedComponent->GetComponentLocation(), DeltaSeconds);
+	}
 
 	// Sprint logic
 	if (MovementMode == MOVE_Walking)
@@ -368,12 +641,177 @@ void UBhopCharacterMovementComponent::OnMovementUpdated(float DeltaSeconds, cons
 
 
 
+#pragma region Floor Cache
+void UBhopCharacterMovementComponent::FindFloor(const FVector& CapsuleLocation, FFindFloorResult& OutFloorResult, bool bCanUseCachedLocation, const FHitResult* DownwardSweepResult) const
+{
+	FBhopFloorQueryCounters::Get().FloorQueries++;
+	INC_DWORD_STAT(STAT_Bhop_FloorQueries);
+
+	Super::FindFloor(CapsuleLocation, OutFloorResult, bCanUseCachedLocation, DownwardSweepResult);
+}
+
+
+void UBhopCharacterMovementComponent::UpdateFloorCache()
+{
+	// CurrentFloor is only kept up to date while we're walking, the cache is invalid the rest of the time
+	FloorCache.FrameNumber = GFrameCounter;
+	FloorCache.bBlockingHit = IsMovingOnGround() && CurrentFloor.bBlockingHit;
+	FloorCache.bWalkable = FloorCache.bBlockingHit && CurrentFloor.IsWalkableFloor();
+	FloorCache.FloorDist = CurrentFloor.bLineTrace ? CurrentFloor.LineDist : CurrentFloor.FloorDist;
+	FloorCache.Normal = FloorCache.bBlockingHit ? CurrentFloor.HitResult.ImpactNormal : FVector::UpVector;
+	FloorCache.RampAngle = FMath::RadiansToDegrees(FMath::Acos(FMath::Clamp(FloorCache.Normal.Z, -1.f, 1.f)));
+}
+
+
+bool UBhopCharacterMovementComponent::HasFreshFloor() const
+{
+	return GBhopFloorCacheEnabled && FloorCache.bBlockingHit && IsMovingOnGround() && GFrameCounter - FloorCache.FrameNumber <= 1;
+}
+
+
+FBhopFloorQueryCounters& FBhopFloorQueryCounters::Get()
+{
+	static FBhopFloorQueryCounters Counters;
+	return Counters;
+}
+
+
+void FBhopFloorQueryCounters::Reset()
+{
+	*this = FBhopFloorQueryCounters();
+}
+
+
+static FAutoConsoleCommand FloorCacheStatsCommand(
+	TEXT("Sandbox.FloorCache.Stats"),
+	TEXT("Prints the floor queries per bhop character per frame (toggle Sandbox.FloorCache.Enable to compare). Usage: Sandbox.FloorCache.Stats [Reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FBhopFloorQueryCounters& Counters = FBhopFloorQueryCounters::Get();
+		const double Frames = FMath::Max<double>(Counters.CharacterFrames, 1.0);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.FloorCache.Stats: %llu character frames. Per character per frame: FindFloor %.3f, Traces %.3f, Scene queries %.3f (Cache hits %.3f, Grid lookups %.3f)"),
+			Counters.CharacterFrames, Counters.FloorQueries / Frames, Counters.Traces / Frames, (Counters.FloorQueries + Counters.Traces) / Frames, Counters.CacheHits / Frames, Counters.GridLookups / Frames);
+
+		if (Args.Num() > 0 && Args[0] == TEXT("Reset")) Counters.Reset();
+	})
+);
+#pragma endregion
+
+
+#pragma region Overlap Policy
+void UBhopCharacterMovementComponent::BeginPlay()
+{
+	Super::BeginPlay();
+	SetOverlapPolicyApplied(ShouldUseOverlapPolicy());
+}
+
+
+bool UBhopCharacterMovementComponent::ShouldUseOverlapPolicy() const
+{
+	return GBhopOverlapPolicyEnabled && OverlapPolicy.bEnabled && CharacterOwner;
+}
+
+
+void UBhopCharacterMovementComponent::SetOverlapPolicyApplied(bool bApply)
+{
+	OverlapTracker.SetApplied(CharacterOwner, bApply);
+}
+
+
+void UBhopCharacterMovementComponent::UpdateOverlapPolicy(const FVector& OldLocation)
+{
+	if (OverlapTracker.IsApplied()) OverlapTracker.Update(CharacterOwner, OverlapPolicy, OldLocation);
+}
+#pragma endregion
+
+
 void UBhopCharacterMovementComponent::UpdateFromCompressedFlags(uint8 Flags)
 {
 	Super::UpdateFromCompressedFlags(Flags);
 
-	Safe_bWantsToSprnt = (Flags & FSavedMove_Character::FLAG_Custom_0) != 0;
+	// The custom flags are free, sprint and jump held come from the movement input bits (see MoveAutonomous)
+}
+
 
+FMovementInputFlags UBhopCharacterMovementComponent::GetMovementInput() const
+{
+	FMovementInputFlags MovementInput;
+	MovementInput.Set(EMovementInput::Sprint, Safe_bWantsToSprnt);
+	MovementInput.Set(EMovementInput::JumpHeld, Safe_bJumpHeld);
+	return MovementInput;
+}
+
+
+void UBhopCharacterMovementComponent::ApplyMovementInput(const FMovementInputFlags& MovementInput)
+{
+	Safe_bWantsToSprnt = MovementInput.Get(EMovementInput::Sprint);
+	Safe_bJumpHeld = MovementInput.Get(EMovementInput::JumpHeld);
+}
+
+
+void UBhopCharacterMovementComponent::UpdateCharacterStateBeforeMovement(float DeltaSeconds)
+{
+	Super::UpdateCharacterStateBeforeMovement(DeltaSeconds);
+
+	// Jump buffer, pressing jump in the air opens a window where we'll hop as soon as we land. This only uses the move's delta time so the server counts it down the same way
+	if (IsFalling() && Safe_bJumpHeld && !Safe_bPrevJumpHeld)
+	{
+		Safe_JumpBufferTimeRemaining = JumpBufferWindow;
+	}
+	else
+	{
+		Safe_JumpBufferTimeRemaining = FMath::Max(Safe_JumpBufferTimeRemaining - DeltaSeconds, 0.f);
+	}
+
+	Safe_bPrevJumpHeld = Safe_bJumpHeld;
+}
+
+
+void UBhopCharacterMovementComponent::SetPostLandedPhysics(const FHitResult& Hit)
+{
+	// The walking mode change happens in here, let the character know before it schedules the landing friction
+	TGuardValue<bool> HoppingGuard(bHoppingOnLanding, ShouldHopOnLanding());
+	Super::SetPostLandedPhysics(Hit);
+
+	// Hop on the same frame we land, before any ground friction is applied. DoJump sets us back to falling, and the rest of the move continues in the air
+	if (IsMovingOnGround() && bHoppingOnLanding)
+	{
+		Safe_JumpBufferTimeRemaining = 0.f;
+
+		// The trimp only uses this move's velocity and floor, so replays and the server get the same impulse
+		const float DefaultJump = JumpZVelocity;
+		ApplyLandingTrimp(Hit);
+		DoJump(CharacterOwner->bClientUpdating);
+		JumpZVelocity = DefaultJump;
+
+		ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(CharacterOwner);
+		if (BhopCharacter && !CharacterOwner->bClientUpdating) BhopCharacter->OnLandingHop();
+	}
+}
+
+
+void UBhopCharacterMovementComponent::ApplyLandingTrimp(const FHitResult& Hit)
+{
+	const ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(CharacterOwner);
+	if (!BhopCharacter) return;
+
+	// Walking keeps the velocity horizontal, the same as the velocity a manual jump off the ground trimps with
+	const FVector LandingVelocity(Velocity.X, Velocity.Y, 0.f);
+	const FVector FloorNormal = CurrentFloor.bBlockingHit ? CurrentFloor.HitResult.ImpactNormal : Hit.ImpactNormal;
+	const FVector Trimp = BhopCharacter->CalcTrimpImpulse(FVector::DotProduct(FloorNormal, LandingVelocity.GetSafeNormal(0.0001f)), LandingVelocity);
+
+	// The lateral part goes onto the velocity and the vertical part onto this jump, and the bhop values are the ones the manual jump sets (ApplyTrimp)
+	Velocity += FVector(Trimp.X, Trimp.Y, 0.f);
+	JumpZVelocity = FMath::Max(JumpZVelocity + Trimp.Z, 0.f);
+	Safe_BhopMaxWalkSpeed = Velocity.Size2D();
+	Safe_BhopJumpZVelocity = JumpZVelocity;
+}
+
+
+bool UBhopCharacterMovementComponent::ShouldHopOnLanding() const
+{
+	if (bEnableAutoHop && Safe_bJumpHeld) return true;
+	return Safe_JumpBufferTimeRemaining > 0.f;
 }
 
 
@@ -387,6 +825,16 @@ UFUNCTION(BlueprintCallable) void UBhopCharacterMovementComponent::SprintRelease
 	Safe_bWantsToSprnt = false;
 }
 
+UFUNCTION(BlueprintCallable) void UBhopCharacterMovementComponent::JumpPressed()
+{
+	Safe_bJumpHeld = true;
+}
+
+UFUNCTION(BlueprintCallable) void UBhopCharacterMovementComponent::JumpReleased()
+{
+	Safe_bJumpHeld = false;
+}
+
 UFUNCTION(BlueprintCallable) void UBhopCharacterMovementComponent::SetBhopMaxWalkSpeed(float Value)
 {
 	Safe_BhopMaxWalkSpeed = Value;
@@ -401,3 +849,33 @@ UFUNCTION(BlueprintCallable) void UBhopCharacterMovementComponent::SetBhopJumpZV
 {
 	Safe_BhopJumpZVelocity = Value;
 }
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Simulated Proxy Smoothing																																								 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Simulated Proxy Smoothing
+void UBhopCharacterMovementComponent::SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation)
+{
+	LLM_SCOPE_BYTAG(Sandbox_Movement);
+
+	// The snapshot buffer moves the capsule, and the mesh is placed in SmoothClientPosition (see ProxySnapshotBuffer.h)
+	if (!bUseHermiteProxySmoothing || !ProxySmoothing::SmoothCorrection(ProxySnapshots, this, NewLocation, NewRotation))
+	{
+		Super::SmoothCorrection(OldLocation, OldRotation, NewLocation, NewRotation);
+		return;
+	}
+
+	bNetworkSmoothingComplete = false;
+}
+
+
+void UBhopCharacterMovementComponent::SmoothClientPosition(float DeltaSeconds)
+{
+	if (!bUseHermiteProxySmoothing) ProxySnapshots.Reset();
+	if (!bUseHermiteProxySmoothing || !ProxySmoothing::SmoothClientPosition(ProxySnapshots, this, ProxyInterpolationDelay, ProxyMaxExtrapolationTime))
+	{
+		Super::SmoothClientPosition(DeltaSeconds);
+	}
+}
+#pragma endregion
@@ -4,6 +4,10 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/CharacterMovementComponent.h"
+#include "Sandbox/Characters/MovementInputFlags.h"
+#include "Sandbox/Characters/SavedMoveArena.h"
+#include "Sandbox/Characters/ProxySnapshotBuffer.h"
+#include "BhopOverlapPolicy.h"
 #include "BhopCharacterMovementComponent.generated.h"
 
 /*
@@ -67,6 +71,32 @@ You will also need to extend FCharacterNetworkMoveDataContainer so that it can s
 #define GROUND_FRICTION 8.f
 
 
+/** The floor the movement component found on its last step, so the bhop logic doesn't have to trace for it again */
+struct FBhopFloorCache
+{
+	FVector Normal = FVector::UpVector;		// The impact normal of the floor
+	float FloorDist = 0.f;					// The distance from the bottom of the capsule to the floor
+	float RampAngle = 0.f;					// Degrees from flat
+	bool bBlockingHit = false;
+	bool bWalkable = false;
+	uint64 FrameNumber = 0;					// GFrameCounter when it was updated
+};
+
+
+/** Running totals of the floor queries across every bhop character (Sandbox.FloorCache.Stats) */
+struct SANDBOX_API FBhopFloorQueryCounters
+{
+	uint64 CharacterFrames = 0;		// A tick of a bhop character
+	uint64 FloorQueries = 0;		// FindFloor calls from the movement component
+	uint64 CacheHits = 0;			// Bhop helpers that used the floor cache
+	uint64 GridLookups = 0;			// Bhop helpers that used the baked surface grid
+	uint64 Traces = 0;				// Bhop helpers that had to trace
+
+	static FBhopFloorQueryCounters& Get();
+	void Reset();
+};
+
+
 UCLASS()
 class SANDBOX_API UBhopCharacterMovementComponent : public UCharacterMovementComponent
 {
@@ -85,11 +115,13 @@ public:
 	public:
 		typedef FSavedMove_Character Super;
 
-		// Other values values we want to pass into the saved moves
-		uint8 Saved_bWantsToSprnt : 1;
+		// Other values values we want to pass into the saved moves (largest first so they pack together at the end of the base move)
+		float Saved_JumpBufferTimeRemaining = 0.f;
 		float Saved_BhopMaxWalkSpeed = MAX_WALK_SPEED;
 		float Saved_BhopGroundFriction = JUMP_Z_VELOCITY;
 		float Saved_BhopJumpZVelocity = GROUND_FRICTION;
+		FMovementInputFlags Saved_MovementInput; // Sprint, jump held, etc. (see MovementInputFlags.h)
+		uint8 Saved_bPrevJumpHeld : 1;
 
 		// Functions 
 		/** Returns true if this move can be combined with NewMove for replication without changing any behavior */
@@ -121,8 +153,14 @@ public:
 	public:
 		typedef FNetworkPredictionData_Client_Character Super;
 		FNetworkPredictionData_Client_BhopCharacter(const UCharacterMovementComponent& ClientMovement);
-		/* Creates a copy of the new move */
+		virtual ~FNetworkPredictionData_Client_BhopCharacter();
+		/* Creates a copy of the new move (from the move arena) */
 		virtual FSavedMovePtr AllocateNewMove() override;
+		FORCEINLINE const TSavedMoveArena<FSavedMove_Bhop>& GetMoveArena() const { return MoveArena; }
+
+	protected:
+		/** Room for every saved move, free move, and the pending and acked moves (see SavedMoveArena.h) */
+		TSavedMoveArena<FSavedMove_Bhop> MoveArena;
 	};
 
 
@@ -155,6 +193,7 @@ public:
 		virtual bool Serialize(UCharacterMovementComponent& CharacterMovement, FArchive& Ar, UPackageMap* PackageMap, ENetworkMoveType MoveType) override; // Data compression for efficient transfer across the network
 
 		// Other information we want to send across the network (since it's being updated every frame)
+		FMovementInputFlags MovementInput;
 		float Saved_BhopMaxWalkSpeed = MAX_WALK_SPEED;
 		float Saved_BhopGroundFriction = JUMP_Z_VELOCITY;
 		float Saved_BhopJumpZVelocity = GROUND_FRICTION;
@@ -171,6 +210,7 @@ public:
 	*/
 	class FBhopCharacterNetworkMoveDataContainer : public FCharacterNetworkMoveDataContainer
 	{
+	public:
 		//typedef FCharacterNetworkMoveDataContainer Super;
 		FBhopCharacterNetworkMoveDataContainer();
 		FBhopCharacterNetworkMoveData BhopDefaultMoveData[3];
@@ -187,28 +227,79 @@ public:
 	/** Get prediction data for a client game. Should not be used if not running as a client. Allocates the data on demand and can be overridden to allocate a custom override if desired. Result must be a FNetworkPredictionData_Client_Character. */
 	virtual FNetworkPredictionData_Client* GetPredictionData_Client() const override;
 
+	/** Applies the overlap policy before the first move */
+	virtual void BeginPlay() override;
+
 	/** Called after MovementMode has changed. Base implementation does special handling for starting certain modes, then notifies the CharacterOwner. */
 	virtual void OnMovementUpdated(float DeltaSeconds, const FVector& OldLocation, const FVector& OldVelocity) override;
 
 	/* Process a move at the given time stamp, given the compressed flags representing various events that occurred (ie jump). */
 	virtual void MoveAutonomous(float ClientTimeStamp, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel) override;
 
+	/** Update the character state in PerformMovement right before doing the actual position change */
+	virtual void UpdateCharacterStateBeforeMovement(float DeltaSeconds) override;
+
+	/** Counts the floor queries (see FBhopFloorQueryCounters) */
+	virtual void FindFloor(const FVector& CapsuleLocation, FFindFloorResult& OutFloorResult, bool bCanUseCachedLocation, const FHitResult* DownwardSweepResult = NULL) const override;
+
+	/** Simulated proxies add the replicated transform to the snapshot buffer instead of using the engine's smoothing (see ProxySnapshotBuffer.h) */
+	virtual void SmoothCorrection(const FVector& OldLocation, const FQuat& OldRotation, const FVector& NewLocation, const FQuat& NewRotation) override;
+
 
 protected:
 	virtual void UpdateFromCompressedFlags(uint8 Flags) override;
 
+	/** Places the simulated proxy's mesh from the snapshot buffer */
+	virtual void SmoothClientPosition(float DeltaSeconds) override;
+
+	/** With Sandbox.ServerMoves.Batch or JitterBuffer on, the move is queued on the server move subsystem and performed later in the frame (see SandboxServerMoveSubsystem.h) */
+	virtual void ServerMove_PerformMovement(const FCharacterNetworkMoveData& MoveData) override;
+
+	/** Lets the server move subsystem measure the packet's arrival jitter once, before the old, pending and new moves in it are queued */
+	virtual void ServerMove_HandleMoveData(const FCharacterNetworkMoveDataContainer& MoveDataContainer) override;
+
+	/** Sets the movement mode after landing, this is where buffered jumps and auto hops are applied so the hop happens on the same move we land */
+	virtual void SetPostLandedPhysics(const FHitResult& Hit) override;
+
+	/** How long the client can hold on to a move before sending it, stretched out while we're moving steadily and the connection is busy (see bAdaptiveNetSendRate) */
+	virtual float GetClientNetSendDeltaTime(const APlayerController* PC, const FNetworkPredictionData_Client_Character* ClientData, const FSavedMovePtr& NewMove) const override;
+
 
 ////////// Additional implementations to the original UCharacterMovement class ////////// 
 public:
 	// Action functions and stuff
 	UFUNCTION(BlueprintCallable) void SprintPressed();
 	UFUNCTION(BlueprintCallable) void SprintReleased();
+	UFUNCTION(BlueprintCallable) void JumpPressed();
+	UFUNCTION(BlueprintCallable) void JumpReleased();
 	UFUNCTION(BlueprintCallable) void SetBhopMaxWalkSpeed(float Value);
 	UFUNCTION(BlueprintCallable) void SetBhopGroundFriction(float Value);
 	UFUNCTION(BlueprintCallable) void SetBhopJumpZVelocity(float Value);
 
+	/** Packs the safe input variables into the movement input bits that are sent with each move */
+	FMovementInputFlags GetMovementInput() const;
+	/** Sets the safe input variables from the movement input bits of a move */
+	void ApplyMovementInput(const FMovementInputFlags& MovementInput);
+	/** Performs a move that the server move subsystem queued (after dropping the duplicates and metering it) */
+	void PerformQueuedServerMove(FBhopCharacterNetworkMoveData& MoveData);
+	/** The send interval the client used for its last move, for the net readout on the hud */
+	FORCEINLINE float GetCurrentNetSendInterval() const { return CurrentNetSendInterval; }
+	/** The floor from the last movement step, only use it if HasFreshFloor is true */
+	FORCEINLINE const FBhopFloorCache& GetFloorCache() const { return FloorCache; }
+	/** Whether we're on the ground and the floor cache is from this frame or the last one (the input runs before the movement component ticks) */
+	bool HasFreshFloor() const;
+	/** Whether the landing that's changing the movement mode right now is going to hop (the walking mode change comes before the hop) */
+	FORCEINLINE bool IsHoppingOnLanding() const { return bHoppingOnLanding; }
+	/** Whether the capsule's overlaps should come from the overlap policy's query (see BhopOverlapPolicy.h) */
+	bool ShouldUseOverlapPolicy() const;
+	/** Turns the capsule and mesh's overlap events off for the policy, or back on */
+	void SetOverlapPolicyApplied(bool bApply);
+	/** Runs the overlap policy's query for a move from OldLocation */
+	void UpdateOverlapPolicy(const FVector& OldLocation);
+
 	// Movement variables that are hoisted to the network
 	bool Safe_bWantsToSprnt = false;
+	bool Safe_bJumpHeld = false;
 	float Safe_BhopMaxWalkSpeed = MAX_WALK_SPEED;
 	float Safe_BhopGroundFriction = GROUND_FRICTION;
 	float Safe_BhopJumpZVelocity = JUMP_Z_VELOCITY;
@@ -219,5 +310,89 @@ public:
 	UPROPERTY() float DefaultGroundFriction = GROUND_FRICTION;
 	UPROPERTY() float DefaultJumpZVelocity = JUMP_Z_VELOCITY;
 
+	// Jump buffer and auto hop (these are evaluated inside of the movement component on landing, so the hops are predicted and replayed like any other move)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bhop") // Hop on landing for as long as the jump key is held down (pogo)
+		bool bEnableAutoHop = false;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Bhop") // How long (in seconds) a jump pressed in the air is remembered before landing
+		float JumpBufferWindow = 0.1f;
+
+
+	// Simulated proxy smoothing (Hermite interpolation between the replicated snapshots, with a bit of extrapolation when they're late)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network") // Use the snapshot buffer for simulated proxies instead of NetworkSmoothingMode
+		bool bUseHermiteProxySmoothing = true;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bUseHermiteProxySmoothing")) // How many snapshot intervals behind the newest snapshot the proxy is rendered
+		float ProxyInterpolationDelay = 1.5f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bUseHermiteProxySmoothing")) // The furthest (in seconds) a proxy is extrapolated past the newest snapshot before it holds
+		float ProxyMaxExtrapolationTime = 0.1f;
+
+	// Adaptive send rate (the client holds its moves for longer when consecutive moves are nearly the same, so they're combined into fewer packets)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network") // Scale the client's move send interval between the engine's rate and AdaptiveMaxNetSendInterval
+		bool bAdaptiveNetSendRate = true;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bAdaptiveNetSendRate")) // The longest the client holds a move while it's moving steadily (or the connection is saturated)
+		float AdaptiveMaxNetSendInterval = 0.05f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bAdaptiveNetSendRate")) // Moves whose input direction changed by more than this many degrees are sent at the full rate
+		float SteadyAccelAngle = 2.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bAdaptiveNetSendRate")) // Turning faster than this (degrees per second) is sent at the full rate (strafe arcs)
+		float SteadyYawRate = 30.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Network", meta = (EditCondition = "bAdaptiveNetSendRate")) // At this round trip time (seconds) the longest interval is halved, corrections already take long enough to come back
+		float AdaptiveHighPingTime = 0.2f;
+
+	// Envelope validation, the server accepts the client's location when it's inside what the bhop rules allow instead of simulating the move (see BhopMoveEnvelope.h)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Validation") // Only for trusted or low risk sessions, the envelope doesn't check for collision
+		bool bEnableEnvelopeValidation = false;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Validation", meta = (EditCondition = "bEnableEnvelopeValidation")) // Extra distance allowed on each axis
+		float EnvelopeTolerance = 10.f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Validation", meta = (EditCondition = "bEnableEnvelopeValidation", ClampMin = "0", ClampMax = "1")) // The chance any eligible move is fully simulated anyway
+		float AuditChance = 0.05f;
+	UPROPERTY(EditAnywhere, Category = "Bhop_Validation", meta = (EditCondition = "bEnableEnvelopeValidation", ClampMin = "1")) // An eligible move is always fully simulated after this many without an audit
+		int32 AuditInterval = 60;
+
+	// Overlap policy, the capsule's overlaps come from one query against the gameplay channels instead of the engine's overlap updates (see BhopOverlapPolicy.h)
+	UPROPERTY(EditAnywhere, Category = "Bhop_Overlaps")
+		FBhopOverlapPolicySettings OverlapPolicy;
+
+
+protected:
+	/** Whether the character should jump the moment it lands (buffered jump or auto hop) */
+	bool ShouldHopOnLanding() const;
+
+	/** Adds the trimp from the floor we landed on to the hop, the same impulse a manual jump gets (see ABhopCharacter::ApplyTrimp) */
+	void ApplyLandingTrimp(const FHitResult& Hit);
+
+	/** Accepts the client's end location if the move is eligible and inside the envelope, returns false if the move should be fully simulated */
+	bool TryEnvelopeMove(const FBhopCharacterNetworkMoveData& MoveData, float DeltaTime, uint8 CompressedFlags, const FVector& NewAccel);
+
+	// Our custom network move data, this is what carries the movement input bits and the bhop values to the server
+	FBhopCharacterNetworkMoveDataContainer BhopMoveDataContainer;
+
+	// Derived from Safe_bJumpHeld every move on both the client and the server (these are saved in the move for replays, but never sent)
+	bool Safe_bPrevJumpHeld = false;
+	float Safe_JumpBufferTimeRemaining = 0.f;
+
+	// Set while the server move subsystem is performing one of our queued moves, so it isn't queued again
+	bool bPerformingQueuedServerMove = false;
+
+	// Set while landing on a move that hops, so the character knows it's going straight back into the air
+	bool bHoppingOnLanding = false;
+
+	// Adaptive send rate, these are updated from GetClientNetSendDeltaTime
+	mutable float NetSendSteadiness = 0.f; // 0 when the moves are changing, 1 when they're the same (drops right away, recovers over a few frames)
+	mutable float CurrentNetSendInterval = 0.f;
+
+	// The eligible moves since the last full simulation audit
+	int32 MovesSinceAudit = 0;
+
+	/** Copies CurrentFloor into the floor cache after each step */
+	void UpdateFloorCache();
+
+	// The floor from the last movement step
+	FBhopFloorCache FloorCache;
+
+	// The overlaps the policy has begun
+	FBhopOverlapTracker OverlapTracker;
+
+
+	/** The replicated transforms of a simulated proxy */
+	FProxySnapshotBuffer ProxySnapshots;
 
 };
@@ -3,6 +3,8 @@
 
 #include "BhopController.h"
 #include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacterMovementComponent.h"
+#include "Engine/NetConnection.h"
 #include "Components/TextBlock.h"
 
 #include "Sandbox/HUDs/BhopHud.h"
@@ -21,9 +23,12 @@ void ABhopController::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
+#if SANDBOX_WITH_COSMETICS
 	SetHUDSpeedometer();
 	SetHUDefaultMaxWalkSpeed();
 	SetHUDFricton();
+	SetHUDNetRates();
+#endif
 }
 
 
@@ -74,3 +79,28 @@ void ABhopController::SetHUDFricton()
 	}
 	else UE_LOG(LogTemp, Warning, TEXT("CharacterOverlay::SetHUDefaultMaxWalkSpeed: An error occured while trying to get the character controller"));
 }
+
+void ABhopController::SetHUDNetRates()
+{
+	// Only clients have a connection to read from, and the widget doesn't have to have the net readout
+	UNetConnection* Connection = GetNetConnection();
+	BhopHUD = BhopHUD == nullptr ? Cast<ABhopHud>(GetHUD()) : BhopHUD;
+	if (!Connection || !BhopHUD || !BhopHUD->CharacterOverlay) return;
+
+	UCharacterOverlay* Overlay = BhopHUD->CharacterOverlay;
+	if (Overlay->NetPacketsPerSecondValue)
+	{
+		Overlay->NetPacketsPerSecondValue->SetText(FText::FromString(FString::Printf(TEXT("%d"), Connection->OutPacketsPerSecond)));
+	}
+	if (Overlay->NetBytesPerSecondValue)
+	{
+		Overlay->NetBytesPerSecondValue->SetText(FText::FromString(FString::Printf(TEXT("%d"), Connection->OutBytesPerSecond)));
+	}
+
+	ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(GetPawn());
+	if (Overlay->NetSendIntervalValue && BhopCharacter && BhopCharacter->GetBhopCharacterMovement())
+	{
+		const float SendInterval = BhopCharacter->GetBhopCharacterMovement()->GetCurrentNetSendInterval();
+		Overlay->NetSendIntervalValue->SetText(FText::FromString(FString::Printf(TEXT("%.1f ms"), SendInterval * 1000.f)));
+	}
+}
@@ -21,6 +21,7 @@ public:
 	void SetHUDSpeedometer();
 	void SetHUDefaultMaxWalkSpeed();
 	void SetHUDFricton();
+	void SetHUDNetRates();
 
 
 protected:
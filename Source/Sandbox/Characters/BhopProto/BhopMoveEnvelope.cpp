@@ -0,0 +1,69 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopMoveEnvelope.h"
+#include "HAL/IConsoleManager.h"
+
+
+#pragma region Envelope
+namespace BhopMoveEnvelope
+{
+	bool IsInside(const FBhopMoveEnvelope& Envelope, const FVector& StartLocation, const FVector& StartVelocity, const FVector& EndLocation, float DeltaTime)
+	{
+		if (DeltaTime <= 0.f) return false;
+		const FVector Delta = EndLocation - StartLocation;
+
+		// Horizontal, we can only speed up by the max acceleration, and nothing goes faster than the sea demon speed
+		const float MaxSpeed2D = FMath::Min(FMath::Max(StartVelocity.Size2D() + Envelope.MaxAcceleration * DeltaTime, Envelope.MaxGroundSpeed), Envelope.MaxSeaDemonSpeed);
+		const float MaxDistance2D = MaxSpeed2D * DeltaTime;
+		if (Delta.Size2D() > MaxDistance2D + Envelope.Tolerance) return false;
+
+		// Vertical, a jump (or whatever we're already doing) going up, and gravity going down. Walking up or down a slope moves us vertically as well
+		const float SlopeDistance = MaxDistance2D * Envelope.SlopeFactor;
+		const float MaxRise = FMath::Max(StartVelocity.Z, Envelope.JumpZVelocity) * DeltaTime + SlopeDistance;
+		const float MaxDrop = (FMath::Max(-StartVelocity.Z, 0.f) + FMath::Abs(Envelope.GravityZ) * DeltaTime) * DeltaTime + SlopeDistance;
+		return Delta.Z <= MaxRise + Envelope.Tolerance && -Delta.Z <= MaxDrop + Envelope.Tolerance;
+	}
+}
+#pragma endregion
+
+
+#pragma region Counters
+FBhopMoveValidationCounters& FBhopMoveValidationCounters::Get()
+{
+	static FBhopMoveValidationCounters Counters;
+	return Counters;
+}
+
+
+void FBhopMoveValidationCounters::Reset()
+{
+	*this = FBhopMoveValidationCounters();
+}
+
+
+double FBhopMoveValidationCounters::GetEstimatedSavedMs() const
+{
+	if (FullSimulations == 0 || AcceptedMoves == 0) return 0.0;
+	const double FullSimulationMs = FPlatformTime::ToMilliseconds64(FullSimulationCycles) / FullSimulations;
+	const double AcceptedMs = FPlatformTime::ToMilliseconds64(AcceptedCycles) / AcceptedMoves;
+	return (FullSimulationMs - AcceptedMs) * AcceptedMoves;
+}
+
+
+static FAutoConsoleCommand MoveValidationStatsCommand(
+	TEXT("Sandbox.MoveValidation.Stats"),
+	TEXT("Prints the envelope validation counters and the estimated server time saved. Usage: Sandbox.MoveValidation.Stats [Reset]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		FBhopMoveValidationCounters& Counters = FBhopMoveValidationCounters::Get();
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.MoveValidation.Stats: Eligible: %llu, Accepted: %llu, Audited: %llu, Violations: %llu, FullSimulations: %llu (%.4f ms avg), Accepted avg %.4f ms, Estimated saved: %.2f ms"),
+			Counters.EligibleMoves, Counters.AcceptedMoves, Counters.AuditedMoves, Counters.ViolationMoves, Counters.FullSimulations,
+			Counters.FullSimulations > 0 ? FPlatformTime::ToMilliseconds64(Counters.FullSimulationCycles) / Counters.FullSimulations : 0.0,
+			Counters.AcceptedMoves > 0 ? FPlatformTime::ToMilliseconds64(Counters.AcceptedCycles) / Counters.AcceptedMoves : 0.0,
+			Counters.GetEstimatedSavedMs());
+
+		if (Args.Num() > 0 && Args[0] == TEXT("Reset")) Counters.Reset();
+	})
+);
+#pragma endregion
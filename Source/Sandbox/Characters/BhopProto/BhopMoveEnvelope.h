@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+	Envelope validation for the bhop server moves
+
+	Re-simulating every client move is the biggest part of a player's server cost. For trusted or low risk sessions (bEnableEnvelopeValidation on the movement component)
+	the server can instead check the client's reported end location against a kinematic envelope built from the bhop rules, and accept it if it's inside:
+		- Horizontally, the start speed plus the max acceleration for the move's delta time (never past MaxSeaDemonSpeed)
+		- Vertically, the jump velocity (or the start velocity if that's higher) going up, gravity going down, plus how far the walkable slopes let you climb or drop at that speed
+
+	Only walking and falling moves with an absolute location (no moving base, root motion or crouch change) are eligible. Everything else, every move outside the envelope,
+	and a random audit every so often (AuditChance, and at least once every AuditInterval moves) runs the full simulation like before, so the server still corrects anyone who drifts.
+	The envelope doesn't sweep, so a client could walk through thin geometry between audits. That's the trade off, don't turn this on for public sessions.
+
+	"stat Bhop" shows the moves each frame, and Sandbox.MoveValidation.Stats prints the totals and the estimated server time saved
+	(the accepted moves times the difference between the average full simulation and the average fast path).
+*/
+
+
+/** The limits of a single move */
+struct SANDBOX_API FBhopMoveEnvelope
+{
+	float MaxAcceleration = 0.f;
+	float MaxGroundSpeed = 0.f; // The fastest we can walk or sprint without any bhop buildup
+	float MaxSeaDemonSpeed = 0.f;
+	float JumpZVelocity = 0.f;
+	float GravityZ = 0.f;
+	float SlopeFactor = 0.f; // Vertical distance per horizontal distance on the steepest walkable floor
+	float Tolerance = 0.f; // Extra distance allowed on each axis (quantization of the sent location, float error)
+};
+
+
+/** Running totals across every movement component */
+struct SANDBOX_API FBhopMoveValidationCounters
+{
+	uint64 EligibleMoves = 0;		// Moves that could use the fast path
+	uint64 AcceptedMoves = 0;		// Moves accepted inside the envelope
+	uint64 AuditedMoves = 0;		// Eligible moves that were fully simulated for a random audit
+	uint64 ViolationMoves = 0;		// Moves outside the envelope, these are fully simulated
+	uint64 FullSimulations = 0;		// Every full simulation while the validation was on (including the ineligible moves)
+	uint64 FullSimulationCycles = 0;
+	uint64 AcceptedCycles = 0;
+
+	static FBhopMoveValidationCounters& Get();
+	void Reset();
+
+	/** The estimated server time (in ms) the accepted moves would have taken as full simulations, minus what they did take */
+	double GetEstimatedSavedMs() const;
+};
+
+
+namespace BhopMoveEnvelope
+{
+	/** Whether a move from StartLocation with StartVelocity can end at EndLocation after DeltaTime */
+	SANDBOX_API bool IsInside(const FBhopMoveEnvelope& Envelope, const FVector& StartLocation, const FVector& StartVelocity, const FVector& EndLocation, float DeltaTime);
+}
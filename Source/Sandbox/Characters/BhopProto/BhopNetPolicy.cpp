@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopNetPolicy.h"
+
+
+namespace BhopNetPolicy
+{
+	float GetUpdateFrequency(const FBhopNetPolicySettings& Settings, float Speed)
+	{
+		const float SpeedAlpha = Settings.FullRateSpeed > 0.f ? FMath::Clamp(Speed / Settings.FullRateSpeed, 0.f, 1.f) : 1.f;
+		return FMath::Lerp(Settings.MinUpdateFrequency, Settings.MaxUpdateFrequency, SpeedAlpha);
+	}
+
+
+	float GetPriorityScale(const FBhopNetPolicySettings& Settings, const FVector& Location, const FVector& Velocity, const FVector& ViewLocation, const FVector& ViewDirection)
+	{
+		const FVector ToViewer = ViewLocation - Location;
+		const float Distance = ToViewer.Size();
+
+		// Up close everyone moving quickly matters, otherwise only the speed towards the viewer counts (the distance is clamped in case the near distance isn't set)
+		float ClosingSpeed = 0.f;
+		if (Distance <= Settings.NearViewerDistance) ClosingSpeed = Velocity.Size2D();
+		else ClosingSpeed = FVector::DotProduct(Velocity, ToViewer / FMath::Max(Distance, KINDA_SMALL_NUMBER));
+
+		// The viewer is also more likely to notice the error if the character is in front of them
+		const bool bInFront = FVector::DotProduct(ViewDirection, -ToViewer) > 0.f;
+
+		const float ApproachAlpha = Settings.FullRateSpeed > 0.f ? FMath::Clamp(ClosingSpeed / Settings.FullRateSpeed, 0.f, 1.f) : 0.f;
+		const float Scale = 1.f + ApproachAlpha * Settings.ApproachPriorityScale * (bInFront ? 1.f : 0.5f);
+		return FMath::Min(Scale, Settings.MaxPriorityScale);
+	}
+
+
+	float GetCullDistanceSquared(const FBhopNetPolicySettings& Settings, float BaseCullDistanceSquared, float Speed)
+	{
+		const float CullDistance = FMath::Sqrt(BaseCullDistanceSquared) + Speed * Settings.RelevancyLookAheadTime;
+		return CullDistance * CullDistance;
+	}
+}
@@ -0,0 +1,54 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "BhopNetPolicy.generated.h"
+
+
+/*
+	Network relevancy and priority for fast moving bhop characters
+
+	The error on a simulated proxy grows with how fast the character is moving, so instead of updating everyone at a flat 66hz the bhop characters scale their update frequency with their speed,
+	and connections get a higher priority for players that are closing in on them quickly. The relevancy distance is also pushed out by how far we'll travel in RelevancyLookAheadTime,
+	so someone coming around a corner at 5000 uu/s is already relevant before they're on top of you.
+
+	The policy is evaluated on the server. ABhopCharacter uses it for the net driver's relevancy and priority, and the replication graph reads the same values for the spatial grid (see SandboxReplicationGraph).
+*/
+
+
+USTRUCT(BlueprintType)
+struct SANDBOX_API FBhopNetPolicySettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // The update frequency when standing still
+		float MinUpdateFrequency = 33.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // The update frequency at or above FullRateSpeed
+		float MaxUpdateFrequency = 66.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // The xy speed where we update at the max frequency
+		float FullRateSpeed = 2400.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // How much extra priority a character gets when it's closing in on the viewer at FullRateSpeed
+		float ApproachPriorityScale = 2.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // Characters within this distance of the viewer always get the full approach priority
+		float NearViewerDistance = 1500.f;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network")
+		float MaxPriorityScale = 4.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Network") // The relevancy distance is extended by how far the character travels in this amount of time
+		float RelevancyLookAheadTime = 0.5f;
+};
+
+
+namespace BhopNetPolicy
+{
+	/** The update frequency for a character moving at Speed */
+	SANDBOX_API float GetUpdateFrequency(const FBhopNetPolicySettings& Settings, float Speed);
+
+	/** The multiplier for the net priority of a character from the viewer's point of view, biased towards characters that are approaching the viewer quickly */
+	SANDBOX_API float GetPriorityScale(const FBhopNetPolicySettings& Settings, const FVector& Location, const FVector& Velocity, const FVector& ViewLocation, const FVector& ViewDirection);
+
+	/** The squared relevancy distance for a character moving at Speed (BaseCullDistanceSquared is the distance when standing still) */
+	SANDBOX_API float GetCullDistanceSquared(const FBhopNetPolicySettings& Settings, float BaseCullDistanceSquared, float Speed);
+}
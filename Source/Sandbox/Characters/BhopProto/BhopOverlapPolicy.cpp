@@ -0,0 +1,185 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopOverlapPolicy.h"
+#include "GameFramework/Character.h"
+#include "Components/CapsuleComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Engine/World.h"
+#include "BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Overlap Policy"), STAT_Bhop_OverlapPolicy, STATGROUP_Bhop);
+
+
+FBhopOverlapPolicySettings::FBhopOverlapPolicySettings()
+{
+	// Pickups and triggers are usually world dynamic
+	ObjectTypes.Add(UEngineTypes::ConvertToObjectType(ECC_WorldDynamic));
+}
+
+
+void FBhopOverlapTracker::SetApplied(ACharacter* Character, bool bApply)
+{
+	if (!Character || bApply == bApplied) return;
+	UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	USkeletalMeshComponent* Mesh = Character->GetMesh();
+
+	if (bApply)
+	{
+		bCapsuleGeneratedOverlaps = Capsule && Capsule->GetGenerateOverlapEvents();
+		bMeshGeneratedOverlaps = Mesh && Mesh->GetGenerateOverlapEvents();
+		if (Capsule) Capsule->SetGenerateOverlapEvents(false);
+		if (Mesh) Mesh->SetGenerateOverlapEvents(false);
+		bApplied = true;
+		return;
+	}
+
+	// End ours before the engine's take over again
+	bApplied = false;
+	for (int32 Index = Overlaps.Num() - 1; Index >= 0; Index--)
+	{
+		UPrimitiveComponent* Other = Overlaps[Index].Get();
+		Overlaps.RemoveAt(Index, 1, false);
+		if (Other) EndOverlap(Character, Other);
+	}
+	if (Mesh) Mesh->SetGenerateOverlapEvents(bMeshGeneratedOverlaps);
+	if (Capsule)
+	{
+		Capsule->SetGenerateOverlapEvents(bCapsuleGeneratedOverlaps);
+		Capsule->UpdateOverlaps();
+	}
+}
+
+
+void FBhopOverlapTracker::Update(ACharacter* Character, const FBhopOverlapPolicySettings& Settings, const FVector& OldLocation)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_OverlapPolicy);
+	UCapsuleComponent* Capsule = Character ? Character->GetCapsuleComponent() : nullptr;
+	UWorld* World = Character ? Character->GetWorld() : nullptr;
+	if (!Capsule || !World || Settings.ObjectTypes.Num() == 0) return;
+
+	// Nothing changes if we didn't move
+	const FVector Location = Capsule->GetComponentLocation();
+	if (Location.Equals(OldLocation, 0.f)) return;
+
+	const FCollisionShape Shape = Capsule->GetCollisionShape();
+	const FQuat Rotation = Capsule->GetComponentQuat();
+	FCollisionObjectQueryParams ObjectParams;
+	for (const TEnumAsByte<EObjectTypeQuery>& ObjectType : Settings.ObjectTypes) ObjectParams.AddObjectTypesToQuery(UEngineTypes::ConvertToCollisionChannel(ObjectType));
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(BhopOverlapPolicy), false, Character);
+
+	// What we're in at the end of the move
+	NewOverlaps.Reset();
+	OverlapResults.Reset();
+	World->OverlapMultiByObjectType(OverlapResults, Location, Rotation, ObjectParams, Shape, Params);
+	for (const FOverlapResult& Result : OverlapResults)
+	{
+		UPrimitiveComponent* Other = Result.GetComponent();
+		if (IsRelevant(Other, Character, Settings)) NewOverlaps.AddUnique(Other);
+	}
+
+	// What we went through on the way, a fast move can be past a pickup by the end of it
+	if (FVector::DistSquared(OldLocation, Location) > FMath::Square(Shape.GetCapsuleRadius()))
+	{
+		SweepHits.Reset();
+		World->SweepMultiByObjectType(SweepHits, OldLocation, Location, Rotation, ObjectParams, Shape, Params);
+		for (const FHitResult& Hit : SweepHits)
+		{
+			UPrimitiveComponent* Other = Hit.GetComponent();
+			if (!IsRelevant(Other, Character, Settings) || NewOverlaps.Contains(Other) || Overlaps.Contains(Other)) continue;
+			BeginOverlap(Character, Other);
+			if (IsValid(Other)) EndOverlap(Character, Other);
+		}
+	}
+
+	// End the ones we've left, then begin the new ones (each is taken off or put on the list first, so the actors are only told about their first and last component)
+	for (int32 Index = Overlaps.Num() - 1; Index >= 0; Index--)
+	{
+		if (NewOverlaps.Contains(Overlaps[Index])) continue;
+		UPrimitiveComponent* Other = Overlaps[Index].Get();
+		Overlaps.RemoveAt(Index, 1, false);
+		if (Other && IsValid(Character)) EndOverlap(Character, Other);
+	}
+	for (const TWeakObjectPtr<UPrimitiveComponent>& New : NewOverlaps)
+	{
+		UPrimitiveComponent* Other = New.Get();
+		if (!Other || Overlaps.Contains(New) || !IsValid(Character)) continue;
+		Overlaps.Add(New);
+		BeginOverlap(Character, Other);
+	}
+}
+
+
+bool FBhopOverlapTracker::IsRelevant(const UPrimitiveComponent* Component, const ACharacter* Character, const FBhopOverlapPolicySettings& Settings) const
+{
+	if (!Component || !Component->GetGenerateOverlapEvents()) return false;
+	const AActor* Owner = Component->GetOwner();
+	if (!Owner || Owner == Character) return false;
+	if (Settings.ActorClasses.Num() == 0) return true;
+
+	for (const TSubclassOf<AActor>& ActorClass : Settings.ActorClasses)
+	{
+		if (ActorClass && Owner->IsA(ActorClass)) return true;
+	}
+	return false;
+}
+
+
+bool FBhopOverlapTracker::IsOverlappingActor(const AActor* Actor, const UPrimitiveComponent* Except) const
+{
+	for (const TWeakObjectPtr<UPrimitiveComponent>& Overlap : Overlaps)
+	{
+		const UPrimitiveComponent* Component = Overlap.Get();
+		if (Component && Component != Except && Component->GetOwner() == Actor) return true;
+	}
+	return false;
+}
+
+
+void FBhopOverlapTracker::BeginOverlap(ACharacter* Character, UPrimitiveComponent* Other)
+{
+	UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	AActor* OtherActor = Other->GetOwner();
+	const FHitResult NoSweep;
+
+	// The same order as UPrimitiveComponent::BeginComponentOverlap, the actors are only told about the other actor's first component
+	const bool bNotifyActors = !IsOverlappingActor(OtherActor, Other);
+	Other->OnComponentBeginOverlap.Broadcast(Other, Character, Capsule, INDEX_NONE, false, NoSweep);
+	if (IsValid(Capsule) && IsValid(Other)) Capsule->OnComponentBeginOverlap.Broadcast(Capsule, OtherActor, Other, INDEX_NONE, false, NoSweep);
+	if (!bNotifyActors) return;
+
+	if (IsValid(Character) && IsValid(OtherActor))
+	{
+		Character->NotifyActorBeginOverlap(OtherActor);
+		Character->OnActorBeginOverlap.Broadcast(Character, OtherActor);
+	}
+	if (IsValid(Character) && IsValid(OtherActor))
+	{
+		OtherActor->NotifyActorBeginOverlap(Character);
+		OtherActor->OnActorBeginOverlap.Broadcast(OtherActor, Character);
+	}
+}
+
+
+void FBhopOverlapTracker::EndOverlap(ACharacter* Character, UPrimitiveComponent* Other)
+{
+	UCapsuleComponent* Capsule = Character->GetCapsuleComponent();
+	AActor* OtherActor = Other->GetOwner();
+
+	const bool bNotifyActors = !IsOverlappingActor(OtherActor, Other);
+	Other->OnComponentEndOverlap.Broadcast(Other, Character, Capsule, INDEX_NONE);
+	if (IsValid(Capsule) && IsValid(Other)) Capsule->OnComponentEndOverlap.Broadcast(Capsule, OtherActor, Other, INDEX_NONE);
+	if (!bNotifyActors) return;
+
+	if (IsValid(Character) && IsValid(OtherActor))
+	{
+		Character->NotifyActorEndOverlap(OtherActor);
+		Character->OnActorEndOverlap.Broadcast(Character, OtherActor);
+	}
+	if (IsValid(Character) && IsValid(OtherActor))
+	{
+		OtherActor->NotifyActorEndOverlap(Character);
+		OtherActor->OnActorEndOverlap.Broadcast(OtherActor, Character);
+	}
+}
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "BhopOverlapPolicy.generated.h"
+
+
+/*
+	Overlap policy for the character capsules
+
+	With overlap events on, every move the capsule (and the mesh attached to it) gathers the overlaps along its sweep and then runs UpdateOverlaps against everything
+	in its bounds that isn't ignored, and at bhop speeds with a lot of players that's a big part of what MoveUpdatedComponent costs.
+	The policy is opt in (bEnabled on the movement component's OverlapPolicy), and with it on the capsule and mesh don't generate overlap events at all, the movement component runs one query of its own after each move instead:
+		- An overlap at the end of the move, only against the ObjectTypes in the settings (the channels pickups, hazards and triggers are on), and optionally only ActorClasses
+		- A sweep from the start of the move when it went further than the capsule's radius, so a fast move doesn't skip over a pickup (it begins and ends in the same move)
+		- Only components that generate overlap events themselves count, the same as the engine
+		- Nothing runs when the move didn't go anywhere, like the engine skips its overlap update for a zero delta
+	The begins and ends go out through the same delegates and notifies as the engine's (OnComponentBeginOverlap on both components, NotifyActorBeginOverlap and OnActorBeginOverlap on both actors),
+	but the overlaps aren't in the capsule's OverlappingComponents, so use the events rather than GetOverlappingActors. Checkpoints don't need either, they're timed from the moves (see BhopCheckpointIndex.h).
+	Only characters that perform moves (the server and the owning client) run the query, simulated proxies don't get overlap events with the policy on.
+
+	Sandbox.OverlapPolicy.Enable turns it off everywhere. The headless movement benchmark times MoveUpdatedComponent with and without it on the benchmark course with -OverlapPolicy
+	(see SandboxMovementBenchmarkCommandlet.h), so the timing never moves characters or fires overlaps in a running game.
+*/
+
+
+USTRUCT(BlueprintType)
+struct SANDBOX_API FBhopOverlapPolicySettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Overlaps") // Replace the capsule and mesh's overlap updates with the query below
+		bool bEnabled = false;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Overlaps", meta = (EditCondition = "bEnabled")) // The object types we can overlap (pickups, hazards, triggers)
+		TArray<TEnumAsByte<EObjectTypeQuery>> ObjectTypes;
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Bhop_Overlaps", meta = (EditCondition = "bEnabled")) // If there are any, only these actors are overlapped
+		TArray<TSubclassOf<AActor>> ActorClasses;
+
+	FBhopOverlapPolicySettings();
+};
+
+
+/**
+ * The overlaps the policy has begun for a character, and the flags it turned off
+ */
+class SANDBOX_API FBhopOverlapTracker
+{
+public:
+	/** Turns the capsule and mesh's overlap events off (and back on, ending the policy's overlaps) */
+	void SetApplied(class ACharacter* Character, bool bApply);
+	bool IsApplied() const { return bApplied; }
+
+	/** Runs the query after a move from OldLocation, and begins and ends the overlaps that changed */
+	void Update(class ACharacter* Character, const FBhopOverlapPolicySettings& Settings, const FVector& OldLocation);
+
+	int32 GetNumOverlaps() const { return Overlaps.Num(); }
+
+
+private:
+	bool IsRelevant(const class UPrimitiveComponent* Component, const class ACharacter* Character, const FBhopOverlapPolicySettings& Settings) const;
+	bool IsOverlappingActor(const AActor* Actor, const class UPrimitiveComponent* Except) const;
+	void BeginOverlap(class ACharacter* Character, class UPrimitiveComponent* Other);
+	void EndOverlap(class ACharacter* Character, class UPrimitiveComponent* Other);
+
+	bool bApplied = false;
+	bool bCapsuleGeneratedOverlaps = false;
+	bool bMeshGeneratedOverlaps = false;
+
+	TArray<TWeakObjectPtr<class UPrimitiveComponent>> Overlaps;
+
+	// Reused for every query
+	TArray<FOverlapResult> OverlapResults;
+	TArray<FHitResult> SweepHits;
+	TArray<TWeakObjectPtr<class UPrimitiveComponent>> NewOverlaps;
+};
@@ -0,0 +1,206 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopProfiler.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/CoreDelegates.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+DEFINE_STAT(STAT_Bhop_HandleMovement);
+DEFINE_STAT(STAT_Bhop_AccelerateGround);
+DEFINE_STAT(STAT_Bhop_AccelerateAir);
+DEFINE_STAT(STAT_Bhop_RampCheck);
+DEFINE_STAT(STAT_Bhop_ApplyTrimp);
+DEFINE_STAT(STAT_Bhop_MoveAutonomous);
+DEFINE_STAT(STAT_Bhop_OnMovementUpdated);
+
+
+#pragma region Console
+static int32 GBhopProfileEnabled = 0;
+static FAutoConsoleVariableRef CVarBhopProfileEnable(
+	TEXT("Bhop.Profile.Enable"),
+	GBhopProfileEnabled,
+	TEXT("Records the per frame time of the bhop movement functions for Bhop.Profile.DumpCSV. 0: off, 1: on"),
+	FConsoleVariableDelegate::CreateLambda([](IConsoleVariable*)
+	{
+		// Make sure the end of frame hook is registered as soon as recording is turned on
+		if (GBhopProfileEnabled) FBhopFrameProfiler::Get();
+	}),
+	ECVF_Default
+);
+
+static FAutoConsoleCommand BhopProfileResetCommand(
+	TEXT("Bhop.Profile.Reset"),
+	TEXT("Clears the recorded bhop frame histogram"),
+	FConsoleCommandDelegate::CreateLambda([]()
+	{
+		FBhopFrameProfiler::Get().Reset();
+	})
+);
+
+static FAutoConsoleCommand BhopProfileDumpCommand(
+	TEXT("Bhop.Profile.DumpCSV"),
+	TEXT("Writes the p50/p95/p99 of the bhop movement functions to Saved/Profiling/Bhop. Usage: Bhop.Profile.DumpCSV [FileName]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const FString FileName = Args.Num() > 0 ? Args[0] : FString::Printf(TEXT("BhopProfile_%s"), *FDateTime::Now().ToString());
+		FBhopFrameProfiler::Get().ExportCSV(FileName);
+	})
+);
+#pragma endregion
+
+
+#pragma region Profiler
+FBhopFrameProfiler& FBhopFrameProfiler::Get()
+{
+	static FBhopFrameProfiler Profiler;
+	return Profiler;
+}
+
+
+bool FBhopFrameProfiler::IsEnabled()
+{
+	return GBhopProfileEnabled != 0;
+}
+
+
+FBhopFrameProfiler::FBhopFrameProfiler()
+{
+	for (int32 Scope = 0; Scope < NumScopes; Scope++)
+	{
+		FrameHistory[Scope].SetNumZeroed(MaxFrames);
+		CallHistory[Scope].SetNumZeroed(MaxFrames);
+	}
+	Reset();
+
+	EndFrameHandle = FCoreDelegates::OnEndFrame.AddLambda([this]()
+	{
+		if (IsEnabled()) EndFrame();
+	});
+}
+
+
+FBhopFrameProfiler::~FBhopFrameProfiler()
+{
+	FCoreDelegates::OnEndFrame.Remove(EndFrameHandle);
+}
+
+
+void FBhopFrameProfiler::AddSample(EBhopProfileScope Scope, uint64 Cycles)
+{
+	const int32 Index = static_cast<int32>(Scope);
+	FrameCycles[Index] += Cycles;
+	FrameCalls[Index]++;
+}
+
+
+void FBhopFrameProfiler::EndFrame()
+{
+	for (int32 Scope = 0; Scope < NumScopes; Scope++)
+	{
+		FrameHistory[Scope][HistoryHead] = static_cast<float>(FPlatformTime::ToMilliseconds64(FrameCycles[Scope]));
+		CallHistory[Scope][HistoryHead] = FrameCalls[Scope];
+		FrameCycles[Scope] = 0;
+		FrameCalls[Scope] = 0;
+	}
+
+	HistoryHead = (HistoryHead + 1) % MaxFrames;
+	NumFrames = FMath::Min(NumFrames + 1, MaxFrames);
+}
+
+
+void FBhopFrameProfiler::Reset()
+{
+	FMemory::Memzero(FrameCycles);
+	FMemory::Memzero(FrameCalls);
+	HistoryHead = 0;
+	NumFrames = 0;
+}
+
+
+float FBhopFrameProfiler::GetPercentile(EBhopProfileScope Scope, float Percentile) const
+{
+	if (NumFrames == 0) return 0.f;
+
+	// The oldest frames are overwritten first, so the first NumFrames entries are always valid once the buffer wraps around
+	TArray<float> Sorted(FrameHistory[static_cast<int32>(Scope)].GetData(), NumFrames);
+	Sorted.Sort();
+
+	const int32 Index = FMath::Clamp(FMath::CeilToInt(Percentile * NumFrames) - 1, 0, NumFrames - 1);
+	return Sorted[Index];
+}
+
+
+bool FBhopFrameProfiler::ExportCSV(const FString& FileName) const
+{
+	const FString Directory = FPaths::ProfilingDir() / TEXT("Bhop");
+
+	// Percentiles of each scope
+	FString Summary = TEXT("Scope,Frames,MeanMs,P50Ms,P95Ms,P99Ms,MaxMs,AvgCallsPerFrame\n");
+	for (int32 Scope = 0; Scope < NumScopes; Scope++)
+	{
+		double TotalMs = 0.0;
+		uint64 TotalCalls = 0;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			TotalMs += FrameHistory[Scope][Frame];
+			TotalCalls += CallHistory[Scope][Frame];
+		}
+
+		const EBhopProfileScope ProfileScope = static_cast<EBhopProfileScope>(Scope);
+		const int32 Frames = FMath::Max(NumFrames, 1);
+		Summary += FString::Printf(TEXT("%s,%d,%.4f,%.4f,%.4f,%.4f,%.4f,%.2f\n"),
+			GetScopeName(ProfileScope),
+			NumFrames,
+			TotalMs / Frames,
+			GetPercentile(ProfileScope, 0.5f),
+			GetPercentile(ProfileScope, 0.95f),
+			GetPercentile(ProfileScope, 0.99f),
+			GetPercentile(ProfileScope, 1.f),
+			static_cast<double>(TotalCalls) / Frames
+		);
+	}
+
+	// The raw frames, oldest first
+	FString Frames = TEXT("Frame");
+	for (int32 Scope = 0; Scope < NumScopes; Scope++) Frames += FString::Printf(TEXT(",%sMs"), GetScopeName(static_cast<EBhopProfileScope>(Scope)));
+	Frames += TEXT("\n");
+	const int32 OldestFrame = NumFrames < MaxFrames ? 0 : HistoryHead;
+	for (int32 Frame = 0; Frame < NumFrames; Frame++)
+	{
+		const int32 Index = (OldestFrame + Frame) % MaxFrames;
+		Frames += FString::FromInt(Frame);
+		for (int32 Scope = 0; Scope < NumScopes; Scope++) Frames += FString::Printf(TEXT(",%.4f"), FrameHistory[Scope][Index]);
+		Frames += TEXT("\n");
+	}
+
+	const FString SummaryPath = Directory / (FileName + TEXT(".csv"));
+	const FString FramesPath = Directory / (FileName + TEXT("_Frames.csv"));
+	if (!FFileHelper::SaveStringToFile(Summary, *SummaryPath) || !FFileHelper::SaveStringToFile(Frames, *FramesPath))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Bhop.Profile.DumpCSV: Failed to write %s"), *SummaryPath);
+		return false;
+	}
+
+	UE_LOG(LogTemp, Log, TEXT("Bhop.Profile.DumpCSV: Wrote %d frames to %s"), NumFrames, *SummaryPath);
+	return true;
+}
+
+
+const TCHAR* FBhopFrameProfiler::GetScopeName(EBhopProfileScope Scope)
+{
+	switch (Scope)
+	{
+	case EBhopProfileScope::HandleMovement:		return TEXT("HandleMovement");
+	case EBhopProfileScope::AccelerateGround:	return TEXT("AccelerateGround");
+	case EBhopProfileScope::AccelerateAir:		return TEXT("AccelerateAir");
+	case EBhopProfileScope::RampCheck:			return TEXT("RampCheck");
+	case EBhopProfileScope::ApplyTrimp:			return TEXT("ApplyTrimp");
+	case EBhopProfileScope::MoveAutonomous:		return TEXT("MoveAutonomous");
+	case EBhopProfileScope::OnMovementUpdated:	return TEXT("OnMovementUpdated");
+	default:									return TEXT("Invalid");
+	}
+}
+#pragma endregion
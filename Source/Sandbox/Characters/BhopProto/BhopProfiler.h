@@ -0,0 +1,124 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+
+/*
+	Frame time profiling for the bhop pipeline
+
+	Every scope shows up in three places:
+		- "stat Bhop" in the console (cycle stats)
+		- Unreal Insights (cpu profiler trace events)
+		- The frame histogram below, which keeps the total time of each scope per frame so we can pull the p50/p95/p99 and catch tail latency spikes
+
+	Console commands:
+		- Bhop.Profile.Enable 1					Start recording the frame histogram (off by default)
+		- Bhop.Profile.Reset					Clear the recorded frames
+		- Bhop.Profile.DumpCSV [FileName]		Writes the percentiles to Saved/Profiling/Bhop/<FileName>.csv, and the raw frames to <FileName>_Frames.csv
+
+	Only use the scopes on the game thread, the histogram isn't thread safe.
+*/
+
+
+DECLARE_STATS_GROUP(TEXT("Bhop"), STATGROUP_Bhop, STATCAT_Advanced);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("HandleMovement"), STAT_Bhop_HandleMovement, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AccelerateGround"), STAT_Bhop_AccelerateGround, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("AccelerateAir"), STAT_Bhop_AccelerateAir, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("RampCheck"), STAT_Bhop_RampCheck, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("ApplyTrimp"), STAT_Bhop_ApplyTrimp, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("MoveAutonomous"), STAT_Bhop_MoveAutonomous, STATGROUP_Bhop, SANDBOX_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("OnMovementUpdated"), STAT_Bhop_OnMovementUpdated, STATGROUP_Bhop, SANDBOX_API);
+
+
+/** The scopes recorded in the frame histogram, these match the cycle stats above */
+enum class EBhopProfileScope : uint8
+{
+	HandleMovement,
+	AccelerateGround,
+	AccelerateAir,
+	RampCheck,
+	ApplyTrimp,
+	MoveAutonomous,
+	OnMovementUpdated,
+
+	MAX
+};
+
+
+/**
+ * Keeps the total time spent in each bhop scope for the last few thousand frames
+ */
+class SANDBOX_API FBhopFrameProfiler
+{
+public:
+	static FBhopFrameProfiler& Get();
+
+	/** Whether the frame histogram is recording (Bhop.Profile.Enable) */
+	static bool IsEnabled();
+
+	/** Adds the time of a single call to the current frame */
+	void AddSample(EBhopProfileScope Scope, uint64 Cycles);
+
+	/** Pushes the current frame's totals into the history. Called at the end of every frame while enabled */
+	void EndFrame();
+
+	void Reset();
+
+	/** Writes the percentiles (and the raw frames) to a csv file, returns false if the file couldn't be saved */
+	bool ExportCSV(const FString& FileName) const;
+
+	static const TCHAR* GetScopeName(EBhopProfileScope Scope);
+
+
+private:
+	FBhopFrameProfiler();
+	~FBhopFrameProfiler();
+
+	/** Returns the Percentile (0-1) of the recorded frames for a scope, in milliseconds */
+	float GetPercentile(EBhopProfileScope Scope, float Percentile) const;
+
+	static constexpr int32 NumScopes = static_cast<int32>(EBhopProfileScope::MAX);
+	static constexpr int32 MaxFrames = 4096; // ~68 seconds of frames at 60 fps
+
+	// The current frame
+	uint64 FrameCycles[NumScopes];
+	uint32 FrameCalls[NumScopes];
+
+	// Ring buffers of the previous frames (in milliseconds)
+	TArray<float> FrameHistory[NumScopes];
+	TArray<uint32> CallHistory[NumScopes];
+	int32 HistoryHead = 0;
+	int32 NumFrames = 0;
+
+	FDelegateHandle EndFrameHandle;
+};
+
+
+/** Times a scope for the frame histogram */
+struct FBhopProfileScopeTimer
+{
+	FORCEINLINE FBhopProfileScopeTimer(EBhopProfileScope InScope)
+		: Scope(InScope)
+		, StartCycles(FBhopFrameProfiler::IsEnabled() ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	FORCEINLINE ~FBhopProfileScopeTimer()
+	{
+		if (StartCycles != 0) FBhopFrameProfiler::Get().AddSample(Scope, FPlatformTime::Cycles64() - StartCycles);
+	}
+
+	EBhopProfileScope Scope;
+	uint64 StartCycles;
+};
+
+
+// Cycle stat, insights event, and frame histogram for one of the EBhopProfileScope scopes
+#define BHOP_PROFILE_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_##Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE(Bhop_##Name); \
+	FBhopProfileScopeTimer BhopProfileScopeTimer_##Name(EBhopProfileScope::Name)
@@ -0,0 +1,85 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+	Movement input registry
+
+	The compressed flags only leave four custom bits (FLAG_Custom_0 - FLAG_Custom_3), and every component that encoded something in them had to agree on which bit meant what.
+	Instead every predicted mechanic gets a bit in FMovementInputFlags, which is saved in the saved move and sent in the network move data of both movement components.
+	Only as many bits as there are registered mechanics are written to the network, so a new mechanic costs one bit per move instead of a float.
+
+	To add a new mechanic:
+		- Add it to the end of EMovementInput (above MAX), and give it a name in FMovementInputFlags::GetMechanicName
+		- Set it from the safe variable in the movement component's GetMovementInput, and read it back in ApplyMovementInput
+	Don't reorder the entries, the client and the server have to agree on the bit for each mechanic.
+*/
+
+
+/** The mechanics that need a predicted input bit. The index is the bit */
+enum class EMovementInput : uint8
+{
+	Sprint,
+	JumpHeld, // Jump buffer and auto hop
+	CrouchJump,
+	Slide,
+
+	MAX
+};
+
+
+/** Bitfield of the movement inputs that were active for a move */
+struct FMovementInputFlags
+{
+	typedef uint16 FStorage;
+	static constexpr int32 NumBits = static_cast<int32>(EMovementInput::MAX);
+	static_assert(NumBits <= sizeof(FStorage) * 8, "Too many movement inputs registered, increase the size of FMovementInputFlags::FStorage");
+
+	FStorage Bits = 0;
+
+	FORCEINLINE static FStorage GetMask(EMovementInput Input) { return static_cast<FStorage>(1u << static_cast<uint8>(Input)); }
+	FORCEINLINE bool Get(EMovementInput Input) const { return (Bits & GetMask(Input)) != 0; }
+	FORCEINLINE void Set(EMovementInput Input, bool bEnabled)
+	{
+		if (bEnabled) Bits |= GetMask(Input);
+		else Bits &= ~GetMask(Input);
+	}
+
+	FORCEINLINE void Clear() { Bits = 0; }
+	FORCEINLINE bool operator==(const FMovementInputFlags& Other) const { return Bits == Other.Bits; }
+	FORCEINLINE bool operator!=(const FMovementInputFlags& Other) const { return Bits != Other.Bits; }
+
+	/** Packs (or unpacks) only the registered bits */
+	void Serialize(FArchive& Ar)
+	{
+		if (Ar.IsLoading()) Bits = 0;
+		Ar.SerializeBits(&Bits, NumBits);
+	}
+
+	/** The registered name of each mechanic (for logging/debugging) */
+	static const TCHAR* GetMechanicName(EMovementInput Input)
+	{
+		switch (Input)
+		{
+		case EMovementInput::Sprint:		return TEXT("Sprint");
+		case EMovementInput::JumpHeld:		return TEXT("JumpHeld");
+		case EMovementInput::CrouchJump:	return TEXT("CrouchJump");
+		case EMovementInput::Slide:			return TEXT("Slide");
+		default:							return TEXT("Invalid");
+		}
+	}
+
+	FString ToString() const
+	{
+		FString Result;
+		for (int32 Bit = 0; Bit < NumBits; Bit++)
+		{
+			const EMovementInput Input = static_cast<EMovementInput>(Bit);
+			if (Get(Input)) Result += Result.IsEmpty() ? GetMechanicName(Input) : FString::Printf(TEXT("|%s"), GetMechanicName(Input));
+		}
+		return Result.IsEmpty() ? TEXT("None") : Result;
+	}
+};
@@ -35,6 +35,8 @@
 #include "Sandbox/GAS/ProtoAttributeSet.h" // AttributeSet
 #include "Sandbox/GAS/ProtoGasGameplayAbility.h" // GameplayAbility
 #include <GameplayEffectTypes.h> // Gameplay effect types
+#include "Sandbox/SandboxMemory.h"
+#include "Sandbox/Networking/SandboxNetStats.h"
 
 
 
@@ -42,6 +44,7 @@
 AProtoCharacter::AProtoCharacter(const FObjectInitializer& ObjectInitializer) : Super(ObjectInitializer) 
 {
 	// Create ability system component, and set it to be explicitly replicated
+	LLM_SCOPE_BYTAG(Sandbox_Abilities);
 	AbilitySystemComponent = CreateDefaultSubobject<UProtoASC>(TEXT("AbilitySystemComponent"));
 	AbilitySystemComponent->SetIsReplicated(true);
 	AbilitySystemComponent->SetReplicationMode(EGameplayEffectReplicationMode::Minimal);
@@ -57,6 +60,13 @@ void AProtoCharacter::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutL
 }
 
 
+void AProtoCharacter::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+	SandboxPushModel::MeasureSavedCompares(Attributes); // The attribute set is replicated with us (see SandboxNetStats.h)
+}
+
+
 void AProtoCharacter::PostInitializeComponents()
 {
 	Super::PostInitializeComponents();
@@ -114,6 +124,7 @@ void AProtoCharacter::PossessedBy(AController* NewController)
 	Super::PossessedBy(NewController);
 
 	// Initialize the ASC on the server
+	LLM_SCOPE_BYTAG(Sandbox_Abilities);
 	if (AbilitySystemComponent)
 	{
 		AbilitySystemComponent->InitAbilityActorInfo(this, this);
@@ -159,6 +170,7 @@ void AProtoCharacter::InitializeAttributes()
 		{
 			// Take the ability system component and apply the gameplay effect to it (function names are ApplyGameplayEffectSpecToSelf ApplyGameplayEffectSpecToTarget, etc.)
 			FActiveGameplayEffectHandle GEHandle = AbilitySystemComponent->ApplyGameplayEffectSpecToSelf(*SpecHandle.Data.Get());
+			if (GEHandle.WasSuccessfullyApplied()) bAttributesInitialized = true;
 		}
 	}
 }
@@ -59,6 +59,7 @@ class SANDBOX_API AProtoCharacter : public ABaseCharacterConfiguration, public I
 public:
 	AProtoCharacter(const FObjectInitializer& ObjectInitializer);
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 	virtual void PostInitializeComponents() override;
 	virtual void SetupPlayerInputComponent(class UInputComponent* PlayerInputComponent) override;
 
@@ -112,6 +113,7 @@ public:
 		TSubclassOf<class UGameplayEffect> DefaultAttributeSet;
 	UPROPERTY(BlueprintReadOnly, EditDefaultsOnly, Category = "Attribute Gas")
 		TArray<TSubclassOf<class UProtoGasGameplayAbility>> DefaultAbilities;
+	bool bAttributesInitialized = false;
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -125,6 +127,8 @@ public:
 // Getters and Setters													//
 //////////////////////////////////////////////////////////////////////////
 public:
+	/** Whether the default attribute effect has been applied, until then the attributes are just their defaults */
+	FORCEINLINE bool AreAttributesInitialized() const { return bAttributesInitialized; }
 
 
 
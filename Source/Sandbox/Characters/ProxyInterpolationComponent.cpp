@@ -0,0 +1,183 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProxyInterpolationComponent.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "HAL/IConsoleManager.h"
+#include "Sandbox/Networking/SandboxNetStats.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Proxy Interpolation"), STAT_SandboxNet_ProxyInterpolation, STATGROUP_SandboxNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interpolated Proxies"), STAT_SandboxNet_InterpolatedProxies, STATGROUP_SandboxNet);
+
+
+UProxyInterpolationComponent::UProxyInterpolationComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = true;
+	PrimaryComponentTick.TickGroup = TG_PrePhysics;
+	SetIsReplicatedByDefault(false);
+}
+
+
+void UProxyInterpolationComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Nothing to do on the server or for our own character, other than making sure the updates are stamped with the server's time
+	if (GetNetMode() != NM_Client)
+	{
+		ACharacter* Character = Cast<ACharacter>(GetOwner());
+		if (Character && Character->GetCharacterMovement()) Character->GetCharacterMovement()->bNetworkAlwaysReplicateTransformUpdateTimestamp = true;
+		SetComponentTickEnabled(false);
+	}
+}
+
+
+void UProxyInterpolationComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	SetInterpolating(false);
+	Super::EndPlay(EndPlayReason);
+}
+
+
+bool UProxyInterpolationComponent::ShouldInterpolate() const
+{
+	const ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (!bEnableProxyInterpolation || !Character || GetNetMode() != NM_Client || Character->GetLocalRole() != ROLE_SimulatedProxy) return false;
+
+	// Movement on a moving base is replicated relative to the base, the movement component handles that
+	return !Character->GetReplicatedBasedMovement().HasRelativeLocation();
+}
+
+
+bool UProxyInterpolationComponent::AddSnapshotFromReplicatedMovement()
+{
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	if (!Character) return false;
+
+	// Stamped with the server's time for this update (bNetworkAlwaysReplicateTransformUpdateTimestamp), the same clock as the movement components' smoothing
+	const FRepMovement& RepMovement = Character->GetReplicatedMovement();
+	const FVector Location = FRepMovement::RebaseOntoLocalOrigin(RepMovement.Location, Character);
+	ProxySmoothing::AddReplicatedSnapshot(Snapshots, Character, Location, RepMovement.LinearVelocity, RepMovement.Rotation.Quaternion(), TeleportDistance, Character->GetReplicatedMovementMode());
+
+	// Only stop the movement component once there's something to render, otherwise the proxy would just freeze
+	if (Snapshots.Num() == 0) return false;
+	SetInterpolating(true);
+	return true;
+}
+
+
+void UProxyInterpolationComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+	SCOPE_CYCLE_COUNTER(STAT_SandboxNet_ProxyInterpolation);
+
+	if (!ShouldInterpolate())
+	{
+		SetInterpolating(false);
+		return;
+	}
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	FVector Location, Velocity;
+	FQuat Rotation;
+	uint8 MovementMode = 0;
+	if (!bIsInterpolating || !Snapshots.Sample(GetWorld()->GetTimeSeconds(), InterpolationDelay, MaxExtrapolationTime, Location, Rotation, &Velocity, &MovementMode)) return;
+	INC_DWORD_STAT(STAT_SandboxNet_InterpolatedProxies);
+
+	// Move the whole actor there (no sweeps or physics), and give the movement component the velocity for the animations
+	Character->SetActorLocationAndRotation(Location, Rotation, false, nullptr, ETeleportType::TeleportPhysics);
+	UCharacterMovementComponent* CharacterMovement = Character->GetCharacterMovement();
+	if (!CharacterMovement) return;
+	CharacterMovement->Velocity = Velocity;
+
+	// The movement mode is normally applied in the movement component's simulated tick, which is off while we're interpolating.
+	// Apply the rendered snapshot's mode so OnMovementModeChanged fires on the proxies as they're shown landing (landing cosmetics, the ramp and friction logic, and the falling animation state)
+	if (MovementMode != CharacterMovement->PackNetworkMovementMode()) CharacterMovement->ApplyNetworkMovementMode(MovementMode);
+}
+
+
+void UProxyInterpolationComponent::SetInterpolating(bool bInterpolating)
+{
+	if (bIsInterpolating == bInterpolating) return;
+	bIsInterpolating = bInterpolating;
+
+	ACharacter* Character = Cast<ACharacter>(GetOwner());
+	UCharacterMovementComponent* CharacterMovement = Character ? Character->GetCharacterMovement() : nullptr;
+	if (!CharacterMovement) return;
+
+	// The movement component only moves the capsule while we're interpolating, so clear any mesh offset its smoothing left behind
+	CharacterMovement->SetComponentTickEnabled(!bInterpolating);
+	if (bInterpolating && Character->GetMesh())
+	{
+		Character->GetMesh()->SetRelativeLocationAndRotation(Character->GetBaseTranslationOffset(), Character->GetBaseRotationOffset());
+	}
+
+	if (!bInterpolating) Snapshots.Reset();
+}
+
+
+#pragma region Benchmark
+static FAutoConsoleCommand ProxyInterpolationBenchmarkCommand(
+	TEXT("Sandbox.ProxyInterpolation.Benchmark"),
+	TEXT("Times sampling the snapshot buffers of a crowd of proxies (33hz snapshots, 144 fps). Usage: Sandbox.ProxyInterpolation.Benchmark [Proxies=100] [Frames=1440]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumProxies = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100;
+		const int32 Frames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1440;
+		const double FrameTime = 1.0 / 144.0;
+		const double SnapshotInterval = 1.0 / 33.0;
+
+		// Each proxy strafes in a circle at bhop speed, a little out of phase with the others
+		TArray<FProxySnapshotBuffer> Buffers;
+		Buffers.SetNum(NumProxies);
+		const auto GetProxyLocation = [](int32 Proxy, double Time, FVector& OutVelocity)
+		{
+			const double Angle = Time * 2.0 + Proxy;
+			OutVelocity = FVector(-FMath::Sin(Angle), FMath::Cos(Angle), 0.0) * 2400.0;
+			return FVector(FMath::Cos(Angle), FMath::Sin(Angle), 0.0) * 1200.0 + FVector(Proxy * 200.0, 0.0, 0.0);
+		};
+
+		uint64 SampleCycles = 0;
+		double NextSnapshotTime = 0.0;
+		double Error = 0.0;
+		int64 Samples = 0;
+		for (int32 Frame = 0; Frame < Frames; Frame++)
+		{
+			const double Time = Frame * FrameTime;
+			if (Time >= NextSnapshotTime)
+			{
+				for (int32 Proxy = 0; Proxy < NumProxies; Proxy++)
+				{
+					FVector Velocity;
+					const FVector Location = GetProxyLocation(Proxy, Time, Velocity);
+					Buffers[Proxy].AddSnapshot(Time, Location, Velocity, FQuat::Identity, Time, 384.f);
+				}
+				NextSnapshotTime += SnapshotInterval;
+			}
+
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			for (int32 Proxy = 0; Proxy < NumProxies; Proxy++)
+			{
+				FVector Location, Velocity;
+				FQuat Rotation;
+				if (Buffers[Proxy].Sample(Time, 0.1f, 0.1f, Location, Rotation, &Velocity))
+				{
+					// How far the rendered location is from where the proxy really was at the render time
+					FVector TrueVelocity;
+					Error += FVector::Dist(Location, GetProxyLocation(Proxy, Time - 0.1, TrueVelocity));
+					Samples++;
+				}
+			}
+			SampleCycles += FPlatformTime::Cycles64() - StartCycles;
+		}
+
+		const double TotalMs = FPlatformTime::ToMilliseconds64(SampleCycles);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.ProxyInterpolation.Benchmark: %d proxies, %d frames. %.4f ms per frame (%.1f ns per proxy), average error %.2f uu"),
+			NumProxies, Frames, TotalMs / Frames, TotalMs * 1000000.0 / (static_cast<double>(Frames) * NumProxies), Samples > 0 ? Error / Samples : 0.0);
+	})
+);
+#pragma endregion
@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "ProxySnapshotBuffer.h"
+#include "ProxyInterpolationComponent.generated.h"
+
+
+/**
+ * Snapshot interpolation for remote characters (simulated proxies)
+ *
+ * The character forwards each replicated transform here (PostNetReceiveLocationAndRotation) instead of to the movement component's smoothing,
+ * and this places the whole actor at InterpolationDelay behind the server every frame. While it's interpolating the movement component doesn't tick,
+ * so the proxies don't run any of the simulated movement (floor checks, sweeps, etc.), which is most of the cost of a crowd of remote players.
+ * The replicated movement mode is stored with each snapshot and applied once the render time reaches it, so the character's OnMovementModeChanged logic runs on the proxies
+ * when they're rendered landing (not when the update arrives, InterpolationDelay early).
+ * It's off by default, the movement components' Hermite smoothing (bUseHermiteProxySmoothing) is what the proxies use unless this is turned on, and it replaces that smoothing when it is.
+ *
+ * Console commands:
+ *		- Sandbox.ProxyInterpolation.Benchmark [Proxies] [Frames]		Times sampling the snapshot buffers of a crowd of proxies, compare with the movement component's simulated tick in "stat Character"
+ */
+UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
+class SANDBOX_API UProxyInterpolationComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+
+public:
+	UProxyInterpolationComponent();
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Whether the owner's replicated transforms should be sent here, only for simulated proxies on clients */
+	bool ShouldInterpolate() const;
+
+	/**
+	 * Adds the owner's latest replicated transform and movement mode to the snapshot buffer, and starts interpolating once there's a snapshot to interpolate from
+	 * @returns false if there isn't one yet (the update doesn't have the server's time stamp), and the movement component should handle the update instead
+	 */
+	bool AddSnapshotFromReplicatedMovement();
+
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(EditAnywhere, Category = "Proxy Interpolation") // Interpolate simulated proxies from the replicated snapshots instead of simulating their movement
+		bool bEnableProxyInterpolation = false;
+	UPROPERTY(EditAnywhere, Category = "Proxy Interpolation", meta = (EditCondition = "bEnableProxyInterpolation")) // How far (in seconds) behind the server the proxy is rendered, this should cover a couple of net updates
+		float InterpolationDelay = 0.1f;
+	UPROPERTY(EditAnywhere, Category = "Proxy Interpolation", meta = (EditCondition = "bEnableProxyInterpolation")) // The furthest (in seconds) a proxy is extrapolated when the snapshots are late
+		float MaxExtrapolationTime = 0.1f;
+	UPROPERTY(EditAnywhere, Category = "Proxy Interpolation", meta = (EditCondition = "bEnableProxyInterpolation")) // Snapshots further than this from where we expected them are treated as a teleport
+		float TeleportDistance = 384.f;
+
+
+private:
+	/** Turns the movement component's tick off while we're interpolating, and back on when we stop (possession, role changes, etc.) */
+	void SetInterpolating(bool bInterpolating);
+
+	FProxySnapshotBuffer Snapshots;
+	bool bIsInterpolating = false;
+};
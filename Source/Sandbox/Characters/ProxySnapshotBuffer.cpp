@@ -0,0 +1,158 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "ProxySnapshotBuffer.h"
+#include "GameFramework/Character.h"
+#include "GameFramework/CharacterMovementComponent.h"
+#include "Components/SkeletalMeshComponent.h"
+
+
+#pragma region Snapshot Buffer
+bool FProxySnapshotBuffer::AddSnapshot(double ServerTime, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, double LocalTime, float TeleportDistance, uint8 MovementMode)
+{
+	FProxySnapshot Snapshot;
+	Snapshot.ServerTime = ServerTime;
+	Snapshot.Location = Location;
+	Snapshot.Velocity = Velocity;
+	Snapshot.Rotation = Rotation;
+	Snapshot.MovementMode = MovementMode;
+
+	if (NumSnapshots > 0)
+	{
+		const FProxySnapshot& Newest = GetSnapshot(0);
+		const float Interval = static_cast<float>(ServerTime - Newest.ServerTime);
+		if (Interval <= 0.f) return false;
+
+		// A teleport (or a respawn), start over instead of smoothing through it
+		if (FVector::Dist(Extrapolate(Newest, Interval), Location) > TeleportDistance)
+		{
+			Reset();
+		}
+		else
+		{
+			Snapshot.Acceleration = (Velocity - Newest.Velocity) / Interval;
+			AverageInterval = FMath::Lerp(AverageInterval, FMath::Min(Interval, 0.5f), 0.1f);
+		}
+	}
+
+	// Only let the clock offset drift slowly, it's the packets that arrive late that would pull it back
+	const double Offset = LocalTime - ServerTime;
+	ServerTimeOffset = NumSnapshots == 0 ? Offset : FMath::Min(Offset, FMath::Lerp(ServerTimeOffset, Offset, 0.05));
+
+	Head = (Head + 1) % MaxSnapshots;
+	Snapshots[Head] = Snapshot;
+	NumSnapshots = FMath::Min(NumSnapshots + 1, MaxSnapshots);
+	return true;
+}
+
+
+bool FProxySnapshotBuffer::Sample(double LocalTime, float Delay, float MaxExtrapolationTime, FVector& OutLocation, FQuat& OutRotation, FVector* OutVelocity, uint8* OutMovementMode) const
+{
+	if (NumSnapshots == 0) return false;
+
+	const double RenderTime = LocalTime - ServerTimeOffset - Delay;
+	const FProxySnapshot& Newest = GetSnapshot(0);
+
+	// Past the newest snapshot, extrapolate for a little while then hold
+	if (RenderTime >= Newest.ServerTime || NumSnapshots == 1)
+	{
+		const float ExtrapolationTime = FMath::Clamp(static_cast<float>(RenderTime - Newest.ServerTime), 0.f, MaxExtrapolationTime);
+		OutLocation = Extrapolate(Newest, ExtrapolationTime);
+		OutRotation = Newest.Rotation;
+		if (OutVelocity) *OutVelocity = Newest.Velocity + Newest.Acceleration * ExtrapolationTime;
+		if (OutMovementMode) *OutMovementMode = Newest.MovementMode;
+		return true;
+	}
+
+	// Find the two snapshots around the render time
+	for (int32 Age = 1; Age < NumSnapshots; Age++)
+	{
+		const FProxySnapshot& From = GetSnapshot(Age);
+		const FProxySnapshot& To = GetSnapshot(Age - 1);
+		if (RenderTime < From.ServerTime && Age < NumSnapshots - 1) continue;
+
+		// Cubic Hermite between the two, the tangents are the velocities scaled to the interval
+		const float Interval = static_cast<float>(To.ServerTime - From.ServerTime);
+		const float Alpha = FMath::Clamp(static_cast<float>((RenderTime - From.ServerTime) / Interval), 0.f, 1.f);
+		OutLocation = FMath::CubicInterp(From.Location, From.Velocity * Interval, To.Location, To.Velocity * Interval, Alpha);
+		OutRotation = FQuat::Slerp(From.Rotation, To.Rotation, Alpha);
+		if (OutVelocity) *OutVelocity = FMath::CubicInterpDerivative(From.Location, From.Velocity * Interval, To.Location, To.Velocity * Interval, Alpha) / Interval;
+		if (OutMovementMode) *OutMovementMode = RenderTime >= To.ServerTime ? To.MovementMode : From.MovementMode;
+		return true;
+	}
+
+	return false;
+}
+
+
+void FProxySnapshotBuffer::Reset()
+{
+	Head = 0;
+	NumSnapshots = 0;
+}
+
+
+FVector FProxySnapshotBuffer::Extrapolate(const FProxySnapshot& Snapshot, float Time)
+{
+	return Snapshot.Location + Snapshot.Velocity * Time + 0.5f * Snapshot.Acceleration * Time * Time;
+}
+#pragma endregion
+
+
+#pragma region Proxy Smoothing
+namespace ProxySmoothing
+{
+	bool AddReplicatedSnapshot(FProxySnapshotBuffer& Snapshots, const ACharacter* Character, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, float TeleportDistance, uint8 MovementMode)
+	{
+		// Only the server's clock goes into the buffer, the local time is just used to estimate the offset to it
+		const float ServerTimeStamp = Character ? Character->GetReplicatedServerLastTransformUpdateTimeStamp() : 0.f;
+		if (ServerTimeStamp <= 0.f) return false;
+
+		return Snapshots.AddSnapshot(ServerTimeStamp, Location, Velocity, Rotation, Character->GetWorld()->GetTimeSeconds(), TeleportDistance, MovementMode);
+	}
+
+
+	bool SmoothCorrection(FProxySnapshotBuffer& Snapshots, UCharacterMovementComponent* Movement, const FVector& NewLocation, const FQuat& NewRotation)
+	{
+		ACharacter* Character = Movement->GetCharacterOwner();
+		if (!Movement->HasValidData() || Character->GetLocalRole() != ROLE_SimulatedProxy) return false;
+
+		// Out of order updates are still applied to the capsule, they're just not buffered
+		if (!AddReplicatedSnapshot(Snapshots, Character, NewLocation, Movement->Velocity, NewRotation, Movement->NetworkNoSmoothUpdateDistance) && Snapshots.Num() == 0) return false;
+
+		Movement->UpdatedComponent->SetWorldLocationAndRotation(NewLocation, NewRotation, false, nullptr, ETeleportType::TeleportPhysics);
+		return true;
+	}
+
+
+	bool SmoothClientPosition(FProxySnapshotBuffer& Snapshots, UCharacterMovementComponent* Movement, float InterpolationDelay, float MaxExtrapolationTime)
+	{
+		// Based movement is relative to the base and doesn't go through SmoothCorrection, so the engine handles that
+		ACharacter* Character = Movement->GetCharacterOwner();
+		const bool bUseSnapshots = Movement->HasValidData() && Character->GetLocalRole() == ROLE_SimulatedProxy && !Character->GetReplicatedBasedMovement().HasRelativeLocation();
+		if (!bUseSnapshots) Snapshots.Reset();
+		if (!bUseSnapshots || Snapshots.Num() == 0) return false;
+
+		FVector Location;
+		FQuat Rotation;
+		if (Snapshots.Sample(Character->GetWorld()->GetTimeSeconds(), InterpolationDelay * Snapshots.GetAverageInterval(), MaxExtrapolationTime, Location, Rotation))
+		{
+			ApplyMeshTransform(Character, Movement->UpdatedComponent, Location, Rotation);
+		}
+		return true;
+	}
+
+
+	void ApplyMeshTransform(ACharacter* Character, const USceneComponent* UpdatedComponent, const FVector& Location, const FQuat& Rotation)
+	{
+		USkeletalMeshComponent* Mesh = Character ? Character->GetMesh() : nullptr;
+		if (!Mesh || !UpdatedComponent) return;
+
+		// The same as the engine's smoothing, the mesh is offset from the capsule by the difference between where it should be rendered and where the capsule is
+		const FTransform& CapsuleTransform = UpdatedComponent->GetComponentTransform();
+		const FVector NewRelTranslation = CapsuleTransform.InverseTransformVectorNoScale(Location - CapsuleTransform.GetLocation()) + Character->GetBaseTranslationOffset();
+		const FQuat NewRelRotation = CapsuleTransform.GetRotation().Inverse() * Rotation * Character->GetBaseRotationOffset();
+		Mesh->SetRelativeLocationAndRotation(NewRelTranslation, NewRelRotation, false, nullptr, ETeleportType::TeleportPhysics);
+	}
+}
+#pragma endregion
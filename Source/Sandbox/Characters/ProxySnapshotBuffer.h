@@ -0,0 +1,105 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+	Simulated proxy snapshot buffer
+
+	The engine's exponential smoothing chases the last replicated location, so at bhop speeds the mesh trails behind the capsule and snaps once the error passes NetworkNoSmoothUpdateDistance.
+	Instead we keep the last few server snapshots (location, velocity, rotation, and the server time stamp of each) and render the proxy a little in the past:
+		- Between two snapshots the location is a cubic Hermite spline, using each snapshot's velocity as the tangent, so curved strafes stay curved
+		- Past the newest snapshot we extrapolate with the velocity and the acceleration (the change in velocity between the last two snapshots), for at most MaxExtrapolationTime
+
+	The movement components scale the delay with the measured time between snapshots (GetAverageInterval), so lowering NetUpdateFrequency (or the speed based frequency from the net policy) just renders a bit further back.
+	The acceleration isn't replicated, it's derived from the replicated velocities.
+	The snapshots are always stamped with the server's time (bNetworkAlwaysReplicateTransformUpdateTimestamp), and the buffer maps that onto the local clock with ServerTimeOffset.
+	Updates without a time stamp aren't buffered, mixing in the local receive time would put two clocks in the same buffer.
+
+	This is used by the movement components' proxy smoothing (the capsule is still simulated, only the mesh is placed from the buffer), and by UProxyInterpolationComponent (the whole actor is placed from the buffer).
+*/
+
+
+/** A replicated transform of a simulated proxy */
+struct FProxySnapshot
+{
+	double ServerTime = 0.0;
+	FVector Location = FVector::ZeroVector;
+	FVector Velocity = FVector::ZeroVector;
+	FVector Acceleration = FVector::ZeroVector;
+	FQuat Rotation = FQuat::Identity;
+	uint8 MovementMode = 0; // The packed movement mode (ACharacter::GetReplicatedMovementMode), only the proxy interpolation uses it
+};
+
+
+/**
+ * Ring buffer of the latest snapshots of a simulated proxy, and the clock to sample them with
+ */
+class SANDBOX_API FProxySnapshotBuffer
+{
+public:
+	static constexpr int32 MaxSnapshots = 8;
+
+	/**
+	 * Adds a snapshot received at LocalTime. If it's further than TeleportDistance from where we expected it to be the buffer is reset, so teleports aren't smoothed
+	 * @returns false if the snapshot was out of order and ignored
+	 */
+	bool AddSnapshot(double ServerTime, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, double LocalTime, float TeleportDistance, uint8 MovementMode = 0);
+
+	/**
+	 * Samples the buffer at the current render time (the estimated server time minus the interpolation delay)
+	 * @param	LocalTime				The same clock the snapshots were added with
+	 * @param	Delay					How far (in seconds) behind the newest snapshot to render
+	 * @param	MaxExtrapolationTime	The furthest we'll extrapolate past the newest snapshot
+	 * @param	OutVelocity				Optionally the velocity at the render time
+	 * @param	OutMovementMode			Optionally the movement mode of the latest snapshot the render time has passed
+	 * @returns false if there aren't any snapshots
+	 */
+	bool Sample(double LocalTime, float Delay, float MaxExtrapolationTime, FVector& OutLocation, FQuat& OutRotation, FVector* OutVelocity = nullptr, uint8* OutMovementMode = nullptr) const;
+
+	void Reset();
+	int32 Num() const { return NumSnapshots; }
+	float GetAverageInterval() const { return AverageInterval; }
+
+
+private:
+	/** The snapshot at the given age, 0 is the newest */
+	const FProxySnapshot& GetSnapshot(int32 Age) const { return Snapshots[(Head - Age + MaxSnapshots) % MaxSnapshots]; }
+
+	/** Location at Time past the snapshot, using its velocity and acceleration */
+	static FVector Extrapolate(const FProxySnapshot& Snapshot, float Time);
+
+	FProxySnapshot Snapshots[MaxSnapshots];
+	int32 Head = 0;
+	int32 NumSnapshots = 0;
+
+	/** The difference between the local clock and the server time of the newest snapshot (smoothed, so a late packet doesn't pull the render time back) */
+	double ServerTimeOffset = 0.0;
+	/** The smoothed time between snapshots */
+	float AverageInterval = 1.f / 33.f;
+};
+
+
+namespace ProxySmoothing
+{
+	/** Adds the character's replicated transform to the buffer with the server's time stamp for it, false if the server hasn't sent one */
+	SANDBOX_API bool AddReplicatedSnapshot(FProxySnapshotBuffer& Snapshots, const class ACharacter* Character, const FVector& Location, const FVector& Velocity, const FQuat& Rotation, float TeleportDistance, uint8 MovementMode = 0);
+
+	/**
+	 * The movement components' SmoothCorrection for simulated proxies, buffers the update and moves the capsule there (the mesh is placed in SmoothClientPosition)
+	 * @returns false if the engine's smoothing should be used instead
+	 */
+	SANDBOX_API bool SmoothCorrection(FProxySnapshotBuffer& Snapshots, class UCharacterMovementComponent* Movement, const FVector& NewLocation, const FQuat& NewRotation);
+
+	/**
+	 * The movement components' SmoothClientPosition for simulated proxies, places the mesh from the buffer
+	 * @param	InterpolationDelay		How many snapshot intervals behind the newest snapshot to render
+	 * @returns false if the engine's smoothing should be used instead
+	 */
+	SANDBOX_API bool SmoothClientPosition(FProxySnapshotBuffer& Snapshots, class UCharacterMovementComponent* Movement, float InterpolationDelay, float MaxExtrapolationTime);
+
+	/** Offsets the character's mesh so it renders at the given transform while the capsule stays where the movement component put it */
+	SANDBOX_API void ApplyMeshTransform(class ACharacter* Character, const class USceneComponent* UpdatedComponent, const FVector& Location, const FQuat& Rotation);
+}
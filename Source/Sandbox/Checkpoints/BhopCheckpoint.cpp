@@ -0,0 +1,55 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopCheckpoint.h"
+#include "Components/BoxComponent.h"
+#include "Engine/CollisionProfile.h"
+#include "Engine/World.h"
+#include "SandboxCheckpointSubsystem.h"
+
+
+ABhopCheckpoint::ABhopCheckpoint()
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	// The box is only there to place it in the editor
+	Bounds = CreateDefaultSubobject<UBoxComponent>(TEXT("Bounds"));
+	Bounds->SetBoxExtent(FVector(10.f, 500.f, 500.f));
+	Bounds->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	Bounds->SetGenerateOverlapEvents(false);
+	Bounds->SetCanEverAffectNavigation(false);
+	Bounds->SetHiddenInGame(true);
+	SetRootComponent(Bounds);
+}
+
+
+void ABhopCheckpoint::BeginPlay()
+{
+	Super::BeginPlay();
+	if (USandboxCheckpointSubsystem* Checkpoints = GetWorld()->GetSubsystem<USandboxCheckpointSubsystem>()) Checkpoints->RegisterCheckpoint(this);
+}
+
+
+void ABhopCheckpoint::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (USandboxCheckpointSubsystem* Checkpoints = GetWorld()->GetSubsystem<USandboxCheckpointSubsystem>()) Checkpoints->UnregisterCheckpoint(this);
+	Super::EndPlay(EndPlayReason);
+}
+
+
+FBhopCheckpointPlane ABhopCheckpoint::GetPlane() const
+{
+	const FTransform& Transform = Bounds->GetComponentTransform();
+	const FVector Extent = Bounds->GetScaledBoxExtent();
+
+	FBhopCheckpointPlane Plane;
+	Plane.Origin = Transform.GetLocation();
+	Plane.Normal = Transform.GetUnitAxis(EAxis::X);
+	Plane.Right = Transform.GetUnitAxis(EAxis::Y);
+	Plane.Up = Transform.GetUnitAxis(EAxis::Z);
+	Plane.HalfWidth = Extent.Y;
+	Plane.HalfHeight = Extent.Z;
+	Plane.CheckpointIndex = CheckpointIndex;
+	Plane.bFinish = bFinishLine;
+	return Plane;
+}
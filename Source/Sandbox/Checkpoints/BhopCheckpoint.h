@@ -0,0 +1,39 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "BhopCheckpointIndex.h"
+#include "BhopCheckpoint.generated.h"
+
+
+/**
+ * A checkpoint (or the start or finish line) of a timed run, crossed along the actor's forward vector inside the box's width (Y) and height (Z)
+ * There's no collision or overlaps, the checkpoint subsystem tests the runners' moves against the plane (see BhopCheckpointIndex.h)
+ */
+UCLASS()
+class SANDBOX_API ABhopCheckpoint : public AActor
+{
+	GENERATED_BODY()
+
+
+public:
+	ABhopCheckpoint();
+
+	/** The plane the runners have to go through */
+	FBhopCheckpointPlane GetPlane() const;
+
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	UPROPERTY(VisibleAnywhere, Category = "Checkpoint")
+		class UBoxComponent* Bounds;
+
+	UPROPERTY(EditAnywhere, Category = "Checkpoint") // 0 is the start line, the rest have to be crossed in order
+		int32 CheckpointIndex = 0;
+	UPROPERTY(EditAnywhere, Category = "Checkpoint") // Crossing this finishes the run
+		bool bFinishLine = false;
+};
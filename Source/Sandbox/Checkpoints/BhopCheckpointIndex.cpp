@@ -0,0 +1,110 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopCheckpointIndex.h"
+
+
+namespace
+{
+	// Segments that touch more cells than this (teleports, or a really long move) test every plane instead
+	constexpr int32 MaxCellsPerQuery = 16;
+}
+
+
+FBox FBhopCheckpointPlane::GetBounds() const
+{
+	const FVector Extent = (Right * HalfWidth).GetAbs() + (Up * HalfHeight).GetAbs();
+	return FBox(Origin - Extent, Origin + Extent);
+}
+
+
+void FBhopCheckpointIndex::Build(TArray<FBhopCheckpointPlane>&& InPlanes, float InCellSize)
+{
+	Planes = MoveTemp(InPlanes);
+	CellSize = FMath::Max(InCellSize, 1.f);
+	Cells.Reset();
+
+	for (int32 PlaneIndex = 0; PlaneIndex < Planes.Num(); PlaneIndex++)
+	{
+		const FBox Bounds = Planes[PlaneIndex].GetBounds();
+		const FIntPoint MinCell = GetCell(Bounds.Min);
+		const FIntPoint MaxCell = GetCell(Bounds.Max);
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+			{
+				Cells.FindOrAdd(FIntPoint(CellX, CellY)).Add(PlaneIndex);
+			}
+		}
+	}
+}
+
+
+FIntPoint FBhopCheckpointIndex::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
+
+
+void FBhopCheckpointIndex::FindCrossings(const FVector& Start, const FVector& End, TArray<FBhopCheckpointCrossing, TInlineAllocator<4>>& OutCrossings) const
+{
+	OutCrossings.Reset();
+	if (Planes.Num() == 0) return;
+
+	const FIntPoint MinCell = GetCell(Start.ComponentMin(End));
+	const FIntPoint MaxCell = GetCell(Start.ComponentMax(End));
+	const int64 NumCells = static_cast<int64>(MaxCell.X - MinCell.X + 1) * (MaxCell.Y - MinCell.Y + 1);
+	if (NumCells > MaxCellsPerQuery)
+	{
+		for (int32 PlaneIndex = 0; PlaneIndex < Planes.Num(); PlaneIndex++) TestPlane(PlaneIndex, Start, End, OutCrossings);
+	}
+	else
+	{
+		// A plane can be in more than one of the cells, only test it once
+		TArray<int32, TInlineAllocator<16>> Tested;
+		for (int32 CellY = MinCell.Y; CellY <= MaxCell.Y; CellY++)
+		{
+			for (int32 CellX = MinCell.X; CellX <= MaxCell.X; CellX++)
+			{
+				const TArray<int32>* CellPlanes = Cells.Find(FIntPoint(CellX, CellY));
+				if (!CellPlanes) continue;
+
+				for (const int32 PlaneIndex : *CellPlanes)
+				{
+					if (NumCells > 1)
+					{
+						if (Tested.Contains(PlaneIndex)) continue;
+						Tested.Add(PlaneIndex);
+					}
+					TestPlane(PlaneIndex, Start, End, OutCrossings);
+				}
+			}
+		}
+	}
+
+	if (OutCrossings.Num() > 1)
+	{
+		OutCrossings.Sort([](const FBhopCheckpointCrossing& A, const FBhopCheckpointCrossing& B) { return A.Alpha < B.Alpha; });
+	}
+}
+
+
+void FBhopCheckpointIndex::TestPlane(int32 PlaneIndex, const FVector& Start, const FVector& End, TArray<FBhopCheckpointCrossing, TInlineAllocator<4>>& OutCrossings) const
+{
+	// Behind the plane at the start of the move and on or in front of it at the end
+	const FBhopCheckpointPlane& Plane = Planes[PlaneIndex];
+	const float StartDistance = FVector::DotProduct(Start - Plane.Origin, Plane.Normal);
+	const float EndDistance = FVector::DotProduct(End - Plane.Origin, Plane.Normal);
+	if (StartDistance >= 0.f || EndDistance < 0.f) return;
+
+	// Where it went through, and whether that's inside the checkpoint
+	const float Alpha = StartDistance / (StartDistance - EndDistance);
+	const FVector Offset = FMath::Lerp(Start, End, Alpha) - Plane.Origin;
+	if (FMath::Abs(FVector::DotProduct(Offset, Plane.Right)) > Plane.HalfWidth || FMath::Abs(FVector::DotProduct(Offset, Plane.Up)) > Plane.HalfHeight) return;
+
+	FBhopCheckpointCrossing& Crossing = OutCrossings.AddDefaulted_GetRef();
+	Crossing.Plane = PlaneIndex;
+	Crossing.CheckpointIndex = Plane.CheckpointIndex;
+	Crossing.bFinish = Plane.bFinish;
+	Crossing.Alpha = Alpha;
+}
@@ -0,0 +1,196 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxCheckpointSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Math/RandomStream.h"
+#include "Engine/World.h"
+#include "BhopCheckpoint.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Checkpoint Tests"), STAT_Bhop_CheckpointTests, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Checkpoint Crossings"), STAT_Bhop_CheckpointCrossings, STATGROUP_Bhop);
+
+
+#pragma region Subsystem
+bool USandboxCheckpointSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+void USandboxCheckpointSubsystem::Deinitialize()
+{
+	Checkpoints.Empty();
+	Runs.Empty();
+	Index.Build({});
+	Super::Deinitialize();
+}
+
+
+void USandboxCheckpointSubsystem::RegisterCheckpoint(ABhopCheckpoint* Checkpoint)
+{
+	Checkpoints.AddUnique(Checkpoint);
+	bIndexDirty = true;
+}
+
+
+void USandboxCheckpointSubsystem::UnregisterCheckpoint(ABhopCheckpoint* Checkpoint)
+{
+	Checkpoints.Remove(Checkpoint);
+	bIndexDirty = true;
+}
+
+
+void USandboxCheckpointSubsystem::RebuildIndex()
+{
+	TArray<FBhopCheckpointPlane> Planes;
+	Planes.Reserve(Checkpoints.Num());
+	for (const TWeakObjectPtr<ABhopCheckpoint>& Checkpoint : Checkpoints)
+	{
+		if (Checkpoint.IsValid()) Planes.Add(Checkpoint->GetPlane());
+	}
+	Index.Build(MoveTemp(Planes));
+	bIndexDirty = false;
+}
+
+
+void USandboxCheckpointSubsystem::TestMove(const AActor* Runner, const FVector& Start, const FVector& End, float DeltaSeconds)
+{
+	if (!Runner || Checkpoints.Num() == 0) return;
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_CheckpointTests);
+	if (bIndexDirty) RebuildIndex();
+
+	FBhopCheckpointRun* Run = Runs.Find(Runner);
+	if (!Run)
+	{
+		// Forget the runners that have been destroyed before adding a new one
+		for (auto It = Runs.CreateIterator(); It; ++It)
+		{
+			if (!It.Key().ResolveObjectPtr()) It.RemoveCurrent();
+		}
+		Run = &Runs.Add(Runner);
+	}
+
+	Index.FindCrossings(Start, End, Crossings);
+	for (const FBhopCheckpointCrossing& Crossing : Crossings)
+	{
+		// When in the move the plane was crossed
+		const double Time = Run->Clock + Crossing.Alpha * DeltaSeconds;
+		if (Crossing.CheckpointIndex == 0)
+		{
+			Run->StartTime = Time;
+			Run->NextCheckpoint = 1;
+			Run->Splits.Reset();
+			Run->FinishTime = -1.0;
+			OnCheckpointCrossed.Broadcast(Runner, 0, 0.0, false);
+			continue;
+		}
+		if (!Run->IsRunning() || Crossing.CheckpointIndex != Run->NextCheckpoint) continue;
+
+		const double Split = Time - Run->StartTime;
+		Run->Splits.Add(Split);
+		Run->NextCheckpoint++;
+		if (Crossing.bFinish) Run->FinishTime = Split;
+		INC_DWORD_STAT(STAT_Bhop_CheckpointCrossings);
+		UE_LOG(LogTemp, Log, TEXT("%s: %s %d at %.4f"), *GetNameSafe(Runner), Crossing.bFinish ? TEXT("Finished at checkpoint") : TEXT("Checkpoint"), Crossing.CheckpointIndex, Split);
+		OnCheckpointCrossed.Broadcast(Runner, Crossing.CheckpointIndex, Split, Crossing.bFinish);
+	}
+
+	Run->Clock += DeltaSeconds;
+}
+
+
+void USandboxCheckpointSubsystem::ResetRunner(const AActor* Runner)
+{
+	Runs.Remove(Runner);
+}
+#pragma endregion
+
+
+#pragma region Benchmark
+static FAutoConsoleCommand CheckpointBenchmarkCommand(
+	TEXT("Sandbox.Checkpoints.Benchmark"),
+	TEXT("Runs a crowd of runners through a generated checkpoint course with uneven frame times, and prints the cost of the checkpoint tests and the timing error against end of frame (overlap) timing. Usage: Sandbox.Checkpoints.Benchmark [Runners=64] [Frames=3600] [Speed=12000]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumRunners = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 64;
+		const int32 NumFrames = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 3600;
+		const float Speed = Args.Num() > 2 ? FMath::Max(FCString::Atof(*Args[2]), 1.f) : 12000.f;
+		const int32 NumCheckpoints = 32;
+		const float LaneWidth = 150.f;
+		FRandomStream Stream(1337);
+
+		// A straight course with a checkpoint every three quarters of a second, facing down the course
+		const float Spacing = Speed * 0.75f;
+		TArray<FBhopCheckpointPlane> Planes;
+		for (int32 Checkpoint = 0; Checkpoint < NumCheckpoints; Checkpoint++)
+		{
+			FBhopCheckpointPlane& Plane = Planes.AddDefaulted_GetRef();
+			Plane.Origin = FVector(Checkpoint * Spacing, 0.f, 100.f);
+			Plane.HalfWidth = NumRunners * LaneWidth * 0.5f + LaneWidth;
+			Plane.HalfHeight = 500.f;
+			Plane.CheckpointIndex = Checkpoint;
+			Plane.bFinish = Checkpoint == NumCheckpoints - 1;
+		}
+		FBhopCheckpointIndex Index;
+		Index.Build(MoveTemp(Planes));
+
+		// Each runner has its own speed, and starts a little behind the start line
+		TArray<FVector> Locations;
+		TArray<float> Speeds;
+		TArray<double> Clocks;
+		for (int32 Runner = 0; Runner < NumRunners; Runner++)
+		{
+			Locations.Add(FVector(-Stream.FRandRange(10.f, 500.f), (Runner - NumRunners * 0.5f) * LaneWidth, 100.f));
+			Speeds.Add(Speed * Stream.FRandRange(0.9f, 1.1f));
+			Clocks.Add(0.0);
+		}
+		const TArray<FVector> StartLocations = Locations;
+
+		// The server's frame times bounce between 30 and 120 fps
+		int32 NumCrossings = 0;
+		double MaxError = 0.0, TotalError = 0.0, MaxFrameError = 0.0, TotalFrameError = 0.0;
+		uint64 TestCycles = 0;
+		TArray<FBhopCheckpointCrossing, TInlineAllocator<4>> Crossings;
+		for (int32 Frame = 0; Frame < NumFrames; Frame++)
+		{
+			const float DeltaTime = Stream.FRandRange(1.f / 120.f, 1.f / 30.f);
+			for (int32 Runner = 0; Runner < NumRunners; Runner++)
+			{
+				const FVector Start = Locations[Runner];
+				const FVector End = Start + FVector(Speeds[Runner] * DeltaTime, 0.f, 0.f);
+
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				Index.FindCrossings(Start, End, Crossings);
+				TestCycles += FPlatformTime::Cycles64() - StartCycles;
+
+				// The exact time is how long it takes to get to the plane at the runner's speed
+				for (const FBhopCheckpointCrossing& Crossing : Crossings)
+				{
+					const double ExactTime = (Index.GetPlane(Crossing.Plane).Origin.X - StartLocations[Runner].X) / Speeds[Runner];
+					const double Error = FMath::Abs(Clocks[Runner] + Crossing.Alpha * DeltaTime - ExactTime);
+					const double FrameError = FMath::Abs(Clocks[Runner] + DeltaTime - ExactTime);
+					MaxError = FMath::Max(MaxError, Error);
+					TotalError += Error;
+					MaxFrameError = FMath::Max(MaxFrameError, FrameError);
+					TotalFrameError += FrameError;
+					NumCrossings++;
+				}
+
+				Locations[Runner] = End;
+				Clocks[Runner] += DeltaTime;
+			}
+		}
+
+		const double TestSeconds = FPlatformTime::ToSeconds64(TestCycles);
+		const int32 NumMoves = NumRunners * NumFrames;
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Checkpoints.Benchmark: %d runners at %.0f uu/s, %d frames, %d checkpoints: %.1f ns per move, %.4f ms per frame for every runner"),
+			NumRunners, Speed, NumFrames, Index.GetNumPlanes(), TestSeconds * 1e9 / NumMoves, TestSeconds * 1e3 / NumFrames);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Checkpoints.Benchmark: %d crossings, interpolated error avg %.5f ms max %.5f ms, end of frame error avg %.3f ms max %.3f ms"),
+			NumCrossings, NumCrossings > 0 ? TotalError * 1e3 / NumCrossings : 0.0, MaxError * 1e3, NumCrossings > 0 ? TotalFrameError * 1e3 / NumCrossings : 0.0, MaxFrameError * 1e3);
+	})
+);
+#pragma endregion
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/ObjectKey.h"
+#include "BhopCheckpointIndex.h"
+#include "SandboxCheckpointSubsystem.generated.h"
+
+
+/** A runner's current run, the times are on the runner's own move clock (see BhopCheckpointIndex.h) */
+struct FBhopCheckpointRun
+{
+	double Clock = 0.0;				// The total delta time of the runner's moves
+	double StartTime = -1.0;		// The clock when the start line was crossed, negative until then
+	int32 NextCheckpoint = 0;
+	TArray<double> Splits;			// The time since the start at each checkpoint
+	double FinishTime = -1.0;		// The run's time, negative until the finish line is crossed
+
+	bool IsRunning() const { return StartTime >= 0.0 && FinishTime < 0.0; }
+};
+
+
+/** Runner, checkpoint index, time since the start, and whether it was the finish line */
+DECLARE_MULTICAST_DELEGATE_FourParams(FOnBhopCheckpointCrossed, const AActor*, int32, double, bool);
+
+
+/**
+ * Times the runs through the level's checkpoints from the movement component's moves (see BhopCheckpointIndex.h)
+ */
+UCLASS()
+class SANDBOX_API USandboxCheckpointSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	void RegisterCheckpoint(class ABhopCheckpoint* Checkpoint);
+	void UnregisterCheckpoint(class ABhopCheckpoint* Checkpoint);
+	bool HasCheckpoints() const { return Checkpoints.Num() > 0; }
+
+	/** Tests a move from Start to End that took DeltaSeconds against the checkpoints, and advances the runner's clock */
+	void TestMove(const AActor* Runner, const FVector& Start, const FVector& End, float DeltaSeconds);
+
+	/** Forgets a runner's run (respawning, leaving) */
+	void ResetRunner(const AActor* Runner);
+
+	const FBhopCheckpointRun* GetRun(const AActor* Runner) const { return Runs.Find(Runner); }
+
+	FOnBhopCheckpointCrossed OnCheckpointCrossed;
+
+
+private:
+	void RebuildIndex();
+
+	TArray<TWeakObjectPtr<class ABhopCheckpoint>> Checkpoints;
+	FBhopCheckpointIndex Index;
+	bool bIndexDirty = false;
+
+	TMap<TObjectKey<AActor>, FBhopCheckpointRun> Runs;
+	TArray<FBhopCheckpointCrossing, TInlineAllocator<4>> Crossings; // Reused for every move
+};
@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxAudioSubsystem.h"
+#include "Components/AudioComponent.h"
+#include "Sound/SoundBase.h"
+#include "Engine/World.h"
+
+
+bool USandboxAudioSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if !SANDBOX_WITH_COSMETICS
+	return false;
+#else
+	// Only game worlds that can actually play audio
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+
+void USandboxAudioSubsystem::Deinitialize()
+{
+	for (UAudioComponent* AudioComponent : Pool)
+	{
+		if (IsValid(AudioComponent)) AudioComponent->DestroyComponent();
+	}
+
+	Pool.Empty();
+	PoolStartTimes.Empty();
+	Super::Deinitialize();
+}
+
+
+bool USandboxAudioSubsystem::PlaySoundAtLocation(USoundBase* Sound, const FVector& Location, float VolumeMultiplier, float PitchMultiplier)
+{
+	UWorld* World = GetWorld();
+	if (!Sound || !World || !World->bAllowAudioPlayback) return false;
+
+	const int32 Index = GetPoolIndexForSound(Sound);
+	if (!Pool.IsValidIndex(Index)) return false;
+
+	UAudioComponent* AudioComponent = Pool[Index];
+	AudioComponent->Stop();
+	AudioComponent->SetSound(Sound);
+	AudioComponent->SetWorldLocation(Location);
+	AudioComponent->SetVolumeMultiplier(VolumeMultiplier);
+	AudioComponent->SetPitchMultiplier(PitchMultiplier);
+	AudioComponent->Play();
+
+	PoolStartTimes[Index] = World->GetTimeSeconds();
+	return true;
+}
+
+
+int32 USandboxAudioSubsystem::GetPoolIndexForSound(USoundBase* Sound)
+{
+	int32 IdleIndex = INDEX_NONE;
+	int32 OldestIndex = INDEX_NONE;
+	int32 OldestSameSoundIndex = INDEX_NONE;
+	int32 NumPlayingSameSound = 0;
+
+	for (int32 Index = 0; Index < Pool.Num(); Index++)
+	{
+		const UAudioComponent* AudioComponent = Pool[Index];
+		if (!IsValid(AudioComponent)) continue;
+
+		if (!AudioComponent->IsPlaying())
+		{
+			if (IdleIndex == INDEX_NONE) IdleIndex = Index;
+			continue;
+		}
+
+		if (OldestIndex == INDEX_NONE || PoolStartTimes[Index] < PoolStartTimes[OldestIndex]) OldestIndex = Index;
+		if (AudioComponent->Sound == Sound)
+		{
+			NumPlayingSameSound++;
+			if (OldestSameSoundIndex == INDEX_NONE || PoolStartTimes[Index] < PoolStartTimes[OldestSameSoundIndex]) OldestSameSoundIndex = Index;
+		}
+	}
+
+	// Too many of this sound already, restart the oldest one
+	if (NumPlayingSameSound >= MaxInstancesPerSound) return OldestSameSoundIndex;
+	if (IdleIndex != INDEX_NONE) return IdleIndex;
+
+	// Grow the pool
+	if (Pool.Num() < MaxPoolSize)
+	{
+		UAudioComponent* AudioComponent = NewObject<UAudioComponent>(GetWorld());
+		AudioComponent->bAutoActivate = false;
+		AudioComponent->bAutoDestroy = false; // The pool owns these
+		AudioComponent->bAllowSpatialization = true;
+		AudioComponent->bIsUISound = false;
+		AudioComponent->RegisterComponentWithWorld(GetWorld());
+
+		PoolStartTimes.Add(0.0);
+		return Pool.Add(AudioComponent);
+	}
+
+	// Everything's playing, steal the oldest sound
+	return OldestIndex;
+}
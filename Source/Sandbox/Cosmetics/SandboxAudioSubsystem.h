@@ -0,0 +1,50 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "SandboxAudioSubsystem.generated.h"
+
+
+/**
+ * Pool of audio components for the cosmetic sounds (jumping, landing, etc.) so clients reuse a handful of components instead of allocating one per sound.
+ * 
+ * Concurrency is limited twice, a sound can only have MaxInstancesPerSound playing at once, and the pool can't grow past MaxPoolSize.
+ * When either limit is hit the oldest matching sound is stopped and its component is reused for the new one.
+ * This isn't created on a dedicated server (there's nothing to hear).
+ */
+UCLASS(config = Game)
+class SANDBOX_API USandboxAudioSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+
+	/** Plays the sound with one of the pooled components, returns false if the sound couldn't be played */
+	bool PlaySoundAtLocation(class USoundBase* Sound, const FVector& Location, float VolumeMultiplier = 1.f, float PitchMultiplier = 1.f);
+
+	int32 GetPoolSize() const { return Pool.Num(); }
+
+
+protected:
+	// Concurrency limits ([/Script/Sandbox.SandboxAudioSubsystem] in DefaultGame.ini)
+	UPROPERTY(config) // The most audio components in the pool
+		int32 MaxPoolSize = 16;
+	UPROPERTY(config) // The most instances of a single sound that can play at once
+		int32 MaxInstancesPerSound = 4;
+
+
+private:
+	/** Finds the component to play the next sound with (an idle one, a new one, or the oldest one we're allowed to steal) */
+	int32 GetPoolIndexForSound(class USoundBase* Sound);
+
+	UPROPERTY()
+		TArray<class UAudioComponent*> Pool;
+
+	/** When each pooled component was last started, the oldest is stolen first */
+	TArray<double> PoolStartTimes;
+};
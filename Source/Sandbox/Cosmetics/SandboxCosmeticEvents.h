@@ -0,0 +1,33 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+
+/*
+	Cosmetic events
+
+	Movement doesn't play sounds (or anything else that's only for show) directly, it emits one of these and the listeners on that machine decide what to do with it.
+	The listeners are compiled out of the server (SANDBOX_WITH_COSMETICS) and skipped on a dedicated server in the editor, so the server only pays for building the event.
+	On clients the audio is routed through the pooled audio components in USandboxAudioSubsystem instead of spawning a new component for every sound.
+*/
+
+
+/** The cosmetic events movement emits */
+enum class EBhopCosmeticEvent : uint8
+{
+	Jump,
+	Land,
+};
+
+
+/** A cosmetic event, this is just a few values so it's cheap to build even when nothing is listening */
+struct FBhopCosmeticEvent
+{
+	EBhopCosmeticEvent Type = EBhopCosmeticEvent::Jump;
+	FVector Location = FVector::ZeroVector;
+
+	/** Landing: the downward speed when we hit the ground, which picks the landing sound. Unused for jumps */
+	float Speed = 0.f;
+};
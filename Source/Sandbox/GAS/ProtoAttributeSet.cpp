@@ -3,6 +3,7 @@
 
 #include "ProtoAttributeSet.h"
 #include "Net/UnrealNetwork.h"
+#include "Sandbox/Networking/SandboxNetStats.h"
 
 
 UProtoAttributeSet::UProtoAttributeSet()
@@ -14,10 +15,39 @@ void UProtoAttributeSet::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& O
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME_CONDITION_NOTIFY(UProtoAttributeSet, Health, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UProtoAttributeSet, Stamina, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UProtoAttributeSet, AttackPower, COND_None, REPNOTIFY_Always);
-	DOREPLIFETIME_CONDITION_NOTIFY(UProtoAttributeSet, Mana, COND_None, REPNOTIFY_Always);
+	FDoRepLifetimeParams Params;
+	Params.Condition = COND_None;
+	Params.RepNotifyCondition = REPNOTIFY_Always;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UProtoAttributeSet, Health, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UProtoAttributeSet, Stamina, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UProtoAttributeSet, AttackPower, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(UProtoAttributeSet, Mana, Params);
+}
+
+
+void UProtoAttributeSet::PostAttributeBaseChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) const
+{
+	Super::PostAttributeBaseChange(Attribute, OldValue, NewValue);
+	MarkAttributeDirty(Attribute);
+}
+
+
+void UProtoAttributeSet::PostAttributeChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue)
+{
+	Super::PostAttributeChange(Attribute, OldValue, NewValue);
+	MarkAttributeDirty(Attribute);
+}
+
+
+void UProtoAttributeSet::MarkAttributeDirty(const FGameplayAttribute& Attribute) const
+{
+	// The attribute's property is the replicated FGameplayAttributeData, so it can be marked without checking which attribute it is
+	if (!Attribute.IsValid() || !GetClass()->IsChildOf(Attribute.GetAttributeSetClass())) return;
+
+	MARK_PROPERTY_DIRTY(const_cast<UProtoAttributeSet*>(this), Attribute.GetUProperty());
+	INC_DWORD_STAT(STAT_SandboxNet_PushModelDirtyMarks);
 }
 
 
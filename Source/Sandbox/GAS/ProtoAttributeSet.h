@@ -27,6 +27,10 @@ public:
 	UProtoAttributeSet();
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 
+	// The attributes are push based, these mark them dirty whenever the ability system changes their base or current value
+	virtual void PostAttributeBaseChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) const override;
+	virtual void PostAttributeChange(const FGameplayAttribute& Attribute, float OldValue, float NewValue) override;
+
 	// Health
 	UFUNCTION() virtual void OnRep_Health(const FGameplayAttributeData& OldHealth);
 	UPROPERTY(BlueprintReadOnly, Category = "Attributes", ReplicatedUsing = OnRep_Health)
@@ -49,7 +53,8 @@ public:
 
 
 protected:
-
+	/** Marks the replicated property of the attribute dirty for push model replication */
+	void MarkAttributeDirty(const FGameplayAttribute& Attribute) const;
 
 
 };
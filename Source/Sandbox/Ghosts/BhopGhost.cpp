@@ -0,0 +1,42 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopGhost.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/CollisionProfile.h"
+#include "UObject/ConstructorHelpers.h"
+
+
+ABhopGhost::ABhopGhost()
+{
+	PrimaryActorTick.bCanEverTick = false;
+	SetReplicates(false);
+	SetCanBeDamaged(false);
+
+	// A capsule sized cylinder until a blueprint gives it a proper mesh
+	GhostMesh = CreateDefaultSubobject<UStaticMeshComponent>(TEXT("GhostMesh"));
+	static ConstructorHelpers::FObjectFinder<UStaticMesh> CylinderMesh(TEXT("/Engine/BasicShapes/Cylinder.Cylinder"));
+	GhostMesh->SetStaticMesh(CylinderMesh.Object);
+	GhostMesh->SetRelativeScale3D(FVector(0.7f, 0.7f, 1.8f));
+	GhostMesh->SetCollisionProfileName(UCollisionProfile::NoCollision_ProfileName);
+	GhostMesh->SetGenerateOverlapEvents(false);
+	GhostMesh->SetCanEverAffectNavigation(false);
+	GhostMesh->CastShadow = false;
+	GhostMesh->PrimaryComponentTick.bCanEverTick = false;
+	SetRootComponent(GhostMesh);
+}
+
+
+void ABhopGhost::SetGhostTransform(const FVector& Location, const FRotator& Rotation, EMovementMode InMovementMode)
+{
+	// Only the yaw turns the mesh, the pitch is where they were looking
+	SetActorLocationAndRotation(Location, FRotator(0.f, Rotation.Yaw, 0.f), false, nullptr, ETeleportType::TeleportPhysics);
+
+	if (InMovementMode != MovementMode)
+	{
+		const EMovementMode PrevMovementMode = MovementMode;
+		MovementMode = InMovementMode;
+		OnGhostMovementModeChanged(PrevMovementMode, MovementMode);
+	}
+}
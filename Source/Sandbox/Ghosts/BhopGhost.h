@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/EngineTypes.h"
+#include "BhopGhost.generated.h"
+
+
+/**
+ * The actor a ghost run is played back on. It's only a mesh, the ghost subsystem moves it every frame (see BhopGhostFormat.h),
+ * so there's no movement component, collision, overlaps, tick or replication.
+ */
+UCLASS()
+class SANDBOX_API ABhopGhost : public AActor
+{
+	GENERATED_BODY()
+
+
+public:
+	ABhopGhost();
+
+	/** Places the ghost at a frame of its run */
+	void SetGhostTransform(const FVector& Location, const FRotator& Rotation, EMovementMode InMovementMode);
+
+	EMovementMode GetMovementMode() const { return MovementMode; }
+
+
+protected:
+	/** Called when the run's movement mode changes (jumping and landing visuals) */
+	UFUNCTION(BlueprintImplementableEvent, Category = "Ghost")
+		void OnGhostMovementModeChanged(EMovementMode PrevMovementMode, EMovementMode NewMovementMode);
+
+	UPROPERTY(VisibleAnywhere, Category = "Ghost")
+		class UStaticMeshComponent* GhostMesh;
+
+	UPROPERTY(VisibleAnywhere, Category = "Ghost")
+		TEnumAsByte<EMovementMode> MovementMode = MOVE_Walking;
+};
@@ -0,0 +1,374 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BhopGhostFormat.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+
+#pragma region Encoding
+namespace
+{
+	void WriteVarint(TArray<uint8>& Out, uint32 Value)
+	{
+		while (Value >= 0x80)
+		{
+			Out.Add(static_cast<uint8>(Value) | 0x80);
+			Value >>= 7;
+		}
+		Out.Add(static_cast<uint8>(Value));
+	}
+
+	// Small negative numbers are small varints too (0, -1, 1, -2 -> 0, 1, 2, 3)
+	void WriteZigZag(TArray<uint8>& Out, int32 Value)
+	{
+		WriteVarint(Out, (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31));
+	}
+
+	template<typename T>
+	void WriteRaw(TArray<uint8>& Out, const T& Value)
+	{
+		Out.Append(reinterpret_cast<const uint8*>(&Value), sizeof(T));
+	}
+
+
+	/** Reads a chunk, anything past the end of it sets bError instead */
+	struct FGhostChunkReader
+	{
+		const uint8* Ptr = nullptr;
+		const uint8* End = nullptr;
+		bool bError = false;
+
+		uint32 ReadVarint()
+		{
+			uint32 Value = 0;
+			for (int32 Shift = 0; Shift < 35; Shift += 7)
+			{
+				if (Ptr >= End) break;
+				const uint8 Byte = *Ptr++;
+				Value |= static_cast<uint32>(Byte & 0x7f) << Shift;
+				if ((Byte & 0x80) == 0) return Value;
+			}
+			bError = true;
+			return 0;
+		}
+
+		int32 ReadZigZag()
+		{
+			const uint32 Value = ReadVarint();
+			return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+		}
+
+		template<typename T>
+		T ReadRaw()
+		{
+			T Value{};
+			if (End - Ptr < static_cast<int64>(sizeof(T)))
+			{
+				bError = true;
+				return Value;
+			}
+			FMemory::Memcpy(&Value, Ptr, sizeof(T));
+			Ptr += sizeof(T);
+			return Value;
+		}
+	};
+}
+
+
+namespace SandboxGhosts
+{
+	FString GetGhostFilename(const FString& Name)
+	{
+		return FPaths::ProjectSavedDir() / TEXT("Ghosts") / (Name + TEXT(".bghost"));
+	}
+}
+#pragma endregion
+
+
+#pragma region Recorder
+FBhopGhostRecorder::FBhopGhostRecorder(float InSampleRate, int32 InFramesPerChunk, float InPositionStep)
+{
+	Header.SampleRate = FMath::Max(InSampleRate, 1.f);
+	Header.FramesPerChunk = FMath::Max(InFramesPerChunk, 2);
+	Header.PositionStep = FMath::Max(InPositionStep, KINDA_SMALL_NUMBER);
+}
+
+
+void FBhopGhostRecorder::Start(const FVector& Location, const FRotator& Rotation, uint8 InMovementMode)
+{
+	Header.NumFrames = 0;
+	Header.NumChunks = 0;
+	Data.Reset();
+	Chunks.Reset();
+	NumChunkFrames = 0;
+	MovementMode = InMovementMode;
+
+	AddFrame(Location, Rotation);
+	Time = 0.0;
+	NextSampleTime = 1.0 / Header.SampleRate;
+	LastLocation = Location;
+	LastRotation = Rotation;
+}
+
+
+void FBhopGhostRecorder::Tick(float DeltaTime, const FVector& Location, const FRotator& Rotation)
+{
+	if (DeltaTime <= 0.f) return;
+
+	// The samples are at fixed times, so take them from between last tick and this one
+	const double PrevTime = Time;
+	Time += DeltaTime;
+	while (NextSampleTime <= Time)
+	{
+		const float Alpha = static_cast<float>((NextSampleTime - PrevTime) / DeltaTime);
+		AddFrame(FMath::Lerp(LastLocation, Location, Alpha), LastRotation + (Rotation - LastRotation).GetNormalized() * Alpha); // The short way around when the yaw wraps
+		NextSampleTime = static_cast<double>(Header.NumFrames) / Header.SampleRate;
+	}
+
+	LastLocation = Location;
+	LastRotation = Rotation;
+}
+
+
+void FBhopGhostRecorder::SetMovementMode(uint8 InMovementMode)
+{
+	if (InMovementMode == MovementMode) return;
+	MovementMode = InMovementMode;
+
+	// The next chunk's keyframe has the mode already
+	if (NumChunkFrames > 0) ChunkEvents.Emplace(NumChunkFrames, MovementMode);
+}
+
+
+void FBhopGhostRecorder::AddFrame(const FVector& Location, const FRotator& Rotation)
+{
+	const FIntVector Quantized(
+		FMath::RoundToInt(Location.X / Header.PositionStep),
+		FMath::RoundToInt(Location.Y / Header.PositionStep),
+		FMath::RoundToInt(Location.Z / Header.PositionStep));
+	const uint16 Yaw = FRotator::CompressAxisToShort(Rotation.Yaw);
+	const uint16 Pitch = FRotator::CompressAxisToShort(Rotation.Pitch);
+
+	if (NumChunkFrames == 0)
+	{
+		// The keyframe
+		ChunkData.Reset();
+		ChunkDeltas.Reset();
+		ChunkEvents.Reset();
+		WriteRaw(ChunkData, Quantized.X);
+		WriteRaw(ChunkData, Quantized.Y);
+		WriteRaw(ChunkData, Quantized.Z);
+		WriteRaw(ChunkData, Yaw);
+		WriteRaw(ChunkData, Pitch);
+		WriteRaw(ChunkData, MovementMode);
+	}
+	else
+	{
+		// How far off we are from carrying on at the last frame's velocity, and how much we turned
+		const FIntVector Predicted = NumChunkFrames > 1 ? PrevLocation * 2 - PrevPrevLocation : PrevLocation;
+		const FIntVector Residual = Quantized - Predicted;
+		WriteZigZag(ChunkDeltas, Residual.X);
+		WriteZigZag(ChunkDeltas, Residual.Y);
+		WriteZigZag(ChunkDeltas, Residual.Z);
+		WriteZigZag(ChunkDeltas, static_cast<int16>(Yaw - PrevYaw));
+		WriteZigZag(ChunkDeltas, static_cast<int16>(Pitch - PrevPitch));
+	}
+
+	PrevPrevLocation = PrevLocation;
+	PrevLocation = Quantized;
+	PrevYaw = Yaw;
+	PrevPitch = Pitch;
+	NumChunkFrames++;
+	Header.NumFrames++;
+	if (NumChunkFrames == Header.FramesPerChunk) FlushChunk();
+}
+
+
+void FBhopGhostRecorder::FlushChunk()
+{
+	if (NumChunkFrames == 0) return;
+
+	FBhopGhostChunkEntry& Chunk = Chunks.AddDefaulted_GetRef();
+	Chunk.Offset = sizeof(FBhopGhostHeader) + Data.Num();
+	Chunk.FirstFrame = Header.NumFrames - NumChunkFrames;
+
+	Data.Append(ChunkData);
+	WriteVarint(Data, ChunkEvents.Num());
+	for (const TPair<uint32, uint8>& Event : ChunkEvents)
+	{
+		WriteVarint(Data, Event.Key);
+		Data.Add(Event.Value);
+	}
+	Data.Append(ChunkDeltas);
+	Chunk.Size = static_cast<uint32>(sizeof(FBhopGhostHeader) + Data.Num() - Chunk.Offset);
+
+	NumChunkFrames = 0;
+	ChunkData.Reset();
+	ChunkDeltas.Reset();
+	ChunkEvents.Reset();
+}
+
+
+bool FBhopGhostRecorder::Save(const FString& Filename)
+{
+	FlushChunk();
+	if (Header.NumFrames == 0) return false;
+
+	// The chunk table is 8 byte aligned so it can be read straight out of the mapped file
+	Data.AddZeroed(Align(sizeof(FBhopGhostHeader) + Data.Num(), 8) - (sizeof(FBhopGhostHeader) + Data.Num()));
+	Header.NumChunks = Chunks.Num();
+	Header.ChunkTableOffset = sizeof(FBhopGhostHeader) + Data.Num();
+
+	TArray<uint8> File;
+	File.Reserve(Header.ChunkTableOffset + Chunks.Num() * sizeof(FBhopGhostChunkEntry));
+	WriteRaw(File, Header);
+	File.Append(Data);
+	File.Append(reinterpret_cast<const uint8*>(Chunks.GetData()), Chunks.Num() * sizeof(FBhopGhostChunkEntry));
+	return FFileHelper::SaveArrayToFile(File, *Filename);
+}
+#pragma endregion
+
+
+#pragma region File
+TSharedPtr<FBhopGhostFile> FBhopGhostFile::Open(const FString& Filename)
+{
+	TSharedPtr<FBhopGhostFile> File = MakeShared<FBhopGhostFile>();
+
+	// Map the file if we can, otherwise read the whole thing
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	File->MappedFile.Reset(PlatformFile.OpenMapped(*Filename));
+	if (File->MappedFile.IsValid())
+	{
+		File->MappedRegion.Reset(File->MappedFile->MapRegion(0, File->MappedFile->GetFileSize()));
+		if (File->MappedRegion.IsValid())
+		{
+			File->Data = File->MappedRegion->GetMappedPtr();
+			File->DataSize = File->MappedRegion->GetMappedSize();
+		}
+	}
+	if (!File->Data)
+	{
+		File->MappedRegion.Reset();
+		File->MappedFile.Reset();
+		if (!FFileHelper::LoadFileToArray(File->LoadedData, *Filename, FILEREAD_Silent)) return nullptr;
+		File->Data = File->LoadedData.GetData();
+		File->DataSize = File->LoadedData.Num();
+	}
+
+	// Make sure it's a ghost we understand and that every chunk is inside the file
+	const FBhopGhostHeader* FileHeader = reinterpret_cast<const FBhopGhostHeader*>(File->Data);
+	const bool bValidHeader = File->DataSize >= static_cast<int64>(sizeof(FBhopGhostHeader))
+		&& FileHeader->Magic == FBhopGhostHeader::ExpectedMagic
+		&& FileHeader->Version == FBhopGhostHeader::ExpectedVersion
+		&& FileHeader->SampleRate > 0.f && FileHeader->PositionStep > 0.f && FileHeader->FramesPerChunk > 0 && FileHeader->NumFrames > 0 && FileHeader->NumChunks > 0
+		&& FileHeader->ChunkTableOffset % 8 == 0
+		&& FileHeader->ChunkTableOffset + FileHeader->NumChunks * sizeof(FBhopGhostChunkEntry) <= static_cast<uint64>(File->DataSize);
+	if (!bValidHeader)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Ghosts: %s isn't a valid ghost"), *Filename);
+		return nullptr;
+	}
+
+	const FBhopGhostChunkEntry* FileChunks = reinterpret_cast<const FBhopGhostChunkEntry*>(File->Data + FileHeader->ChunkTableOffset);
+	for (uint32 Index = 0; Index < FileHeader->NumChunks; Index++)
+	{
+		const FBhopGhostChunkEntry& Chunk = FileChunks[Index];
+		const uint32 NextFirstFrame = Index + 1 < FileHeader->NumChunks ? FileChunks[Index + 1].FirstFrame : FileHeader->NumFrames;
+		if (Chunk.Offset + Chunk.Size > FileHeader->ChunkTableOffset || Chunk.FirstFrame != Index * FileHeader->FramesPerChunk || NextFirstFrame <= Chunk.FirstFrame || NextFirstFrame - Chunk.FirstFrame > FileHeader->FramesPerChunk)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Ghosts: %s has a corrupt chunk table"), *Filename);
+			return nullptr;
+		}
+	}
+
+	File->Header = FileHeader;
+	File->Chunks = FileChunks;
+	return File;
+}
+
+
+int32 FBhopGhostFile::GetChunkNumFrames(int32 Index) const
+{
+	const uint32 NextFirstFrame = Index + 1 < GetNumChunks() ? Chunks[Index + 1].FirstFrame : Header->NumFrames;
+	return NextFirstFrame - Chunks[Index].FirstFrame;
+}
+
+
+bool FBhopGhostFile::DecodeKeyframe(int32 Index, FBhopGhostFrame& OutFrame) const
+{
+	const FBhopGhostChunkEntry& Chunk = Chunks[Index];
+	FGhostChunkReader Reader{ Data + Chunk.Offset, Data + Chunk.Offset + Chunk.Size };
+	const int32 X = Reader.ReadRaw<int32>();
+	const int32 Y = Reader.ReadRaw<int32>();
+	const int32 Z = Reader.ReadRaw<int32>();
+	OutFrame.Location = FVector3f(X, Y, Z) * Header->PositionStep;
+	OutFrame.Yaw = Reader.ReadRaw<uint16>();
+	OutFrame.Pitch = Reader.ReadRaw<uint16>();
+	OutFrame.MovementMode = Reader.ReadRaw<uint8>();
+	return !Reader.bError;
+}
+
+
+bool FBhopGhostFile::DecodeChunk(int32 Index, TArray<FBhopGhostFrame>& OutFrames) const
+{
+	const FBhopGhostChunkEntry& Chunk = Chunks[Index];
+	const int32 NumFrames = GetChunkNumFrames(Index);
+	FGhostChunkReader Reader{ Data + Chunk.Offset, Data + Chunk.Offset + Chunk.Size };
+
+	// The keyframe
+	FIntVector Location;
+	Location.X = Reader.ReadRaw<int32>();
+	Location.Y = Reader.ReadRaw<int32>();
+	Location.Z = Reader.ReadRaw<int32>();
+	uint16 Yaw = Reader.ReadRaw<uint16>();
+	uint16 Pitch = Reader.ReadRaw<uint16>();
+	uint8 MovementMode = Reader.ReadRaw<uint8>();
+
+	// The movement mode events
+	const uint32 NumEvents = Reader.ReadVarint();
+	if (Reader.bError || NumEvents > static_cast<uint32>(NumFrames)) return false;
+	TArray<TPair<uint32, uint8>, TInlineAllocator<16>> Events;
+	for (uint32 Event = 0; Event < NumEvents; Event++)
+	{
+		const uint32 Frame = Reader.ReadVarint();
+		Events.Emplace(Frame, Reader.ReadRaw<uint8>());
+	}
+
+	// The deltas, the same prediction the recorder used
+	const int32 StartNum = OutFrames.Num();
+	OutFrames.Reserve(StartNum + NumFrames);
+	FIntVector PrevLocation = Location;
+	FIntVector PrevPrevLocation = Location;
+	int32 NextEvent = 0;
+	for (int32 Frame = 0; Frame < NumFrames && !Reader.bError; Frame++)
+	{
+		if (Frame > 0)
+		{
+			const FIntVector Predicted = Frame > 1 ? PrevLocation * 2 - PrevPrevLocation : PrevLocation;
+			Location.X = Predicted.X + Reader.ReadZigZag();
+			Location.Y = Predicted.Y + Reader.ReadZigZag();
+			Location.Z = Predicted.Z + Reader.ReadZigZag();
+			Yaw = static_cast<uint16>(Yaw + Reader.ReadZigZag());
+			Pitch = static_cast<uint16>(Pitch + Reader.ReadZigZag());
+		}
+		while (NextEvent < Events.Num() && Events[NextEvent].Key <= static_cast<uint32>(Frame)) MovementMode = Events[NextEvent++].Value;
+
+		FBhopGhostFrame& Out = OutFrames.AddDefaulted_GetRef();
+		Out.Location = FVector3f(Location.X, Location.Y, Location.Z) * Header->PositionStep;
+		Out.Yaw = Yaw;
+		Out.Pitch = Pitch;
+		Out.MovementMode = MovementMode;
+		PrevPrevLocation = PrevLocation;
+		PrevLocation = Location;
+	}
+
+	if (Reader.bError)
+	{
+		OutFrames.SetNum(StartNum);
+		return false;
+	}
+	return true;
+}
+#pragma endregion
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Async/MappedFileHandle.h"
+
+
+/*
+	Ghost runs
+
+	A ghost is a recording of a bhop run that's played back next to the player. The character records itself (ABhopCharacter::StartGhostRecording) at a fixed sample rate,
+	and the ghost subsystem (SandboxGhostSubsystem.h) plays the file back on a lightweight actor that has a mesh and nothing else, no movement component, collision or tick of its own.
+
+	The file is split into chunks of FramesPerChunk frames, each chunk starts with a keyframe so it can be decoded on its own:
+		- The keyframe: the quantized location (int32s of PositionStep units), the yaw and pitch (compressed to uint16s), and the movement mode
+		- The movement mode events in the chunk, a varint frame offset and the new mode
+		- A delta for every other frame in the chunk, zigzag varints of the location's error from the previous frame's velocity (bhop movement is smooth, so it's usually 0 or 1)
+			and the yaw and pitch's change from the previous frame
+	The deltas are taken from the quantized values, so the error never adds up over a chunk. A run at 30Hz usually takes 4-6 bytes a frame (an hour of bhopping is around half a megabyte).
+	The chunk table is at the end of the file, so the recorder can write the chunks as it goes and the player can jump straight to any chunk.
+
+	Playback only decodes the chunk each ghost is in (mapped, so the os only pages in the chunks that are being played), and the ghosts playing the same run share the file.
+		Sandbox.Ghost.Record, Sandbox.Ghost.Save [Name], Sandbox.Ghost.Play [Name] [Count] [Spacing], Sandbox.Ghost.Stop
+*/
+
+
+/** The start of a .bghost file, followed by the chunks and then NumChunks chunk entries at ChunkTableOffset */
+struct FBhopGhostHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x4F484742; // "BGHO"
+	static constexpr uint32 ExpectedVersion = 1;
+
+	uint32 Magic = ExpectedMagic;
+	uint32 Version = ExpectedVersion;
+	float SampleRate = 30.f;
+	float PositionStep = 0.1f;	// The location is quantized to this many units
+	uint32 FramesPerChunk = 64;
+	uint32 NumFrames = 0;
+	uint32 NumChunks = 0;
+	uint32 Padding = 0;
+	uint64 ChunkTableOffset = 0;
+
+	float GetDuration() const { return NumFrames > 1 ? (NumFrames - 1) / SampleRate : 0.f; }
+};
+
+
+/** Where a chunk is in the file */
+struct FBhopGhostChunkEntry
+{
+	uint64 Offset = 0;
+	uint32 Size = 0;
+	uint32 FirstFrame = 0;
+};
+
+
+/** A decoded frame */
+struct FBhopGhostFrame
+{
+	FVector3f Location = FVector3f::ZeroVector;
+	uint16 Yaw = 0;
+	uint16 Pitch = 0;
+	uint8 MovementMode = 0; // EMovementMode
+
+	FRotator GetRotation() const { return FRotator(FRotator::DecompressAxisFromShort(Pitch), FRotator::DecompressAxisFromShort(Yaw), 0.f); }
+};
+
+
+/**
+ * Samples a character at a fixed rate and encodes the chunks as it goes
+ */
+class SANDBOX_API FBhopGhostRecorder
+{
+public:
+	explicit FBhopGhostRecorder(float InSampleRate = 30.f, int32 InFramesPerChunk = 64, float InPositionStep = 0.1f);
+
+	/** Records the first frame */
+	void Start(const FVector& Location, const FRotator& Rotation, uint8 MovementMode);
+
+	/** Records the frames that fall in this tick, between last tick's transform and this one */
+	void Tick(float DeltaTime, const FVector& Location, const FRotator& Rotation);
+
+	/** The mode is stored with the next frame */
+	void SetMovementMode(uint8 InMovementMode);
+
+	/** Finishes the last chunk and writes the file */
+	bool Save(const FString& Filename);
+
+	int32 GetNumFrames() const { return Header.NumFrames; }
+	int32 GetNumBytes() const { return sizeof(FBhopGhostHeader) + Data.Num() + ChunkData.Num() + ChunkDeltas.Num() + Chunks.Num() * sizeof(FBhopGhostChunkEntry); }
+
+
+private:
+	void AddFrame(const FVector& Location, const FRotator& Rotation);
+	void FlushChunk();
+
+	FBhopGhostHeader Header;
+	TArray<uint8> Data; // The finished chunks
+	TArray<FBhopGhostChunkEntry> Chunks;
+
+	// The current chunk, the keyframe and events in ChunkData and the deltas after them
+	TArray<uint8> ChunkData;
+	TArray<uint8> ChunkDeltas;
+	TArray<TPair<uint32, uint8>> ChunkEvents;
+	uint32 NumChunkFrames = 0;
+	FIntVector PrevLocation = FIntVector::ZeroValue;
+	FIntVector PrevPrevLocation = FIntVector::ZeroValue;
+	uint16 PrevYaw = 0;
+	uint16 PrevPitch = 0;
+	uint8 MovementMode = 0;
+
+	// Sampling
+	double Time = 0.0;
+	double NextSampleTime = 0.0;
+	FVector LastLocation = FVector::ZeroVector;
+	FRotator LastRotation = FRotator::ZeroRotator;
+};
+
+
+/**
+ * A ghost file opened for playback (mapped where the platform supports it), shared between the ghosts playing it
+ */
+class SANDBOX_API FBhopGhostFile
+{
+public:
+	/** Returns null if the file is missing or isn't a ghost */
+	static TSharedPtr<FBhopGhostFile> Open(const FString& Filename);
+
+	const FBhopGhostHeader& GetHeader() const { return *Header; }
+	int32 GetNumChunks() const { return Header->NumChunks; }
+	const FBhopGhostChunkEntry& GetChunk(int32 Index) const { return Chunks[Index]; }
+	int32 GetChunkNumFrames(int32 Index) const;
+
+	/** Decodes every frame of a chunk into OutFrames (appended), returns false if the chunk is corrupt */
+	bool DecodeChunk(int32 Index, TArray<FBhopGhostFrame>& OutFrames) const;
+
+	/** Decodes only the first frame of a chunk */
+	bool DecodeKeyframe(int32 Index, FBhopGhostFrame& OutFrame) const;
+
+
+private:
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedData;
+
+	const uint8* Data = nullptr;
+	int64 DataSize = 0;
+	const FBhopGhostHeader* Header = nullptr;
+	const FBhopGhostChunkEntry* Chunks = nullptr;
+};
+
+
+namespace SandboxGhosts
+{
+	/** Saved/Ghosts/<Name>.bghost */
+	SANDBOX_API FString GetGhostFilename(const FString& Name);
+}
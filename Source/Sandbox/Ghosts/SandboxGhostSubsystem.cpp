@@ -0,0 +1,236 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxGhostSubsystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "BhopGhost.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Ghost Playback"), STAT_Bhop_GhostPlayback, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ghosts"), STAT_Bhop_Ghosts, STATGROUP_Bhop);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Ghost Chunks Decoded"), STAT_Bhop_GhostChunksDecoded, STATGROUP_Bhop);
+
+
+#pragma region Subsystem
+bool USandboxGhostSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+#if !SANDBOX_WITH_COSMETICS
+	return false;
+#else
+	// The ghosts are only something to look at
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && !IsRunningDedicatedServer() && Super::ShouldCreateSubsystem(Outer);
+#endif
+}
+
+
+void USandboxGhostSubsystem::Deinitialize()
+{
+	// The ghosts go with the world
+	Playbacks.Empty();
+	Files.Empty();
+	Super::Deinitialize();
+}
+
+
+bool USandboxGhostSubsystem::IsTickable() const
+{
+	return Playbacks.Num() > 0;
+}
+
+
+TStatId USandboxGhostSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USandboxGhostSubsystem, STATGROUP_Tickables);
+}
+
+
+void USandboxGhostSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_Bhop_GhostPlayback);
+
+	for (int32 Index = Playbacks.Num() - 1; Index >= 0; Index--)
+	{
+		FBhopGhostPlayback& Playback = Playbacks[Index];
+		Playback.Time += DeltaTime;
+		if (!UpdatePlayback(Playback))
+		{
+			if (ABhopGhost* Ghost = Playback.Ghost.Get()) Ghost->Destroy();
+			Playbacks.RemoveAtSwap(Index, 1, false);
+		}
+	}
+
+	SET_DWORD_STAT(STAT_Bhop_Ghosts, Playbacks.Num());
+}
+
+
+ABhopGhost* USandboxGhostSubsystem::PlayGhost(const FString& Filename, float StartTime, bool bLoop)
+{
+	UWorld* World = GetWorld();
+	TSharedPtr<FBhopGhostFile> File = FindOrOpenFile(Filename);
+	if (!World || !File.IsValid()) return nullptr;
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	ABhopGhost* Ghost = World->SpawnActor<ABhopGhost>(ABhopGhost::StaticClass(), FTransform::Identity, SpawnParams);
+	if (!Ghost) return nullptr;
+
+	FBhopGhostPlayback& Playback = Playbacks.AddDefaulted_GetRef();
+	Playback.File = File;
+	Playback.Ghost = Ghost;
+	Playback.Time = FMath::Max(StartTime, 0.f);
+	Playback.bLoop = bLoop;
+	Playback.Frames.Reserve(File->GetHeader().FramesPerChunk + 1);
+	UpdatePlayback(Playback);
+	return Ghost;
+}
+
+
+void USandboxGhostSubsystem::StopGhosts()
+{
+	for (FBhopGhostPlayback& Playback : Playbacks)
+	{
+		if (ABhopGhost* Ghost = Playback.Ghost.Get()) Ghost->Destroy();
+	}
+	Playbacks.Empty();
+}
+
+
+TSharedPtr<FBhopGhostFile> USandboxGhostSubsystem::FindOrOpenFile(const FString& Filename)
+{
+	if (const TWeakPtr<FBhopGhostFile>* Found = Files.Find(Filename))
+	{
+		if (TSharedPtr<FBhopGhostFile> File = Found->Pin()) return File;
+	}
+
+	// Forget the runs nothing is playing anymore
+	for (auto It = Files.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsValid()) It.RemoveCurrent();
+	}
+
+	TSharedPtr<FBhopGhostFile> File = FBhopGhostFile::Open(Filename);
+	if (File.IsValid()) Files.Add(Filename, File);
+	return File;
+}
+
+
+bool USandboxGhostSubsystem::UpdatePlayback(FBhopGhostPlayback& Playback)
+{
+	ABhopGhost* Ghost = Playback.Ghost.Get();
+	if (!Ghost) return false;
+
+	const FBhopGhostFile& File = *Playback.File;
+	const FBhopGhostHeader& Header = File.GetHeader();
+	const float Duration = Header.GetDuration();
+	if (Playback.Time > Duration)
+	{
+		if (!Playback.bLoop) return false;
+		Playback.Time = Duration > 0.f ? FMath::Fmod(Playback.Time, Duration) : 0.f;
+	}
+
+	const float FrameTime = Playback.Time * Header.SampleRate;
+	const uint32 Frame = FMath::Min(static_cast<uint32>(FMath::FloorToInt(FrameTime)), Header.NumFrames - 1);
+	const float Alpha = FMath::Clamp(FrameTime - Frame, 0.f, 1.f);
+
+	// Decode the chunk when we get to it, with the next chunk's keyframe on the end so we can interpolate into it
+	const int32 ChunkIndex = Frame / Header.FramesPerChunk;
+	if (ChunkIndex != Playback.ChunkIndex)
+	{
+		Playback.Frames.Reset();
+		if (!File.DecodeChunk(ChunkIndex, Playback.Frames)) return false;
+
+		FBhopGhostFrame NextKeyframe;
+		if (ChunkIndex + 1 < File.GetNumChunks() && File.DecodeKeyframe(ChunkIndex + 1, NextKeyframe)) Playback.Frames.Add(NextKeyframe);
+		Playback.ChunkIndex = ChunkIndex;
+		Playback.ChunkFirstFrame = File.GetChunk(ChunkIndex).FirstFrame;
+		INC_DWORD_STAT(STAT_Bhop_GhostChunksDecoded);
+	}
+
+	const int32 LocalFrame = Frame - Playback.ChunkFirstFrame;
+	const FBhopGhostFrame& From = Playback.Frames[LocalFrame];
+	const FBhopGhostFrame& To = Playback.Frames[FMath::Min(LocalFrame + 1, Playback.Frames.Num() - 1)];
+
+	// The decompressed axes are 0 - 360, so interpolate along the shortest way around (359 to 1 shouldn't spin the whole way back)
+	const FRotator FromRotation = From.GetRotation();
+	const FRotator ToRotation = To.GetRotation();
+	const FRotator Rotation = FromRotation + (ToRotation - FromRotation).GetNormalized() * Alpha;
+	Ghost->SetGhostTransform(FVector(FMath::Lerp(From.Location, To.Location, Alpha)), Rotation, static_cast<EMovementMode>(From.MovementMode));
+	return true;
+}
+#pragma endregion
+
+
+#pragma region Console
+namespace
+{
+	ABhopCharacter* GetLocalBhopCharacter(UWorld* World)
+	{
+		const APlayerController* PlayerController = World ? World->GetFirstPlayerController() : nullptr;
+		return PlayerController ? Cast<ABhopCharacter>(PlayerController->GetPawn()) : nullptr;
+	}
+}
+
+
+static FAutoConsoleCommand GhostRecordCommand(
+	TEXT("Sandbox.Ghost.Record"),
+	TEXT("Starts recording a ghost of the local bhop character, save it with Sandbox.Ghost.Save"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (ABhopCharacter* Character = GetLocalBhopCharacter(World))
+		{
+			Character->StartGhostRecording();
+			UE_LOG(LogTemp, Log, TEXT("Sandbox.Ghost.Record: Recording %s"), *GetNameSafe(Character));
+		}
+	})
+);
+
+static FAutoConsoleCommand GhostSaveCommand(
+	TEXT("Sandbox.Ghost.Save"),
+	TEXT("Stops recording the local bhop character and saves the ghost to Saved/Ghosts. Usage: Sandbox.Ghost.Save [Name=Ghost]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		ABhopCharacter* Character = GetLocalBhopCharacter(World);
+		if (!Character || !Character->IsRecordingGhost()) return;
+
+		const FString Filename = SandboxGhosts::GetGhostFilename(Args.Num() > 0 ? Args[0] : TEXT("Ghost"));
+		const bool bSaved = Character->StopGhostRecording(Filename);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Ghost.Save: %s %s"), bSaved ? TEXT("Saved") : TEXT("Failed to save"), *Filename);
+	})
+);
+
+static FAutoConsoleCommand GhostPlayCommand(
+	TEXT("Sandbox.Ghost.Play"),
+	TEXT("Plays a saved ghost on a loop, Count ghosts of it Spacing seconds apart. Usage: Sandbox.Ghost.Play [Name=Ghost] [Count=1] [Spacing=0.5]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		USandboxGhostSubsystem* Ghosts = World ? World->GetSubsystem<USandboxGhostSubsystem>() : nullptr;
+		if (!Ghosts) return;
+
+		const FString Filename = SandboxGhosts::GetGhostFilename(Args.Num() > 0 ? Args[0] : TEXT("Ghost"));
+		const int32 Count = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 1;
+		const float Spacing = Args.Num() > 2 ? FCString::Atof(*Args[2]) : 0.5f;
+		int32 NumSpawned = 0;
+		for (int32 Index = 0; Index < Count; Index++)
+		{
+			if (!Ghosts->PlayGhost(Filename, Index * Spacing)) break;
+			NumSpawned++;
+		}
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.Ghost.Play: Playing %d ghosts of %s (%d in total)"), NumSpawned, *Filename, Ghosts->GetNumGhosts());
+	})
+);
+
+static FAutoConsoleCommand GhostStopCommand(
+	TEXT("Sandbox.Ghost.Stop"),
+	TEXT("Removes every ghost"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (USandboxGhostSubsystem* Ghosts = World ? World->GetSubsystem<USandboxGhostSubsystem>() : nullptr) Ghosts->StopGhosts();
+	})
+);
+#pragma endregion
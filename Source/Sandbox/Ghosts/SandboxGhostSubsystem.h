@@ -0,0 +1,60 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "BhopGhostFormat.h"
+#include "SandboxGhostSubsystem.generated.h"
+
+
+/** A ghost that's playing, with the chunk it's in decoded */
+struct FBhopGhostPlayback
+{
+	TSharedPtr<FBhopGhostFile> File;
+	TWeakObjectPtr<class ABhopGhost> Ghost;
+	float Time = 0.f;
+	bool bLoop = true;
+
+	int32 ChunkIndex = INDEX_NONE;
+	uint32 ChunkFirstFrame = 0;
+	TArray<FBhopGhostFrame> Frames; // The chunk's frames, plus the first frame of the next chunk to interpolate into
+};
+
+
+/**
+ * Plays the ghost runs back (see BhopGhostFormat.h)
+ * Every ghost is moved from one tick here, and only the chunk each ghost is in is decoded, so a lot of ghosts cost about as much as moving their meshes
+ */
+UCLASS()
+class SANDBOX_API USandboxGhostSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Spawns a ghost and plays a run on it from StartTime, returns null if the file isn't a ghost */
+	class ABhopGhost* PlayGhost(const FString& Filename, float StartTime = 0.f, bool bLoop = true);
+
+	/** Removes every ghost */
+	void StopGhosts();
+
+	int32 GetNumGhosts() const { return Playbacks.Num(); }
+
+
+private:
+	/** The ghosts playing the same run share the file */
+	TSharedPtr<FBhopGhostFile> FindOrOpenFile(const FString& Filename);
+
+	/** Moves a ghost to its current time, returns false when it's done */
+	bool UpdatePlayback(FBhopGhostPlayback& Playback);
+
+	TMap<FString, TWeakPtr<FBhopGhostFile>> Files;
+	TArray<FBhopGhostPlayback> Playbacks;
+};
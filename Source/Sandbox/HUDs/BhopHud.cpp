@@ -4,6 +4,7 @@
 #include "BhopHud.h"
 #include "GameFramework/PlayerController.h"
 #include "Sandbox/HUDs/CharacterOverlay.h"
+#include "Sandbox/SandboxMemory.h"
 
 
 void ABhopHud::BeginPlay()
@@ -23,12 +24,15 @@ void ABhopHud::DrawHUD()
 
 void ABhopHud::AddCharacterOverlay()
 {
+#if SANDBOX_WITH_COSMETICS
+	LLM_SCOPE_BYTAG(Sandbox_HUD);
 	APlayerController* PlayerController = GetOwningPlayerController();
 	if (PlayerController && CharacterOverlayClass)
 	{
 		CharacterOverlay = CreateWidget<UCharacterOverlay>(PlayerController, CharacterOverlayClass);
 		if (CharacterOverlay) CharacterOverlay->AddToViewport();
 	}
+#endif
 }
 
 
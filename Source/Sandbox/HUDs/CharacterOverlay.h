@@ -23,5 +23,13 @@ public:
 	UPROPERTY(meta = (BindWidget))
 		class UTextBlock* FrictionValue;
 
+	// Net readout (optional, the client's outgoing packets and bytes per second and the move send interval)
+	UPROPERTY(meta = (BindWidgetOptional))
+		class UTextBlock* NetPacketsPerSecondValue;
+	UPROPERTY(meta = (BindWidgetOptional))
+		class UTextBlock* NetBytesPerSecondValue;
+	UPROPERTY(meta = (BindWidgetOptional))
+		class UTextBlock* NetSendIntervalValue;
+
 
 };
@@ -0,0 +1,112 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxNetStats.h"
+#include "HAL/IConsoleManager.h"
+#include "Net/UnrealNetwork.h"
+#include "UObject/ObjectKey.h"
+
+
+DEFINE_STAT(STAT_SandboxNet_PushModelDirtyMarks);
+DEFINE_STAT(STAT_SandboxNet_PushModelUnchangedWrites);
+DEFINE_STAT(STAT_SandboxNet_PushModelCompareSaved);
+DEFINE_STAT(STAT_SandboxNet_PushModelComparesSaved);
+
+static bool GSandboxPushModelMeasureCompares = false;
+static FAutoConsoleVariableRef CVarSandboxPushModelMeasureCompares(
+	TEXT("Sandbox.PushModel.MeasureCompares"),
+	GSandboxPushModelMeasureCompares,
+	TEXT("Redo the compares push model skips when the objects are replicated, and show their time in \"stat SandboxNet\" (see SandboxNetStats.h)"),
+	ECVF_Default
+);
+
+
+#pragma region Compare Meter
+namespace SandboxPushModel
+{
+	/** A copy of an object's push based properties from the last time it was replicated, what the net driver's shadow state would hold without push model */
+	struct FShadowState
+	{
+		TArray<const FProperty*> Properties;
+		TArray<void*> Values;
+
+		~FShadowState()
+		{
+			for (int32 Index = 0; Index < Properties.Num(); Index++)
+			{
+				Properties[Index]->DestroyValue(Values[Index]);
+				FMemory::Free(Values[Index]);
+			}
+		}
+	};
+
+	static TMap<FObjectKey, TUniquePtr<FShadowState>> ShadowStates;
+	static uint64 LastPruneFrame = 0;
+
+
+	void MeasureSavedCompares(const UObject* Object)
+	{
+		if (!GSandboxPushModelMeasureCompares || !Object)
+		{
+			if (ShadowStates.Num() > 0) ShadowStates.Empty();
+			return;
+		}
+
+		// Forget the objects that are gone once a frame
+		if (LastPruneFrame != GFrameCounter)
+		{
+			LastPruneFrame = GFrameCounter;
+			for (auto It = ShadowStates.CreateIterator(); It; ++It)
+			{
+				if (!It.Key().ResolveObjectPtr()) It.RemoveCurrent();
+			}
+		}
+
+		TUniquePtr<FShadowState>& State = ShadowStates.FindOrAdd(FObjectKey(Object));
+		if (!State)
+		{
+			// The push based properties, from the same lifetime list the net driver builds its layout from
+			State = MakeUnique<FShadowState>();
+			TArray<FLifetimeProperty> LifetimeProps;
+			Object->GetLifetimeReplicatedProps(LifetimeProps);
+			for (const FLifetimeProperty& LifetimeProp : LifetimeProps)
+			{
+				if (!LifetimeProp.bIsPushBased || !Object->GetClass()->ClassReps.IsValidIndex(LifetimeProp.RepIndex)) continue;
+				const FProperty* Property = Object->GetClass()->ClassReps[LifetimeProp.RepIndex].Property;
+				if (State->Properties.Contains(Property)) continue;
+
+				void* Value = FMemory::Malloc(Property->GetSize(), Property->GetMinAlignment());
+				Property->InitializeValue(Value);
+				Property->CopyCompleteValue(Value, Property->ContainerPtrToValuePtr<void>(Object));
+				State->Properties.Add(Property);
+				State->Values.Add(Value);
+			}
+			return;
+		}
+
+		// The compares that come out the same are the ones the net driver skips, the changed ones would have been marked dirty and compared anyway
+		for (int32 Index = 0; Index < State->Properties.Num(); Index++)
+		{
+			const FProperty* Property = State->Properties[Index];
+			const void* Current = Property->ContainerPtrToValuePtr<void>(Object);
+			const uint64 StartCycles = FPlatformTime::Cycles64();
+			bool bIdentical = true;
+			for (int32 ArrayIndex = 0; ArrayIndex < Property->ArrayDim && bIdentical; ArrayIndex++)
+			{
+				bIdentical = Property->Identical((const uint8*)Current + ArrayIndex * Property->ElementSize, (const uint8*)State->Values[Index] + ArrayIndex * Property->ElementSize);
+			}
+			const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+			if (bIdentical)
+			{
+				INC_FLOAT_STAT_BY(STAT_SandboxNet_PushModelCompareSaved, FPlatformTime::ToSeconds64(Cycles) * 1000000.0);
+				INC_DWORD_STAT(STAT_SandboxNet_PushModelComparesSaved);
+			}
+			else
+			{
+				Property->CopyCompleteValue(State->Values[Index], Current);
+			}
+		}
+	}
+}
+#pragma endregion
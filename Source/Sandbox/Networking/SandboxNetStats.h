@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Net/Core/PushModel/PushModel.h"
+
+
+/*
+	Push model replication helpers
+
+	With push model the net driver only compares the properties that have been marked dirty, instead of every replicated property of every actor each time it's considered for replication.
+	The replicated properties are declared with bIsPushBased (see GetLifetimeReplicatedProps), so anything that writes to them at runtime has to mark them dirty or the change is never sent.
+
+	Properties that change every frame (FrameTime) stay polled, marking them dirty every tick would only add work on top of the compare.
+
+	"stat SandboxNet" shows the dirty marks each frame, and the writes that didn't change anything (each one is a property compare the net driver no longer does for us).
+	With Sandbox.PushModel.MeasureCompares on, the objects that call MeasureSavedCompares also redo the compare of every push based property when they're replicated,
+	and the time of the ones that came out unchanged goes into "Push Model Compare Time Saved" each frame (that's the compare the net driver skips, measuring it costs the same again, so leave it off otherwise).
+
+	Push model is turned on with net.IsPushModelEnabled=1 (DefaultEngine.ini), which works with the engine's own build of the net code.
+	The targets don't set bWithPushModel, that needs BuildEnvironment = TargetBuildEnvironment.Unique, which only a source build of the engine can do, and the editor target would have to match.
+	If WITH_PUSH_MODEL isn't compiled in these macros only bump the counters, and the properties are polled like before.
+*/
+
+
+DECLARE_STATS_GROUP(TEXT("SandboxNet"), STATGROUP_SandboxNet, STATCAT_Advanced);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Push Model Dirty Marks"), STAT_SandboxNet_PushModelDirtyMarks, STATGROUP_SandboxNet, SANDBOX_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Push Model Unchanged Writes"), STAT_SandboxNet_PushModelUnchangedWrites, STATGROUP_SandboxNet, SANDBOX_API);
+DECLARE_FLOAT_COUNTER_STAT_EXTERN(TEXT("Push Model Compare Time Saved (us)"), STAT_SandboxNet_PushModelCompareSaved, STATGROUP_SandboxNet, SANDBOX_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Push Model Compares Saved"), STAT_SandboxNet_PushModelComparesSaved, STATGROUP_SandboxNet, SANDBOX_API);
+
+
+namespace SandboxPushModel
+{
+	/** Times the compares push model saved for the object's push based properties (only with Sandbox.PushModel.MeasureCompares), call it from PreReplication */
+	SANDBOX_API void MeasureSavedCompares(const UObject* Object);
+}
+
+
+/** Marks a push based property dirty */
+#define SANDBOX_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object) \
+	{ \
+		MARK_PROPERTY_DIRTY_FROM_NAME(ClassName, PropertyName, Object); \
+		INC_DWORD_STAT(STAT_SandboxNet_PushModelDirtyMarks); \
+	}
+
+/** Only assigns and marks the property dirty if the value changed */
+#define SANDBOX_COMPARE_ASSIGN_AND_MARK_DIRTY(ClassName, PropertyName, NewValue, Object) \
+	{ \
+		if ((NewValue) != (Object)->PropertyName) \
+		{ \
+			(Object)->PropertyName = (NewValue); \
+			SANDBOX_MARK_PROPERTY_DIRTY(ClassName, PropertyName, Object); \
+		} \
+		else \
+		{ \
+			INC_DWORD_STAT(STAT_SandboxNet_PushModelUnchangedWrites); \
+		} \
+	}
@@ -0,0 +1,473 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxReplicationGraph.h"
+#include "Engine/NetDriver.h"
+#include "Engine/ChildConnection.h"
+#include "GameFramework/PlayerController.h"
+#include "GameFramework/PlayerState.h"
+#include "GameFramework/Pawn.h"
+#include "UObject/UObjectIterator.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopNetPolicy.h"
+#include "Sandbox/Characters/BhopProto/BhopProfiler.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("RepGraph Fast Movers"), STAT_Bhop_RepGraphFastMovers, STATGROUP_Bhop);
+
+
+/** The graph if it's recording a profile (Sandbox.RepGraph.Profile), for the nodes to add their time to */
+static USandboxReplicationGraph* GetProfilingGraph(const TSharedPtr<FReplicationGraphGlobalData>& GraphGlobals)
+{
+	USandboxReplicationGraph* ReplicationGraph = GraphGlobals.IsValid() ? Cast<USandboxReplicationGraph>(GraphGlobals->ReplicationGraph) : nullptr;
+	return ReplicationGraph && ReplicationGraph->IsProfiling() ? ReplicationGraph : nullptr;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Replication Graph																																						 				 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Replication Graph
+USandboxReplicationGraph::USandboxReplicationGraph()
+{
+	GlobalActorChannelFrameNumTimeout = 4;
+}
+
+
+void USandboxReplicationGraph::InitGlobalActorClassSettings()
+{
+	Super::InitGlobalActorClassSettings();
+
+	// Every replicated class starts with the relevancy and update rate from its defaults
+	for (TObjectIterator<UClass> It; It; ++It)
+	{
+		UClass* Class = *It;
+		AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject(false));
+		if (!ActorCDO || !ActorCDO->GetIsReplicated()) continue;
+
+		// Skip the blueprint skeleton and reinstanced classes
+		const FString ClassName = Class->GetName();
+		if (ClassName.StartsWith(TEXT("SKEL_")) || ClassName.StartsWith(TEXT("REINST_"))) continue;
+
+		FClassReplicationInfo ClassInfo;
+		ClassInfo.SetCullDistanceSquared(ActorCDO->NetCullDistanceSquared);
+		ClassInfo.ReplicationPeriodFrame = GetReplicationPeriodFrame(ActorCDO->NetUpdateFrequency);
+		GlobalActorReplicationInfoMap.SetClassInfo(Class, ClassInfo);
+	}
+}
+
+
+void USandboxReplicationGraph::InitGlobalGraphNodes()
+{
+	// Spatial grid for everything with a location
+	GridNode = CreateNewNode<USandboxReplicationGraphNode_BhopGrid>();
+	GridNode->CellSize = GridCellSize;
+	GridNode->SpatialBias = SpatialBias;
+	AddGlobalGraphNode(GridNode);
+
+	// The game state and anything else that's always relevant
+	AlwaysRelevantNode = CreateNewNode<UReplicationGraphNode_ActorList>();
+	AddGlobalGraphNode(AlwaysRelevantNode);
+
+	// Weapons, inventory, and anything else that's only relevant to its owner
+	OwnerOnlyNode = CreateNewNode<USandboxReplicationGraphNode_OwnerOnly>();
+	AddGlobalGraphNode(OwnerOnlyNode);
+}
+
+
+void USandboxReplicationGraph::InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection)
+{
+	Super::InitConnectionGraphNodes(RepGraphConnection);
+
+	// The connection's own controller, player state and pawn
+	USandboxReplicationGraphNode_AlwaysRelevant_ForConnection* AlwaysRelevantForConnectionNode = CreateNewNode<USandboxReplicationGraphNode_AlwaysRelevant_ForConnection>();
+	AddConnectionGraphNode(AlwaysRelevantForConnectionNode, RepGraphConnection);
+}
+
+
+void USandboxReplicationGraph::RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo)
+{
+	switch (GetRoute(ActorInfo.Class))
+	{
+	case ESandboxRepRoute::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case ESandboxRepRoute::RelevantToOwner:
+		OwnerOnlyNode->NotifyAddNetworkActor(ActorInfo);
+		break;
+	case ESandboxRepRoute::Spatialize_Static:
+		GridNode->AddActor_Static(ActorInfo, GlobalInfo);
+		break;
+	case ESandboxRepRoute::Spatialize_Dynamic:
+		GridNode->AddActor_Dynamic(ActorInfo, GlobalInfo);
+		if (ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(ActorInfo.Actor)) GridNode->AddBhopCharacter(BhopCharacter);
+		break;
+	case ESandboxRepRoute::Spatialize_Dormancy:
+		GridNode->AddActor_Dormancy(ActorInfo, GlobalInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+
+void USandboxReplicationGraph::RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo)
+{
+	switch (GetRoute(ActorInfo.Class))
+	{
+	case ESandboxRepRoute::AlwaysRelevant:
+		AlwaysRelevantNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case ESandboxRepRoute::RelevantToOwner:
+		OwnerOnlyNode->NotifyRemoveNetworkActor(ActorInfo);
+		break;
+	case ESandboxRepRoute::Spatialize_Static:
+		GridNode->RemoveActor_Static(ActorInfo);
+		break;
+	case ESandboxRepRoute::Spatialize_Dynamic:
+		GridNode->RemoveActor_Dynamic(ActorInfo);
+		if (ABhopCharacter* BhopCharacter = Cast<ABhopCharacter>(ActorInfo.Actor)) GridNode->RemoveBhopCharacter(BhopCharacter);
+		break;
+	case ESandboxRepRoute::Spatialize_Dormancy:
+		GridNode->RemoveActor_Dormancy(ActorInfo);
+		break;
+	default:
+		break;
+	}
+}
+
+
+ESandboxRepRoute USandboxReplicationGraph::GetRoute(UClass* Class)
+{
+	if (const ESandboxRepRoute* Route = ClassRoutes.Find(Class)) return *Route;
+
+	// Decide the route from the class defaults (the same class always takes the same route, so removing an actor finds it in the node it was added to)
+	ESandboxRepRoute Route = ESandboxRepRoute::Spatialize_Dynamic;
+	const AActor* ActorCDO = Cast<AActor>(Class->GetDefaultObject());
+	if (!ActorCDO || Class->IsChildOf(APlayerController::StaticClass()))
+	{
+		Route = ESandboxRepRoute::NotRouted;
+	}
+	else if (ActorCDO->bOnlyRelevantToOwner)
+	{
+		Route = ESandboxRepRoute::RelevantToOwner;
+	}
+	else if (ActorCDO->bAlwaysRelevant || Class->IsChildOf(APlayerState::StaticClass()))
+	{
+		Route = ESandboxRepRoute::AlwaysRelevant;
+	}
+	else if (Class->IsChildOf(APawn::StaticClass()) || ActorCDO->IsReplicatingMovement())
+	{
+		Route = ActorCDO->NetDormancy > DORM_Awake ? ESandboxRepRoute::Spatialize_Dormancy : ESandboxRepRoute::Spatialize_Dynamic;
+	}
+	else
+	{
+		Route = ESandboxRepRoute::Spatialize_Static;
+	}
+
+	ClassRoutes.Add(Class, Route);
+	return Route;
+}
+
+
+uint32 USandboxReplicationGraph::GetReplicationPeriodFrame(float UpdateFrequency) const
+{
+	const float ServerTickRate = NetDriver ? NetDriver->NetServerMaxTickRate : 30.f;
+	return FMath::Max<uint32>(FMath::RoundToInt(ServerTickRate / FMath::Max(UpdateFrequency, 1.f)), 1);
+}
+#pragma endregion
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Profile																																													 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Profile
+int32 USandboxReplicationGraph::ServerReplicateActors(float DeltaSeconds)
+{
+	if (!IsProfiling()) return Super::ServerReplicateActors(DeltaSeconds);
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+	const int32 NumReplicated = Super::ServerReplicateActors(DeltaSeconds);
+	const uint64 Cycles = FPlatformTime::Cycles64() - StartCycles;
+
+	// Frames without any connections don't say anything about the cost per connection
+	const int32 NumConnections = Connections.Num();
+	if (NumConnections > 0)
+	{
+		ProfileTotalCycles += Cycles;
+		ProfileConnectionFrames += NumConnections;
+		ProfileMaxConnections = FMath::Max(ProfileMaxConnections, NumConnections);
+		ProfileConnectionMicroseconds.Add(FPlatformTime::ToSeconds64(Cycles) * 1e6 / NumConnections);
+		if (--ProfileFramesLeft == 0) FinishProfile();
+	}
+	return NumReplicated;
+}
+
+
+void USandboxReplicationGraph::StartProfile(int32 NumFrames)
+{
+	ProfileFramesLeft = FMath::Max(NumFrames, 1);
+	ProfileFrames = ProfileFramesLeft;
+	ProfileConnectionFrames = 0;
+	ProfilePrepareCycles = 0;
+	ProfileGatherCycles = 0;
+	ProfileTotalCycles = 0;
+	ProfileMaxConnections = 0;
+	ProfileConnectionMicroseconds.Reset(ProfileFrames);
+}
+
+
+void USandboxReplicationGraph::FinishProfile()
+{
+	ProfileConnectionMicroseconds.Sort();
+	const auto Percentile = [this](float Value) { return ProfileConnectionMicroseconds[FMath::Clamp(FMath::CeilToInt(Value * ProfileConnectionMicroseconds.Num()) - 1, 0, ProfileConnectionMicroseconds.Num() - 1)]; };
+
+	// The gather is per connection, the prepare is once a frame, and the rest of the replication time is the engine prioritizing and sending what was gathered
+	const double ConnectionFrames = FMath::Max<double>(ProfileConnectionFrames, 1.0);
+	const double PrepareMicroseconds = FPlatformTime::ToSeconds64(ProfilePrepareCycles) * 1e6 / ProfileFrames;
+	const double GatherMicroseconds = FPlatformTime::ToSeconds64(ProfileGatherCycles) * 1e6 / ConnectionFrames;
+	const double TotalMicroseconds = FPlatformTime::ToSeconds64(ProfileTotalCycles) * 1e6 / ConnectionFrames;
+	const double PrioritizeMicroseconds = FMath::Max(TotalMicroseconds - GatherMicroseconds - PrepareMicroseconds * ProfileFrames / ConnectionFrames, 0.0);
+	const double AverageConnections = ConnectionFrames / ProfileFrames;
+
+	UE_LOG(LogTemp, Log, TEXT("Sandbox.RepGraph.Profile: %d frames, %.1f connections (max %d), %d bhop characters. Prepare %.2f us per frame, per connection: gather %.2f us, prioritize and send %.2f us, total %.2f us (p50 %.2f, p95 %.2f, p99 %.2f)"),
+		ProfileFrames, AverageConnections, ProfileMaxConnections, GridNode ? GridNode->GetNumBhopCharacters() : 0, PrepareMicroseconds, GatherMicroseconds, PrioritizeMicroseconds, TotalMicroseconds, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f));
+
+	const FString Summary = FString::Printf(TEXT("Frames,AvgConnections,MaxConnections,BhopCharacters,PrepareUsPerFrame,GatherUsPerConnection,PrioritizeAndSendUsPerConnection,TotalUsPerConnection,P50Us,P95Us,P99Us\n%d,%.2f,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"),
+		ProfileFrames, AverageConnections, ProfileMaxConnections, GridNode ? GridNode->GetNumBhopCharacters() : 0, PrepareMicroseconds, GatherMicroseconds, PrioritizeMicroseconds, TotalMicroseconds, Percentile(0.5f), Percentile(0.95f), Percentile(0.99f));
+	FFileHelper::SaveStringToFile(Summary, *(FPaths::ProfilingDir() / TEXT("Bhop") / FString::Printf(TEXT("RepGraph_%dConnections.csv"), ProfileMaxConnections)));
+}
+
+
+static FAutoConsoleCommand RepGraphProfileCommand(
+	TEXT("Sandbox.RepGraph.Profile"),
+	TEXT("Records the replication graph's prepare, gather, and prioritize and send time per connection over the next frames, see SandboxReplicationGraph.h. Usage: Sandbox.RepGraph.Profile [Frames=600]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+		USandboxReplicationGraph* ReplicationGraph = NetDriver ? Cast<USandboxReplicationGraph>(NetDriver->GetReplicationDriver()) : nullptr;
+		if (!ReplicationGraph)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Sandbox.RepGraph.Profile: This isn't a server using the sandbox replication graph"));
+			return;
+		}
+
+		const int32 NumFrames = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 600;
+		ReplicationGraph->StartProfile(NumFrames);
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.RepGraph.Profile: Recording %d frames with %d connections"), NumFrames, ReplicationGraph->Connections.Num());
+	})
+);
+#pragma endregion
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Grid Node (Bhop)																																											 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Grid Node
+void USandboxReplicationGraphNode_BhopGrid::PrepareForReplication()
+{
+	USandboxReplicationGraph* ProfilingGraph = GetProfilingGraph(GraphGlobals);
+	const uint64 StartCycles = ProfilingGraph ? FPlatformTime::Cycles64() : 0;
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_Bhop_RepGraphFastMovers);
+		USandboxReplicationGraph* ReplicationGraph = GraphGlobals.IsValid() ? Cast<USandboxReplicationGraph>(GraphGlobals->ReplicationGraph) : nullptr;
+		FGlobalActorReplicationInfoMap* GlobalInfoMap = GraphGlobals.IsValid() ? GraphGlobals->GlobalActorReplicationInfoMap : nullptr;
+
+		if (ReplicationGraph && GlobalInfoMap)
+		{
+			const float CullDistanceStep = FMath::Max(ReplicationGraph->FastMoverCullDistanceStep, 1.f);
+			for (FSandboxBhopGridEntry& Entry : BhopCharacters)
+			{
+				ABhopCharacter* BhopCharacter = Entry.Character;
+				if (!IsValid(BhopCharacter) || !BhopCharacter->IsNetPolicyEnabled()) continue;
+
+				// Widen the cull distance (the number of cells we're added to) and update rate with our speed, before the grid updates the dynamic actor cells
+				// The distance is rounded up to the next step so it only changes every so often while we're speeding up or slowing down
+				const float Speed = BhopCharacter->GetSpeedometer();
+				const float CullDistance = FMath::CeilToFloat(FMath::Sqrt(BhopNetPolicy::GetCullDistanceSquared(BhopCharacter->GetNetPolicy(), BhopCharacter->GetBaseNetCullDistanceSquared(), Speed)) / CullDistanceStep) * CullDistanceStep;
+				const float CullDistanceSquared = CullDistance * CullDistance;
+				const uint32 ReplicationPeriodFrame = ReplicationGraph->GetReplicationPeriodFrame(BhopNetPolicy::GetUpdateFrequency(BhopCharacter->GetNetPolicy(), Speed));
+				if (CullDistanceSquared == Entry.CullDistanceSquared && ReplicationPeriodFrame == Entry.ReplicationPeriodFrame) continue;
+
+				Entry.CullDistanceSquared = CullDistanceSquared;
+				Entry.ReplicationPeriodFrame = ReplicationPeriodFrame;
+				FGlobalActorReplicationInfo& GlobalInfo = GlobalInfoMap->Get(BhopCharacter);
+				GlobalInfo.Settings.SetCullDistanceSquared(CullDistanceSquared);
+				GlobalInfo.Settings.ReplicationPeriodFrame = ReplicationPeriodFrame;
+
+				// The connections keep their own copy of these once the actor has been considered for them
+				for (UNetReplicationGraphConnection* Connection : ReplicationGraph->Connections)
+				{
+					if (FConnectionReplicationActorInfo* ConnectionInfo = Connection->ActorInfoMap.Find(BhopCharacter))
+					{
+						ConnectionInfo->SetCullDistanceSquared(CullDistanceSquared);
+						ConnectionInfo->ReplicationPeriodFrame = ReplicationPeriodFrame;
+					}
+				}
+			}
+
+			UpdatePriorityBias(ReplicationGraph, *GlobalInfoMap);
+		}
+	}
+
+	Super::PrepareForReplication();
+	if (ProfilingGraph) ProfilingGraph->AddProfilePrepareCycles(FPlatformTime::Cycles64() - StartCycles);
+}
+
+
+void USandboxReplicationGraphNode_BhopGrid::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	USandboxReplicationGraph* ProfilingGraph = GetProfilingGraph(GraphGlobals);
+	const uint64 StartCycles = ProfilingGraph ? FPlatformTime::Cycles64() : 0;
+	Super::GatherActorListsForConnection(Params);
+	if (ProfilingGraph) ProfilingGraph->AddProfileGatherCycles(FPlatformTime::Cycles64() - StartCycles);
+}
+
+
+void USandboxReplicationGraphNode_BhopGrid::UpdatePriorityBias(USandboxReplicationGraph* ReplicationGraph, FGlobalActorReplicationInfoMap& GlobalInfoMap)
+{
+	Viewers.Reset();
+	for (UNetReplicationGraphConnection* Connection : ReplicationGraph->Connections)
+	{
+		if (Connection && Connection->NetConnection && Connection->NetConnection->PlayerController) Viewers.Emplace(Connection->NetConnection, 0.f);
+	}
+
+	for (const FSandboxBhopGridEntry& Entry : BhopCharacters)
+	{
+		ABhopCharacter* BhopCharacter = Entry.Character;
+		if (!IsValid(BhopCharacter)) continue;
+
+		// The graph's priority is shared between the connections, so use the viewer we're closing in on the fastest (the same scale GetNetPriority gives the net driver)
+		float PriorityScale = 1.f;
+		if (BhopCharacter->IsNetPolicyEnabled())
+		{
+			const FVector Location = BhopCharacter->GetActorLocation();
+			const FVector Velocity = BhopCharacter->GetVelocity();
+			for (const FNetViewer& Viewer : Viewers)
+			{
+				if (Viewer.ViewTarget == BhopCharacter) continue;
+				PriorityScale = FMath::Max(PriorityScale, BhopNetPolicy::GetPriorityScale(BhopCharacter->GetNetPolicy(), Location, Velocity, Viewer.ViewLocation, Viewer.ViewDir));
+			}
+		}
+
+		// Lower goes first, and the distance and starvation factors are each 0 - 1, so a scale of 2 takes half a point off
+		GlobalInfoMap.Get(BhopCharacter).Settings.AccumulatedNetPriorityBias = -(1.f - 1.f / PriorityScale);
+	}
+}
+
+
+void USandboxReplicationGraphNode_BhopGrid::AddBhopCharacter(ABhopCharacter* Character)
+{
+	if (BhopCharacters.ContainsByPredicate([Character](const FSandboxBhopGridEntry& Entry) { return Entry.Character == Character; })) return;
+
+	FSandboxBhopGridEntry Entry;
+	Entry.Character = Character;
+	BhopCharacters.Add(Entry);
+}
+
+
+void USandboxReplicationGraphNode_BhopGrid::RemoveBhopCharacter(ABhopCharacter* Character)
+{
+	const int32 Index = BhopCharacters.IndexOfByPredicate([Character](const FSandboxBhopGridEntry& Entry) { return Entry.Character == Character; });
+	if (Index != INDEX_NONE) BhopCharacters.RemoveAtSwap(Index);
+}
+#pragma endregion
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Owner Only Node																																											 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Owner Only
+USandboxReplicationGraphNode_OwnerOnly::USandboxReplicationGraphNode_OwnerOnly()
+{
+	bRequiresPrepareForReplicationCall = true;
+}
+
+
+void USandboxReplicationGraphNode_OwnerOnly::NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo)
+{
+	Actors.Add(ActorInfo.Actor);
+}
+
+
+bool USandboxReplicationGraphNode_OwnerOnly::NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound)
+{
+	return Actors.RemoveFast(ActorInfo.Actor);
+}
+
+
+void USandboxReplicationGraphNode_OwnerOnly::NotifyResetAllNetworkActors()
+{
+	Actors.Reset();
+	ActorsByConnection.Reset();
+}
+
+
+void USandboxReplicationGraphNode_OwnerOnly::PrepareForReplication()
+{
+	USandboxReplicationGraph* ProfilingGraph = GetProfilingGraph(GraphGlobals);
+	const uint64 StartCycles = ProfilingGraph ? FPlatformTime::Cycles64() : 0;
+	for (TPair<UNetConnection*, FActorRepListRefView>& Pair : ActorsByConnection) Pair.Value.Reset();
+
+	// One pass over the actors instead of one per connection, split screen players replicate through their parent's connection
+	for (AActor* Actor : Actors)
+	{
+		UNetConnection* Connection = IsValid(Actor) ? Actor->GetNetConnection() : nullptr;
+		if (!Connection) continue;
+		if (UChildConnection* ChildConnection = Cast<UChildConnection>(Connection)) Connection = ChildConnection->Parent;
+
+		ActorsByConnection.FindOrAdd(Connection).Add(Actor);
+	}
+
+	// Drop the connections that don't own anything anymore (or have closed)
+	for (auto It = ActorsByConnection.CreateIterator(); It; ++It)
+	{
+		if (It->Value.Num() == 0) It.RemoveCurrent();
+	}
+	if (ProfilingGraph) ProfilingGraph->AddProfilePrepareCycles(FPlatformTime::Cycles64() - StartCycles);
+}
+
+
+void USandboxReplicationGraphNode_OwnerOnly::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	USandboxReplicationGraph* ProfilingGraph = GetProfilingGraph(GraphGlobals);
+	const uint64 StartCycles = ProfilingGraph ? FPlatformTime::Cycles64() : 0;
+	const FActorRepListRefView* OwnedActors = ActorsByConnection.Find(Params.ConnectionManager.NetConnection);
+	if (OwnedActors && OwnedActors->Num() > 0) Params.OutGatheredReplicationLists.AddReplicationActorList(*OwnedActors);
+	if (ProfilingGraph) ProfilingGraph->AddProfileGatherCycles(FPlatformTime::Cycles64() - StartCycles);
+}
+#pragma endregion
+
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Always Relevant For Connection Node																																						 //
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#pragma region Always Relevant For Connection
+void USandboxReplicationGraphNode_AlwaysRelevant_ForConnection::GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params)
+{
+	USandboxReplicationGraph* ProfilingGraph = GetProfilingGraph(GraphGlobals);
+	const uint64 StartCycles = ProfilingGraph ? FPlatformTime::Cycles64() : 0;
+	ReplicationActorList.Reset();
+
+	// The viewers are the connection's player controller (and split screen children)
+	for (const FNetViewer& Viewer : Params.Viewers)
+	{
+		ReplicationActorList.ConditionalAdd(Viewer.InViewer);
+		ReplicationActorList.ConditionalAdd(Viewer.ViewTarget);
+
+		if (APlayerController* PlayerController = Cast<APlayerController>(Viewer.InViewer))
+		{
+			ReplicationActorList.ConditionalAdd(PlayerController->PlayerState);
+			ReplicationActorList.ConditionalAdd(PlayerController->GetPawn()); // The ability system component replicates with the pawn
+		}
+	}
+
+	Params.OutGatheredReplicationLists.AddReplicationActorList(ReplicationActorList);
+	if (ProfilingGraph) ProfilingGraph->AddProfileGatherCycles(FPlatformTime::Cycles64() - StartCycles);
+}
+#pragma endregion
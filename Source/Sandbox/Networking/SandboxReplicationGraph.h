@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "ReplicationGraph.h"
+#include "SandboxReplicationGraph.generated.h"
+
+
+/*
+	Replication graph for the sandbox
+
+	Instead of the net driver checking every actor against every connection each net tick, actors are routed into nodes once and each connection gathers only the nodes around it:
+		- A 2D spatial grid for everything that has a location (characters, projectiles, props, etc.)
+		- An always relevant list for the game state and any other bAlwaysRelevant actors
+		- A per connection list for the connection's own player controller, player state and pawn (the ability system component replicates with the pawn)
+		- An owner only list for the other bOnlyRelevantToOwner actors (weapons, inventory, etc.), bucketed by their owning connection once per frame
+
+	Bhop characters move fast enough to cross several grid cells between net updates, so the grid keeps a list of them and spreads them over more cells (a larger cull distance) and
+	replicates them more often the faster they're going. The values come from the character's net policy (see BhopNetPolicy.h), so both replication paths behave the same.
+	The graph doesn't call AActor::GetNetPriority, so the policy's approach priority is turned into the actor's priority bias instead (the graph sorts lower values first). The cull distance
+	is rounded up to FastMoverCullDistanceStep and only pushed to the connections when that step or the update rate changes.
+
+	This is enabled with ReplicationDriverClassName in DefaultEngine.ini. Clearing it goes back to the legacy net driver relevancy for comparisons.
+	"stat Bhop" shows the time spent updating the fast movers, and the engine's "stat Net" / insights net traces show the overall server replication time.
+
+	"Sandbox.RepGraph.Profile [Frames]" records the graph's cost per connection for the next frames and writes Saved/Profiling/Bhop/RepGraph_<Connections>Connections.csv:
+		- Prepare, the nodes' once a frame work (the fast movers and the owner only buckets), per frame
+		- Gather, our nodes building each connection's lists (the grid cells, the owner only and per connection lists), per connection
+		- Prioritize and send, the rest of ServerReplicateActors (the engine prioritizing the gathered actors and replicating them), per connection
+	For the 64 and 128 connection numbers, run a dedicated server and connect that many headless clients to it, then spawn bots so the characters move:
+		SandboxServer <Map> -log
+		for i in $(seq 64); do UnrealEditor-Cmd Sandbox.uproject 127.0.0.1 -game -nullrhi -nosound -unattended & done
+		Sandbox.Bots.Spawn 64, then Sandbox.RepGraph.Profile 600 (on the server, or with -ExecCmds)
+*/
+
+
+/** Routing for each replicated class */
+enum class ESandboxRepRoute : uint8
+{
+	NotRouted,				// Handled by the per connection node (player controllers)
+	RelevantToOwner,		// Only replicated to the connection that owns it (bOnlyRelevantToOwner)
+	AlwaysRelevant,			// Replicated to every connection
+	Spatialize_Static,		// Doesn't move, added to the grid once
+	Spatialize_Dynamic,		// Moves, the grid updates its cells every frame
+	Spatialize_Dormancy,	// Moves, but is treated as static while it's dormant
+};
+
+
+/** A bhop character in the grid, and the values we last gave the connections for it */
+USTRUCT()
+struct FSandboxBhopGridEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+		class ABhopCharacter* Character = nullptr;
+
+	float CullDistanceSquared = -1.f;
+	uint32 ReplicationPeriodFrame = 0;
+};
+
+
+/**
+ * Grid node that also widens the cells and update rate of the bhop characters based on their speed
+ */
+UCLASS()
+class SANDBOX_API USandboxReplicationGraphNode_BhopGrid : public UReplicationGraphNode_GridSpatialization2D
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+	void AddBhopCharacter(class ABhopCharacter* Character);
+	void RemoveBhopCharacter(class ABhopCharacter* Character);
+	int32 GetNumBhopCharacters() const { return BhopCharacters.Num(); }
+
+
+private:
+	/** Updates each character's priority bias from the closest viewers */
+	void UpdatePriorityBias(class USandboxReplicationGraph* ReplicationGraph, FGlobalActorReplicationInfoMap& GlobalInfoMap);
+
+	/** The bhop characters in the grid (these are also added as dynamic actors) */
+	UPROPERTY()
+		TArray<FSandboxBhopGridEntry> BhopCharacters;
+
+	/** Every connection's view location and direction, gathered once per frame */
+	TArray<FNetViewer> Viewers;
+};
+
+
+/**
+ * The bOnlyRelevantToOwner actors, each connection only gathers the ones it owns
+ */
+UCLASS()
+class SANDBOX_API USandboxReplicationGraphNode_OwnerOnly : public UReplicationGraphNode
+{
+	GENERATED_BODY()
+
+
+public:
+	USandboxReplicationGraphNode_OwnerOnly();
+
+	virtual void NotifyAddNetworkActor(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual bool NotifyRemoveNetworkActor(const FNewReplicatedActorInfo& ActorInfo, bool bWarnIfNotFound = true) override;
+	virtual void NotifyResetAllNetworkActors() override;
+	virtual void PrepareForReplication() override;
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+
+
+private:
+	/** Every owner only actor */
+	FActorRepListRefView Actors;
+
+	/** The actors grouped by their owning connection, rebuilt each frame since the owner can change at any time (picking up a weapon) */
+	TMap<UNetConnection*, FActorRepListRefView> ActorsByConnection;
+};
+
+
+/**
+ * The actors that are always relevant to a connection, it's own controller, player state, and pawn
+ */
+UCLASS()
+class SANDBOX_API USandboxReplicationGraphNode_AlwaysRelevant_ForConnection : public UReplicationGraphNode_AlwaysRelevant_ForConnection
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual void GatherActorListsForConnection(const FConnectionGatherActorListParameters& Params) override;
+};
+
+
+/**
+ *
+ */
+UCLASS(transient, config = Engine)
+class SANDBOX_API USandboxReplicationGraph : public UReplicationGraph
+{
+	GENERATED_BODY()
+
+
+public:
+	USandboxReplicationGraph();
+
+	virtual void InitGlobalActorClassSettings() override;
+	virtual void InitGlobalGraphNodes() override;
+	virtual void InitConnectionGraphNodes(UNetReplicationGraphConnection* RepGraphConnection) override;
+	virtual void RouteAddNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo, FGlobalActorReplicationInfo& GlobalInfo) override;
+	virtual void RouteRemoveNetworkActorToNodes(const FNewReplicatedActorInfo& ActorInfo) override;
+	virtual int32 ServerReplicateActors(float DeltaSeconds) override;
+
+	/** The number of frames between replications for the given update frequency */
+	uint32 GetReplicationPeriodFrame(float UpdateFrequency) const;
+
+	/** Records the cost per connection for the next NumFrames replication frames, then logs it and writes the csv (Sandbox.RepGraph.Profile) */
+	void StartProfile(int32 NumFrames);
+	bool IsProfiling() const { return ProfileFramesLeft > 0; }
+
+	// Our nodes add their time while we're profiling
+	void AddProfilePrepareCycles(uint64 Cycles) { ProfilePrepareCycles += Cycles; }
+	void AddProfileGatherCycles(uint64 Cycles) { ProfileGatherCycles += Cycles; }
+
+
+	UPROPERTY()
+		USandboxReplicationGraphNode_BhopGrid* GridNode;
+	UPROPERTY()
+		UReplicationGraphNode_ActorList* AlwaysRelevantNode;
+	UPROPERTY()
+		USandboxReplicationGraphNode_OwnerOnly* OwnerOnlyNode;
+
+	// Grid configuration ([/Script/Sandbox.SandboxReplicationGraph] in DefaultEngine.ini)
+	UPROPERTY(config) // The size of each grid cell, this should be a bit bigger than the average cull distance
+		float GridCellSize = 10000.f;
+	UPROPERTY(config) // The grid starts at this location, anything further out is clamped into the outer cells
+		FVector2D SpatialBias = FVector2D(-150000.f, -150000.f);
+	UPROPERTY(config) // The bhop characters' cull distance is rounded up to this, so the connections are only updated when it crosses a step
+		float FastMoverCullDistanceStep = 1000.f;
+
+
+private:
+	ESandboxRepRoute GetRoute(UClass* Class);
+	void FinishProfile();
+
+	/** The route of each class we've seen, so the add and remove always agree */
+	TMap<UClass*, ESandboxRepRoute> ClassRoutes;
+
+	// Profile (Sandbox.RepGraph.Profile)
+	int32 ProfileFramesLeft = 0;
+	int32 ProfileFrames = 0;
+	int64 ProfileConnectionFrames = 0;
+	uint64 ProfilePrepareCycles = 0;
+	uint64 ProfileGatherCycles = 0;
+	uint64 ProfileTotalCycles = 0;
+	int32 ProfileMaxConnections = 0;
+	TArray<float> ProfileConnectionMicroseconds; // Each frame's total divided by its connections, for the percentiles
+};
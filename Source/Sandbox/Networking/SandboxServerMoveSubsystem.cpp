@@ -0,0 +1,465 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxServerMoveSubsystem.h"
+#include "Algo/BinarySearch.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "HAL/IConsoleManager.h"
+#include "Engine/World.h"
+#include "Math/RandomStream.h"
+
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Networking/SandboxNetStats.h"
+#include "Sandbox/SandboxMemory.h"
+
+
+DECLARE_CYCLE_STAT(TEXT("Server Move Prepare"), STAT_SandboxNet_ServerMovePrepare, STATGROUP_SandboxNet);
+DECLARE_CYCLE_STAT(TEXT("Server Move Apply"), STAT_SandboxNet_ServerMoveApply, STATGROUP_SandboxNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Queued Server Moves"), STAT_SandboxNet_QueuedServerMoves, STATGROUP_SandboxNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Jitter Buffer Max Depth"), STAT_SandboxNet_JitterBufferMaxDepth, STATGROUP_SandboxNet);
+DECLARE_FLOAT_COUNTER_STAT(TEXT("Jitter Buffer Max Delay (ms)"), STAT_SandboxNet_JitterBufferMaxDelay, STATGROUP_SandboxNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Dropped Server Moves"), STAT_SandboxNet_DroppedServerMoves, STATGROUP_SandboxNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Merged Server Moves"), STAT_SandboxNet_MergedServerMoves, STATGROUP_SandboxNet);
+
+
+#pragma region Console
+static int32 GSandboxBatchServerMoves = 0;
+static FAutoConsoleVariableRef CVarSandboxBatchServerMoves(
+	TEXT("Sandbox.ServerMoves.Batch"),
+	GSandboxBatchServerMoves,
+	TEXT("Queues the bhop server moves, prepares them on the task graph and performs them once a frame in a fixed order. 0: off (the moves are performed as they're received), 1: on"),
+	ECVF_Default
+);
+
+static int32 GSandboxServerMoveWorkers = 0;
+static FAutoConsoleVariableRef CVarSandboxServerMoveWorkers(
+	TEXT("Sandbox.ServerMoves.Workers"),
+	GSandboxServerMoveWorkers,
+	TEXT("The number of chunks the server move prepare phase is split into. 0: one per task graph worker plus the game thread, 1: the game thread only"),
+	ECVF_Default
+);
+
+static int32 GSandboxServerMoveJitterBuffer = 0;
+static FAutoConsoleVariableRef CVarSandboxServerMoveJitterBuffer(
+	TEXT("Sandbox.ServerMoves.JitterBuffer"),
+	GSandboxServerMoveJitterBuffer,
+	TEXT("Meters the queued bhop server moves into the server frames by their time stamps, so bursts of moves are spread out. 0: off, 1: on"),
+	ECVF_Default
+);
+
+static float GSandboxServerMoveJitterMaxDelay = 0.05f;
+static FAutoConsoleVariableRef CVarSandboxServerMoveJitterMaxDelay(
+	TEXT("Sandbox.ServerMoves.JitterMaxDelay"),
+	GSandboxServerMoveJitterMaxDelay,
+	TEXT("The longest (in seconds) a move is held in the jitter buffer behind the newest move from the same client"),
+	ECVF_Default
+);
+
+static float GSandboxServerMoveJitterDelayScale = 2.f;
+static FAutoConsoleVariableRef CVarSandboxServerMoveJitterDelayScale(
+	TEXT("Sandbox.ServerMoves.JitterDelayScale"),
+	GSandboxServerMoveJitterDelayScale,
+	TEXT("The jitter buffer delay is the measured arrival jitter of the client's moves times this (up to JitterMaxDelay)"),
+	ECVF_Default
+);
+
+static int32 GSandboxServerMoveJitterMaxMoves = 12;
+static FAutoConsoleVariableRef CVarSandboxServerMoveJitterMaxMoves(
+	TEXT("Sandbox.ServerMoves.JitterMaxMoves"),
+	GSandboxServerMoveJitterMaxMoves,
+	TEXT("Once a client has this many moves waiting, new moves are merged into the previous one when they have the same flags and input"),
+	ECVF_Default
+);
+#pragma endregion
+
+
+#pragma region Prepare
+namespace SandboxServerMoves
+{
+	bool IsBatchEnabled()
+	{
+		return GSandboxBatchServerMoves != 0;
+	}
+
+
+	bool IsJitterBufferEnabled()
+	{
+		return GSandboxServerMoveJitterBuffer != 0;
+	}
+
+
+	bool ShouldQueueMoves()
+	{
+		return IsBatchEnabled() || IsJitterBufferEnabled();
+	}
+
+
+	int32 GetNumWorkers()
+	{
+		const int32 MaxWorkers = FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		return GSandboxServerMoveWorkers > 0 ? FMath::Min(GSandboxServerMoveWorkers, MaxWorkers) : MaxWorkers;
+	}
+
+
+	// Whether the new move can be folded into the last queued one without losing any input (see FSavedMove_Character::CanCombineWith)
+	static bool CanMergeMoves(const FServerMoveQueue& Queue, const FQueuedServerMove& PrevMove, const FQueuedServerMove& NewMove)
+	{
+		const UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData& PrevData = PrevMove.MoveData;
+		const UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData& MoveData = NewMove.MoveData;
+
+		// The same thresholds as FSavedMove_Character::CanCombineWith
+		static constexpr float AccelDotThreshold = 0.996f;
+		static constexpr float AccelMagThreshold = 1.f;
+
+		// The merged move is performed as a single step, so it has to fit in one (the server clamps longer moves and the time would be lost)
+		if (PrevMove.DeltaTime + NewMove.DeltaTime >= Queue.MaxMoveDeltaTime) return false;
+
+		// Input and state
+		if (PrevData.CompressedMoveFlags != MoveData.CompressedMoveFlags) return false;
+		if (PrevData.MovementInput != MoveData.MovementInput) return false;
+		if (PrevData.MovementMode != MoveData.MovementMode) return false;
+
+		// Acceleration (both zero, or the same direction and size)
+		if (PrevData.Acceleration.IsZero() != MoveData.Acceleration.IsZero()) return false;
+		if (!PrevData.Acceleration.IsZero())
+		{
+			if (!FVector::Coincident(PrevData.Acceleration.GetSafeNormal(), MoveData.Acceleration.GetSafeNormal(), AccelDotThreshold)) return false;
+			if (!FMath::IsNearlyEqual(PrevData.Acceleration.Size(), MoveData.Acceleration.Size(), AccelMagThreshold)) return false;
+		}
+
+		// The strafe acceleration is relative to where we're looking
+		if (!PrevData.ControlRotation.Equals(MoveData.ControlRotation, KINDA_SMALL_NUMBER)) return false;
+
+		// Movement base
+		if (PrevData.MovementBase != MoveData.MovementBase || PrevData.MovementBaseBoneName != MoveData.MovementBaseBoneName) return false;
+
+		return true;
+	}
+
+
+	// Advances the queue's playback time stamp and returns the number of moves that are due
+	static int32 MeterQueue(FServerMoveQueue& Queue, float DeltaTime)
+	{
+		if (Queue.Moves.Num() == 0) return 0;
+
+		const float MaxDelay = FMath::Max(GSandboxServerMoveJitterMaxDelay, 0.f);
+		Queue.TargetDelay = FMath::Clamp(Queue.Jitter * GSandboxServerMoveJitterDelayScale, 0.f, MaxDelay);
+		const float NewestTimeStamp = Queue.Moves.Last().MoveData.TimeStamp;
+		const float TargetTimeStamp = NewestTimeStamp - Queue.TargetDelay;
+
+		if (!Queue.bPlaybackStarted)
+		{
+			// Start (or restart after a time stamp reset) the delay behind the newest move
+			Queue.bPlaybackStarted = true;
+			Queue.PlaybackTimeStamp = TargetTimeStamp;
+		}
+		else
+		{
+			// Play the client's time back at our frame rate, and slowly drift towards the target delay
+			Queue.PlaybackTimeStamp += DeltaTime;
+			Queue.PlaybackTimeStamp += (TargetTimeStamp - Queue.PlaybackTimeStamp) * 0.1f;
+		}
+
+		// Never hold a move longer than the max delay, and don't run ahead of the moves we have (a burst after a gap would all be due at once)
+		Queue.PlaybackTimeStamp = FMath::Clamp(Queue.PlaybackTimeStamp, NewestTimeStamp - MaxDelay, NewestTimeStamp);
+
+		// A time stamp reset puts smaller time stamps behind the old ones, everything before the reset is due
+		int32 NumReady = 0;
+		while (NumReady < Queue.Moves.Num())
+		{
+			const float TimeStamp = Queue.Moves[NumReady].MoveData.TimeStamp;
+			const bool bBeforeReset = TimeStamp > NewestTimeStamp + Queue.MinTimeBetweenTimeStampResets * 0.5f;
+			if (TimeStamp > Queue.PlaybackTimeStamp && !bBeforeReset) break;
+			NumReady++;
+		}
+
+		return NumReady;
+	}
+
+
+	// Checks the received moves against the queue, then merges and meters them. Only touches the queue, so the queues can be prepared on any thread
+	static void PrepareQueue(FServerMoveQueue& Queue, float DeltaTime, bool bJitterBuffer)
+	{
+		Queue.NumDropped = 0;
+		Queue.NumMerged = 0;
+		for (FQueuedServerMove& Received : Queue.Received)
+		{
+			// Old and pending moves are resent with the next one, anything we've already got is a duplicate (unless the client reset its time stamps)
+			const float TimeStamp = Received.MoveData.TimeStamp;
+			const bool bTimeStampReset = Queue.LastTimeStamp - TimeStamp > Queue.MinTimeBetweenTimeStampResets * 0.5f;
+			if (TimeStamp <= Queue.LastTimeStamp && !bTimeStampReset)
+			{
+				Queue.NumDropped++;
+				continue;
+			}
+			if (bTimeStampReset) Queue.bPlaybackStarted = false;
+			Received.DeltaTime = bTimeStampReset ? 0.f : TimeStamp - Queue.LastTimeStamp;
+			Queue.LastTimeStamp = TimeStamp;
+
+			// A deep queue merges the new move into the previous one if that doesn't lose any input, the new move's time stamp covers both
+			const bool bMerge = bJitterBuffer && !bTimeStampReset && Queue.Moves.Num() > 0 && Queue.Moves.Num() >= GSandboxServerMoveJitterMaxMoves
+				&& CanMergeMoves(Queue, Queue.Moves.Last(), Received);
+			if (bMerge)
+			{
+				FQueuedServerMove& Move = Queue.Moves.Last();
+				Move.MoveData = Received.MoveData;
+				Move.DeltaTime += Received.DeltaTime;
+				Queue.NumMerged++;
+				continue;
+			}
+
+			Queue.Moves.Add(Received);
+		}
+		Queue.Received.Reset();
+
+		// Find the moves that are due this frame
+		if (bJitterBuffer)
+		{
+			Queue.NumReady = MeterQueue(Queue, DeltaTime);
+		}
+		else
+		{
+			Queue.NumReady = Queue.Moves.Num();
+			Queue.bPlaybackStarted = false;
+		}
+	}
+
+
+	void PrepareQueues(TArrayView<FServerMoveQueue> Queues, float DeltaTime, bool bJitterBuffer, int32 NumWorkers)
+	{
+		// One contiguous chunk per worker, so there are never more than NumWorkers threads preparing. Every queue only depends on itself, so the chunks don't change the results
+		const int32 NumChunks = FMath::Clamp(NumWorkers, 1, FMath::Max(Queues.Num(), 1));
+		const int32 ChunkSize = FMath::DivideAndRoundUp(Queues.Num(), NumChunks);
+		ParallelFor(NumChunks, [&Queues, ChunkSize, DeltaTime, bJitterBuffer](int32 Chunk)
+		{
+			const int32 End = FMath::Min((Chunk + 1) * ChunkSize, Queues.Num());
+			for (int32 Index = Chunk * ChunkSize; Index < End; Index++)
+			{
+				PrepareQueue(Queues[Index], DeltaTime, bJitterBuffer);
+			}
+		}, NumChunks == 1 ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None);
+	}
+}
+#pragma endregion
+
+
+#pragma region Subsystem
+bool USandboxServerMoveSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	// Clients don't receive server moves, but the net mode isn't known yet when a listen server's world is created
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+void USandboxServerMoveSubsystem::Deinitialize()
+{
+	Queues.Empty();
+	NumQueuedMoves = 0;
+	Super::Deinitialize();
+}
+
+
+void USandboxServerMoveSubsystem::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+	FlushMoves(DeltaTime);
+}
+
+
+bool USandboxServerMoveSubsystem::IsTickable() const
+{
+	return NumQueuedMoves > 0;
+}
+
+
+TStatId USandboxServerMoveSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(USandboxServerMoveSubsystem, STATGROUP_Tickables);
+}
+
+
+void USandboxServerMoveSubsystem::OnMovePacketReceived(UBhopCharacterMovementComponent* Movement, float NewestTimeStamp)
+{
+	if (!Movement || !Cast<ABhopCharacter>(Movement->GetCharacterOwner())) return;
+	FServerMoveQueue& Queue = FindOrAddQueue(Movement);
+
+	// Measure how much the arrival times of the packets drift from their time stamps for the jitter buffer delay
+	const bool bTimeStampReset = Queue.LastPacketTimeStamp - NewestTimeStamp > Queue.MinTimeBetweenTimeStampResets * 0.5f;
+	const double ArrivalTime = FPlatformTime::Seconds();
+	if (Queue.LastArrivalTime > 0.0 && !bTimeStampReset && NewestTimeStamp > Queue.LastPacketTimeStamp)
+	{
+		const float Drift = static_cast<float>(ArrivalTime - Queue.LastArrivalTime) - (NewestTimeStamp - Queue.LastPacketTimeStamp);
+		Queue.Jitter += (FMath::Abs(Drift) - Queue.Jitter) / 16.f;
+	}
+
+	// Out of order packets don't move the reference forward
+	if (NewestTimeStamp > Queue.LastPacketTimeStamp || bTimeStampReset)
+	{
+		Queue.LastArrivalTime = ArrivalTime;
+		Queue.LastPacketTimeStamp = NewestTimeStamp;
+	}
+}
+
+
+void USandboxServerMoveSubsystem::QueueMove(UBhopCharacterMovementComponent* Movement, const UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData& MoveData)
+{
+	LLM_SCOPE_BYTAG(Sandbox_Movement);
+	if (!Movement || !Cast<ABhopCharacter>(Movement->GetCharacterOwner())) return;
+
+	// The duplicates are dropped when the queue is prepared
+	FServerMoveQueue& Queue = FindOrAddQueue(Movement);
+	Queue.Received.AddDefaulted_GetRef().MoveData = MoveData;
+	NumQueuedMoves++;
+}
+
+
+void USandboxServerMoveSubsystem::FlushMoves(float DeltaTime)
+{
+	if (NumQueuedMoves == 0) return;
+	SET_DWORD_STAT(STAT_SandboxNet_QueuedServerMoves, NumQueuedMoves);
+
+	// Check, merge and meter the moves on the task graph
+	const bool bJitterBuffer = SandboxServerMoves::IsJitterBufferEnabled();
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SandboxNet_ServerMovePrepare);
+		SandboxServerMoves::PrepareQueues(Queues, DeltaTime, bJitterBuffer, SandboxServerMoves::GetNumWorkers());
+	}
+
+	int32 MaxDepth = 0;
+	float MaxDelay = 0.f;
+	int32 NumDropped = 0;
+	int32 NumMerged = 0;
+	NumQueuedMoves = 0;
+	for (const FServerMoveQueue& Queue : Queues)
+	{
+		MaxDepth = FMath::Max(MaxDepth, Queue.Moves.Num());
+		if (bJitterBuffer) MaxDelay = FMath::Max(MaxDelay, Queue.TargetDelay);
+		NumDropped += Queue.NumDropped;
+		NumMerged += Queue.NumMerged;
+		NumQueuedMoves += Queue.Moves.Num();
+	}
+	SET_DWORD_STAT(STAT_SandboxNet_JitterBufferMaxDepth, MaxDepth);
+	SET_FLOAT_STAT(STAT_SandboxNet_JitterBufferMaxDelay, MaxDelay * 1000.f);
+	INC_DWORD_STAT_BY(STAT_SandboxNet_DroppedServerMoves, NumDropped);
+	INC_DWORD_STAT_BY(STAT_SandboxNet_MergedServerMoves, NumMerged);
+
+	// Then perform them on the game thread, in character order and then the order they arrived
+	{
+		SCOPE_CYCLE_COUNTER(STAT_SandboxNet_ServerMoveApply);
+		for (FServerMoveQueue& Queue : Queues)
+		{
+			UBhopCharacterMovementComponent* Movement = Queue.Movement.Get();
+			for (int32 Index = 0; Index < Queue.NumReady && IsValid(Movement); Index++)
+			{
+				Movement->PerformQueuedServerMove(Queue.Moves[Index].MoveData);
+			}
+
+			Queue.Moves.RemoveAt(0, Queue.NumReady, false);
+			NumQueuedMoves -= Queue.NumReady;
+			Queue.NumReady = 0;
+		}
+	}
+
+	// Forget the characters that are gone
+	for (const FServerMoveQueue& Queue : Queues)
+	{
+		if (!Queue.Movement.IsValid()) NumQueuedMoves -= Queue.Moves.Num();
+	}
+	Queues.RemoveAll([](const FServerMoveQueue& Queue) { return !Queue.Movement.IsValid(); });
+}
+
+
+FServerMoveQueue& USandboxServerMoveSubsystem::FindOrAddQueue(UBhopCharacterMovementComponent* Movement)
+{
+	const uint32 SortKey = Movement->GetUniqueID();
+	const int32 Index = Algo::LowerBoundBy(Queues, SortKey, &FServerMoveQueue::SortKey);
+	if (Queues.IsValidIndex(Index) && Queues[Index].SortKey == SortKey && Queues[Index].Movement.Get() == Movement) return Queues[Index];
+
+	// First move from this character, anything at or before the last move the movement component processed is a duplicate
+	FServerMoveQueue& Queue = Queues.InsertDefaulted_GetRef(Index);
+	Queue.Movement = Movement;
+	Queue.SortKey = SortKey;
+	if (const FNetworkPredictionData_Server_Character* ServerData = Movement->GetPredictionData_Server_Character())
+	{
+		Queue.LastTimeStamp = ServerData->CurrentClientTimeStamp;
+		Queue.LastPacketTimeStamp = ServerData->CurrentClientTimeStamp;
+		Queue.MaxMoveDeltaTime = ServerData->MaxMoveDeltaTime;
+	}
+	Queue.MinTimeBetweenTimeStampResets = Movement->MinTimeBetweenTimeStampResets;
+	return Queue;
+}
+#pragma endregion
+
+
+#pragma region Benchmark
+static FAutoConsoleCommand ServerMoveBenchmarkCommand(
+	TEXT("Sandbox.ServerMoves.Benchmark"),
+	TEXT("Times the server move prepare phase with 1 to N workers on synthetic queues. Usage: Sandbox.ServerMoves.Benchmark [Characters=128] [Packets=4] [Iterations=200] [MaxWorkers=task graph workers + 1]"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 NumCharacters = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 128;
+		const int32 NumPackets = Args.Num() > 1 ? FMath::Max(FCString::Atoi(*Args[1]), 1) : 4;
+		const int32 Iterations = Args.Num() > 2 ? FMath::Max(FCString::Atoi(*Args[2]), 1) : 200;
+		const int32 MaxWorkers = Args.Num() > 3 ? FMath::Max(FCString::Atoi(*Args[3]), 1) : FTaskGraphInterface::Get().GetNumWorkerThreads() + 1;
+		const bool bJitterBuffer = SandboxServerMoves::IsJitterBufferEnabled();
+
+		// Every packet resends the previous new move as the old move with the new one, like ServerMovePacked does, so half of the moves are duplicates
+		FRandomStream Stream(1337);
+		TArray<FServerMoveQueue> Source;
+		Source.SetNum(NumCharacters);
+		for (FServerMoveQueue& Queue : Source)
+		{
+			float TimeStamp = Stream.FRandRange(1.f, 100.f);
+			Queue.LastTimeStamp = TimeStamp;
+			for (int32 Packet = 0; Packet < NumPackets; Packet++)
+			{
+				if (Queue.Received.Num() > 0)
+				{
+					const FQueuedServerMove OldMove = Queue.Received.Last();
+					Queue.Received.Add(OldMove);
+				}
+
+				TimeStamp += Stream.FRandRange(1.f / 120.f, 1.f / 30.f);
+				FQueuedServerMove& Move = Queue.Received.AddDefaulted_GetRef();
+				Move.MoveData.TimeStamp = TimeStamp;
+				Move.MoveData.Acceleration = FVector(Stream.GetUnitVector().GetSafeNormal2D() * 2048.f);
+				Move.MoveData.ControlRotation = FRotator(0.f, Stream.FRandRange(-180.f, 180.f), 0.f);
+			}
+		}
+
+		// The one worker results are the reference, every other split has to match them
+		TArray<FServerMoveQueue> Queues;
+		TArray<FServerMoveQueue> Reference;
+		double SingleMs = 0.0;
+		for (int32 NumWorkers = 1; NumWorkers <= MaxWorkers; NumWorkers++)
+		{
+			uint64 Cycles = 0;
+			for (int32 Iteration = 0; Iteration < Iterations; Iteration++)
+			{
+				Queues = Source;
+				const uint64 StartCycles = FPlatformTime::Cycles64();
+				SandboxServerMoves::PrepareQueues(Queues, 1.f / 60.f, bJitterBuffer, NumWorkers);
+				Cycles += FPlatformTime::Cycles64() - StartCycles;
+			}
+
+			int32 NumMismatches = 0;
+			if (NumWorkers == 1) Reference = Queues;
+			for (int32 Index = 0; Index < Queues.Num(); Index++)
+			{
+				const FServerMoveQueue& Queue = Queues[Index];
+				const FServerMoveQueue& Expected = Reference[Index];
+				const bool bSame = Queue.NumReady == Expected.NumReady && Queue.NumDropped == Expected.NumDropped && Queue.NumMerged == Expected.NumMerged
+					&& Queue.Moves.Num() == Expected.Moves.Num() && Queue.LastTimeStamp == Expected.LastTimeStamp;
+				if (!bSame) NumMismatches++;
+			}
+
+			const double Ms = FPlatformTime::ToMilliseconds64(Cycles) / Iterations;
+			if (NumWorkers == 1) SingleMs = Ms;
+			UE_LOG(LogTemp, Log, TEXT("Sandbox.ServerMoves.Benchmark: %d characters, %d moves received each, %d workers. %.4f ms per frame (%.2fx), %d queues differ from one worker"),
+				NumCharacters, Source[0].Received.Num(), NumWorkers, Ms, Ms > 0.0 ? SingleMs / Ms : 0.0, NumMismatches);
+		}
+	})
+);
+#pragma endregion
@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacterMovementComponent.h"
+#include "SandboxServerMoveSubsystem.generated.h"
+
+
+/*
+	Batched server moves
+
+	Normally every ServerMove rpc runs MoveAutonomous and PerformMovement on the game thread the moment it's received, one connection after the other.
+	With Sandbox.ServerMoves.Batch 1 (or the jitter buffer below) the bhop movement component queues the decoded moves here instead (one queue per character, which is one per connection),
+	and they're processed once per frame in two phases:
+
+	Prepare (task graph)
+	Every character's queue is independent, so the queues are split into Sandbox.ServerMoves.Workers chunks and prepared with a ParallelFor. This only touches the queue's own data, never the character.
+	The moves received since the last frame are checked against the ones already queued: old and pending moves are resent with every new one, so anything with a time stamp we've already queued
+	or performed is dropped (the movement component would reject it anyway, after going through the rpc handling for it). Then the jitter buffer merges and meters them (see below).
+
+	Commit (game thread)
+	PerformMovement sweeps, moves components, fires overlaps and hits, and updates physics, none of which is safe off the game thread, and each move starts from the velocity the previous one left behind.
+	So the moves that are due are performed serially through the movement component's normal ServerMove_PerformMovement, the characters always in the same order (by their unique id)
+	and each character's moves in the order they arrived. The prepare phase doesn't depend on how the queues were split, so the results are the same for any number of workers.
+
+	The move's values that drive the server's simulation are already checked by the engine on both paths: the acceleration is quantized and clamped to the max acceleration in MoveAutonomous,
+	the time stamp is verified and the delta time clamped to MaxMoveDeltaTime, and the location is only used for the client error check. The bhop values in the move (max walk speed, friction and
+	jump velocity) are only bookkeeping on the server, so the queue doesn't validate anything else.
+	"Sandbox.ServerMoves.Benchmark" times the prepare phase with 1 to N workers on synthetic queues.
+
+	Jitter buffer
+	When a client hitches (or is on wifi) its moves show up in bursts, so the server performs a handful of moves in one frame and then none for a while, which spikes the frame and causes corrections.
+	With Sandbox.ServerMoves.JitterBuffer 1 the same queues also meter the moves out by their time stamps. Each queue plays back the client's time stamps at the server's frame rate,
+	a little behind the newest move it has received. That delay adapts to how much the arrival times of the moves jitter, and is never longer than Sandbox.ServerMoves.JitterMaxDelay.
+	The jitter is measured once per ServerMovePacked rpc (the old, pending and new moves in it all arrive together), from the newest move's time stamp.
+	If a queue is still too deep, a new move is merged into the previous one when the client would have combined them (FSavedMove_Character::CanCombineWith): the same flags, input,
+	acceleration, control rotation and movement base, and their summed delta time fits in one move. The server's delta time comes from the time stamps, so the new move covers both.
+
+	The queue is flushed from the world tick, which is after the net driver has received the frame's rpcs and before it replicates, so the client adjustments still go out in the same frame.
+	"stat SandboxNet" shows the prepare and apply times, the number of moves, the queue depth and the dropped and merged moves.
+*/
+
+
+/** A move waiting to be performed */
+struct FQueuedServerMove
+{
+	UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData MoveData;
+	float DeltaTime = 0.f; // The time since the previous queued move (the sum of both if they were merged)
+};
+
+
+/** The moves of a single character in the order they were received */
+struct FServerMoveQueue
+{
+	TWeakObjectPtr<UBhopCharacterMovementComponent> Movement;
+	uint32 SortKey = 0;
+	float LastTimeStamp = 0.f; // The time stamp of the newest queued move
+	float MaxMoveDeltaTime = 0.125f;
+	float MinTimeBetweenTimeStampResets = 240.f;
+
+	// Jitter buffer
+	bool bPlaybackStarted = false;
+	float PlaybackTimeStamp = 0.f; // Moves up to this time stamp are performed this frame
+	float TargetDelay = 0.f; // How far behind the newest move the playback tries to stay
+	float Jitter = 0.f; // Smoothed difference between the time the packets arrived and their time stamps
+	double LastArrivalTime = 0.0;
+	float LastPacketTimeStamp = 0.f; // The time stamp of the newest move in the last packet
+
+	// Written by the prepare phase for the commit
+	int32 NumReady = 0; // The moves that are performed this frame (the front of the queue)
+	int32 NumDropped = 0;
+	int32 NumMerged = 0;
+
+	TArray<FQueuedServerMove> Received; // Received since the last flush, not checked yet
+	TArray<FQueuedServerMove> Moves;
+};
+
+
+namespace SandboxServerMoves
+{
+	/** Whether the moves should be performed once a frame in a fixed order (Sandbox.ServerMoves.Batch) */
+	SANDBOX_API bool IsBatchEnabled();
+
+	/** Whether the moves should be metered out by their time stamps (Sandbox.ServerMoves.JitterBuffer) */
+	SANDBOX_API bool IsJitterBufferEnabled();
+
+	/** The moves are queued on the subsystem if either of the above are on */
+	SANDBOX_API bool ShouldQueueMoves();
+
+	/** The number of chunks the prepare phase is split into (Sandbox.ServerMoves.Workers, 0 is one per task graph worker plus the game thread) */
+	SANDBOX_API int32 GetNumWorkers();
+
+	/** Drops the stale moves, then merges and meters the rest, for every queue. Each chunk of queues is prepared on its own worker */
+	SANDBOX_API void PrepareQueues(TArrayView<FServerMoveQueue> Queues, float DeltaTime, bool bJitterBuffer, int32 NumWorkers);
+}
+
+
+/**
+ * Queues the server moves of the bhop characters and processes them once a frame (see above)
+ */
+UCLASS()
+class SANDBOX_API USandboxServerMoveSubsystem : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual TStatId GetStatId() const override;
+
+	/** Measures the arrival jitter of a ServerMovePacked rpc from the character, before its moves are queued */
+	void OnMovePacketReceived(UBhopCharacterMovementComponent* Movement, float NewestTimeStamp);
+
+	/** Copies the move into the character's queue, it's checked and performed later in the frame */
+	void QueueMove(UBhopCharacterMovementComponent* Movement, const UBhopCharacterMovementComponent::FBhopCharacterNetworkMoveData& MoveData);
+
+	/** Prepares the queues on the task graph, then performs the moves that are due this frame on the game thread (every move if the jitter buffer is off) */
+	void FlushMoves(float DeltaTime);
+
+	int32 GetNumQueuedMoves() const { return NumQueuedMoves; }
+
+
+private:
+	FServerMoveQueue& FindOrAddQueue(UBhopCharacterMovementComponent* Movement);
+
+	/** The queues stay around between frames (sorted by SortKey) so their move arrays keep their allocations */
+	TArray<FServerMoveQueue> Queues;
+
+	int32 NumQueuedMoves = 0;
+};
@@ -19,6 +19,14 @@ public class Sandbox : ModuleRules
 			"GameplayAbilities",
 			"GameplayTags",
 			"GameplayTasks",
+			"ReplicationGraph",
+			"NetCore",
+			"AIModule",
+			"NavigationSystem",
 		});
+
+		// Cameras, the hud, animation updates, audio and the debug printing are compiled out of the dedicated server (SandboxServer.Target.cs)
+		// The properties and subobjects stay either way so the layout is the same on every target (the cooked blueprints come from the editor), only the code that sets up or updates them is guarded
+		PublicDefinitions.Add("SANDBOX_WITH_COSMETICS=" + (Target.Type == TargetType.Server ? "0" : "1"));
 	}
 }
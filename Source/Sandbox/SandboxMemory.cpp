@@ -0,0 +1,203 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxMemory.h"
+#include "Serialization/ArchiveCountMem.h"
+#include "HAL/IConsoleManager.h"
+#include "CoreGlobals.h"
+#include "EngineUtils.h"
+#include "Engine/World.h"
+#include "Components/SkeletalMeshComponent.h"
+#include "Animation/AnimInstance.h"
+#include "AbilitySystemComponent.h"
+#include "AttributeSet.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacter.h"
+#include "Sandbox/Characters/BhopProto/BhopCharacterMovementComponent.h"
+#include "Sandbox/Characters/BaseConfiguration/BaseCharacterConfiguration.h"
+#include "Sandbox/Characters/BaseConfiguration/CMCBaseConfiguration.h"
+#include "Sandbox/Characters/ProtoCharacter/ProtoCharacter.h"
+
+
+LLM_DEFINE_TAG(Sandbox_Movement);
+LLM_DEFINE_TAG(Sandbox_SavedMoves);
+LLM_DEFINE_TAG(Sandbox_Abilities);
+LLM_DEFINE_TAG(Sandbox_HUD);
+LLM_DEFINE_TAG(Sandbox_Animation);
+
+
+#pragma region Character Memory
+FSandboxCharacterMemory& FSandboxCharacterMemory::operator+=(const FSandboxCharacterMemory& Other)
+{
+	Actor += Other.Actor;
+	Movement += Other.Movement;
+	SavedMoves += Other.SavedMoves;
+	Abilities += Other.Abilities;
+	Animation += Other.Animation;
+	Components += Other.Components;
+	return *this;
+}
+
+
+namespace SandboxMemory
+{
+	SIZE_T GetObjectSize(const UObject* Object)
+	{
+		if (!Object) return 0;
+		FArchiveCountMem CountMem(const_cast<UObject*>(Object));
+		return CountMem.GetMax() + Object->GetResourceSizeBytes(EResourceSizeMode::Exclusive);
+	}
+
+
+	/** The saved moves of the client prediction data (the arena if it's one of ours, the move arrays either way) */
+	static SIZE_T GetSavedMovesSize(const UCharacterMovementComponent* Movement)
+	{
+		if (!Movement || !Movement->HasPredictionData_Client()) return 0;
+
+		const FNetworkPredictionData_Client_Character* ClientData = Movement->GetPredictionData_Client_Character();
+		SIZE_T Size = ClientData->SavedMoves.GetAllocatedSize() + ClientData->FreeMoves.GetAllocatedSize();
+		if (Cast<UBhopCharacterMovementComponent>(Movement))
+		{
+			Size += sizeof(UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter);
+			Size += static_cast<const UBhopCharacterMovementComponent::FNetworkPredictionData_Client_BhopCharacter*>(ClientData)->GetMoveArena().GetAllocatedSize();
+		}
+		else if (Cast<UCMCBaseConfiguration>(Movement))
+		{
+			Size += sizeof(UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character);
+			Size += static_cast<const UCMCBaseConfiguration::CMCB_FNetworkPredictionData_Client_Character*>(ClientData)->GetMoveArena().GetAllocatedSize();
+		}
+		else
+		{
+			Size += sizeof(FNetworkPredictionData_Client_Character) + ClientData->SavedMoves.Num() * sizeof(FSavedMove_Character);
+		}
+		return Size;
+	}
+
+
+	FSandboxCharacterMemory GetCharacterMemory(const ACharacter* Character)
+	{
+		FSandboxCharacterMemory Memory;
+		if (!Character) return Memory;
+
+		Memory.Actor = GetObjectSize(Character);
+
+		const UCharacterMovementComponent* Movement = Character->GetCharacterMovement();
+		Memory.Movement = GetObjectSize(Movement);
+		if (Movement && Movement->HasPredictionData_Server()) Memory.Movement += sizeof(FNetworkPredictionData_Server_Character);
+		Memory.SavedMoves = GetSavedMovesSize(Movement);
+
+		const UAbilitySystemComponent* AbilitySystem = nullptr;
+		if (const AProtoCharacter* ProtoCharacter = Cast<AProtoCharacter>(Character))
+		{
+			AbilitySystem = ProtoCharacter->GetAbilitySystemComponent();
+			if (AbilitySystem)
+			{
+				Memory.Abilities = GetObjectSize(AbilitySystem);
+				for (const UAttributeSet* AttributeSet : AbilitySystem->GetSpawnedAttributes()) Memory.Abilities += GetObjectSize(AttributeSet);
+			}
+		}
+
+		const UAnimInstance* AnimInstance = Character->GetMesh() ? Character->GetMesh()->GetAnimInstance() : nullptr;
+		Memory.Animation = GetObjectSize(AnimInstance);
+
+		TInlineComponentArray<UActorComponent*> Components(Character);
+		for (const UActorComponent* Component : Components)
+		{
+			if (Component != Movement && Component != AbilitySystem) Memory.Components += GetObjectSize(Component);
+		}
+		return Memory;
+	}
+}
+#pragma endregion
+
+
+#pragma region Console
+namespace
+{
+	struct FCharacterMemoryTotals
+	{
+		int32 NumCharacters = 0;
+		FSandboxCharacterMemory Memory;
+	};
+
+
+	FString FormatCharacterMemory(const FSandboxCharacterMemory& Memory, int32 Divisor)
+	{
+		const double Scale = 1.0 / (1024.0 * FMath::Max(Divisor, 1));
+		return FString::Printf(TEXT("Total %.1f KB (Actor %.1f, Movement %.1f, SavedMoves %.1f, Abilities %.1f, Animation %.1f, Components %.1f)"),
+			Memory.GetTotal() * Scale, Memory.Actor * Scale, Memory.Movement * Scale, Memory.SavedMoves * Scale, Memory.Abilities * Scale, Memory.Animation * Scale, Memory.Components * Scale);
+	}
+}
+
+
+static FAutoConsoleCommand CharacterMemReportCommand(
+	TEXT("Sandbox.MemReport.Characters"),
+	TEXT("Prints the memory each bhop, base configuration and proto character owns, and the average per class. Usage: Sandbox.MemReport.Characters [Verbose]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World) return;
+		const bool bVerbose = Args.Num() > 0 && Args[0] == TEXT("Verbose");
+
+		// The most derived class first, proto characters are base configuration characters as well
+		FCharacterMemoryTotals BhopTotals, BaseTotals, ProtoTotals;
+		for (TActorIterator<ACharacter> It(World); It; ++It)
+		{
+			ACharacter* Character = *It;
+			FCharacterMemoryTotals* Totals = nullptr;
+			if (Cast<AProtoCharacter>(Character)) Totals = &ProtoTotals;
+			else if (Cast<ABaseCharacterConfiguration>(Character)) Totals = &BaseTotals;
+			else if (Cast<ABhopCharacter>(Character)) Totals = &BhopTotals;
+			if (!Totals) continue;
+
+			const FSandboxCharacterMemory Memory = SandboxMemory::GetCharacterMemory(Character);
+			Totals->NumCharacters++;
+			Totals->Memory += Memory;
+			if (bVerbose) UE_LOG(LogTemp, Log, TEXT("Sandbox.MemReport.Characters: %s (%s): %s"), *GetNameSafe(Character), *UEnum::GetValueAsString(Character->GetLocalRole()), *FormatCharacterMemory(Memory, 1));
+		}
+
+		const TPair<const TCHAR*, const FCharacterMemoryTotals*> Classes[] = { { TEXT("BhopCharacter"), &BhopTotals }, { TEXT("BaseCharacterConfiguration"), &BaseTotals }, { TEXT("ProtoCharacter"), &ProtoTotals } };
+		FSandboxCharacterMemory AllMemory;
+		for (const TPair<const TCHAR*, const FCharacterMemoryTotals*>& Class : Classes)
+		{
+			AllMemory += Class.Value->Memory;
+			if (Class.Value->NumCharacters == 0) continue;
+			UE_LOG(LogTemp, Log, TEXT("Sandbox.MemReport.Characters: %d %s, per character: %s"), Class.Value->NumCharacters, Class.Key, *FormatCharacterMemory(Class.Value->Memory, Class.Value->NumCharacters));
+		}
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.MemReport.Characters: All characters: %s"), *FormatCharacterMemory(AllMemory, 1));
+	})
+);
+
+
+static FAutoConsoleCommand ServerMemReportCommand(
+	TEXT("Sandbox.MemReport.Server"),
+	TEXT("Prints the time from the process starting to the world ticking, and the memory of freshly spawned bhop characters (they're destroyed right after). Usage: Sandbox.MemReport.Server [Characters=16]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		if (!World) return;
+		const int32 NumCharacters = Args.Num() > 0 ? FMath::Clamp(FCString::Atoi(*Args[0]), 1, 1024) : 16;
+
+		// The world's real time only counts from its first tick, so what's left of the process time is the startup (engine init, the map load, and BeginPlay)
+		const double ProcessSeconds = FPlatformTime::Seconds() - GStartTime;
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.MemReport.Server: %s, %.2f s from the process starting to the world ticking"),
+			SANDBOX_WITH_COSMETICS ? TEXT("With cosmetics") : TEXT("Without cosmetics"), ProcessSeconds - World->GetRealTimeSeconds());
+
+		// Spawned high above the level, so they don't land on anything
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+		SpawnParams.ObjectFlags |= RF_Transient;
+		FCharacterMemoryTotals Totals;
+		TArray<ABhopCharacter*> Characters;
+		for (int32 Index = 0; Index < NumCharacters; Index++)
+		{
+			ABhopCharacter* Character = World->SpawnActor<ABhopCharacter>(ABhopCharacter::StaticClass(), FVector(Index * 200.f, 0.f, 1000000.f), FRotator::ZeroRotator, SpawnParams);
+			if (!Character) continue;
+			Totals.NumCharacters++;
+			Totals.Memory += SandboxMemory::GetCharacterMemory(Character);
+			Characters.Add(Character);
+		}
+		for (ABhopCharacter* Character : Characters) Character->Destroy();
+
+		if (Totals.NumCharacters == 0) return;
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.MemReport.Server: %d BhopCharacters, per character: %s"), Totals.NumCharacters, *FormatCharacterMemory(Totals.Memory, Totals.NumCharacters));
+	})
+);
+#pragma endregion
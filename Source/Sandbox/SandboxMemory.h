@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "HAL/LowLevelMemTracker.h"
+
+
+/*
+	Memory tracking
+
+	The low level memory tracker tags for the module, run with -llm (and "stat LLMFULL", or -llmcsv for a csv of every tag over time) to see them:
+		- Sandbox/Movement		The movement components and everything they allocate while moving (proxy snapshots, queued server moves)
+		- Sandbox/SavedMoves	The client prediction data and its saved move arena
+		- Sandbox/Abilities		The ability system components and attribute sets
+		- Sandbox/HUD			The hud widgets
+		- Sandbox/Animation		The anim instances
+
+	The tags only see the allocations made inside their scopes, the objects the engine creates for us (the components themselves) are under the engine's UObject tag.
+	"Sandbox.MemReport.Characters [Verbose]" walks every character instead and adds up what each one owns, so it's the number to size servers with and to diff across a long session.
+
+	"Sandbox.MemReport.Server [Characters]" is for comparing builds (the SandboxServer target with the cosmetics compiled out, against the editor's -server):
+	it logs how long the process took to start ticking the world, then spawns bhop characters out of the way, logs what each one owns, and destroys them. Run it on both with the same map, e.g.
+		SandboxServer <Map> -log -ExecCmds="Sandbox.MemReport.Server 32"
+		UnrealEditor Sandbox.uproject <Map> -server -log -ExecCmds="Sandbox.MemReport.Server 32"
+*/
+
+
+LLM_DECLARE_TAG_API(Sandbox_Movement, SANDBOX_API);
+LLM_DECLARE_TAG_API(Sandbox_SavedMoves, SANDBOX_API);
+LLM_DECLARE_TAG_API(Sandbox_Abilities, SANDBOX_API);
+LLM_DECLARE_TAG_API(Sandbox_HUD, SANDBOX_API);
+LLM_DECLARE_TAG_API(Sandbox_Animation, SANDBOX_API);
+
+
+/** The memory a single character owns, in bytes */
+struct SANDBOX_API FSandboxCharacterMemory
+{
+	SIZE_T Actor = 0;			// The character itself
+	SIZE_T Movement = 0;		// The movement component and its server prediction data
+	SIZE_T SavedMoves = 0;		// The client prediction data and its saved moves
+	SIZE_T Abilities = 0;		// The ability system component and its attribute sets
+	SIZE_T Animation = 0;		// The mesh's anim instance
+	SIZE_T Components = 0;		// Every other component
+
+	SIZE_T GetTotal() const { return Actor + Movement + SavedMoves + Abilities + Animation + Components; }
+	FSandboxCharacterMemory& operator+=(const FSandboxCharacterMemory& Other);
+};
+
+
+namespace SandboxMemory
+{
+	/** The bytes an object owns, the same number "obj list" shows plus its exclusive resource size */
+	SANDBOX_API SIZE_T GetObjectSize(const UObject* Object);
+
+	/** Adds up everything a character owns */
+	SANDBOX_API FSandboxCharacterMemory GetCharacterMemory(const class ACharacter* Character);
+}
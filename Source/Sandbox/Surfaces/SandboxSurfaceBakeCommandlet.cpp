@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxSurfaceBakeCommandlet.h"
+#include "SandboxSurfaceGrid.h"
+#include "Misc/FileHelper.h"
+#include "Engine/World.h"
+#include "EngineUtils.h"
+#include "GameFramework/Pawn.h"
+#include "Components/PrimitiveComponent.h"
+#include "CollisionQueryParams.h"
+
+
+USandboxSurfaceBakeCommandlet::USandboxSurfaceBakeCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+
+#if WITH_EDITOR
+namespace
+{
+	/** Only static geometry is baked, anything that can move (or any pawn) is marked Fallback so it still gets traced */
+	bool IsStaticSurface(const UPrimitiveComponent* Component)
+	{
+		return Component && Component->Mobility == EComponentMobility::Static && !Cast<APawn>(Component->GetOwner());
+	}
+
+
+	bool TraceDown(UWorld* World, const FVector& Start, float EndZ, FHitResult& OutHit)
+	{
+		FCollisionQueryParams CollisionParams(SCENE_QUERY_STAT(SandboxSurfaceBake), true);
+		return World->LineTraceSingleByChannel(OutHit, Start, FVector(Start.X, Start.Y, EndZ), ECollisionChannel::ECC_Visibility, CollisionParams);
+	}
+}
+#endif
+
+
+int32 USandboxSurfaceBakeCommandlet::Main(const FString& Params)
+{
+#if WITH_EDITOR
+	FString MapName;
+	if (!FParse::Value(*Params, TEXT("Map="), MapName))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SandboxSurfaceBake: Usage: -run=SandboxSurfaceBake -Map=<LongPackageName> [-CellSize=50] [-MaxLayers=4] [-HeightStep=2] [-LayerGap=100]"));
+		return 1;
+	}
+
+	float CellSize = 50.f;
+	int32 MaxLayers = 4;
+	float HeightStep = 2.f;
+	float LayerGap = 100.f; // Surfaces closer than this under each other can't both be stood on, so only the top one is kept
+	FParse::Value(*Params, TEXT("CellSize="), CellSize);
+	FParse::Value(*Params, TEXT("MaxLayers="), MaxLayers);
+	FParse::Value(*Params, TEXT("HeightStep="), HeightStep);
+	FParse::Value(*Params, TEXT("LayerGap="), LayerGap);
+	CellSize = FMath::Max(CellSize, 1.f);
+	MaxLayers = FMath::Clamp(MaxLayers, 1, 16);
+	LayerGap = FMath::Max(LayerGap, 1.f);
+
+	// Load the level and get its collision ready for traces
+	UPackage* Package = LoadPackage(nullptr, *MapName, LOAD_None);
+	UWorld* World = Package ? UWorld::FindWorldInPackage(Package) : nullptr;
+	if (!World)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SandboxSurfaceBake: Couldn't load the map %s"), *MapName);
+		return 1;
+	}
+
+	World->AddToRoot();
+	if (!World->bIsWorldInitialized)
+	{
+		World->InitWorld(UWorld::InitializationValues()
+			.AllowAudioPlayback(false)
+			.CreatePhysicsScene(true)
+			.RequiresHitProxies(false)
+			.CreateNavigation(false)
+			.CreateAISystem(false)
+			.ShouldSimulatePhysics(false)
+			.SetTransactional(false));
+	}
+	World->UpdateWorldComponents(true, false);
+
+	// The bounds of everything that blocks the RampCheck trace
+	FBox Bounds(ForceInit);
+	for (TActorIterator<AActor> It(World); It; ++It)
+	{
+		TInlineComponentArray<UPrimitiveComponent*> Components(*It);
+		for (const UPrimitiveComponent* Component : Components)
+		{
+			if (IsStaticSurface(Component) && Component->IsCollisionEnabled() && Component->GetCollisionResponseToChannel(ECC_Visibility) == ECR_Block)
+			{
+				Bounds += Component->Bounds.GetBox();
+			}
+		}
+	}
+	if (!Bounds.IsValid)
+	{
+		UE_LOG(LogTemp, Error, TEXT("SandboxSurfaceBake: %s doesn't have any static geometry to bake"), *MapName);
+		World->RemoveFromRoot();
+		return 1;
+	}
+
+	FBhopSurfaceGridHeader Header;
+	Header.OriginX = Bounds.Min.X;
+	Header.OriginY = Bounds.Min.Y;
+	Header.CellSize = CellSize;
+	Header.MinZ = Bounds.Min.Z;
+	Header.HeightStep = FMath::Max(HeightStep, (Bounds.Max.Z - Bounds.Min.Z) / MAX_int16); // The heights are int16, big levels get a coarser step
+	Header.SizeX = FMath::CeilToInt((Bounds.Max.X - Bounds.Min.X) / CellSize);
+	Header.SizeY = FMath::CeilToInt((Bounds.Max.Y - Bounds.Min.Y) / CellSize);
+	Header.MaxLayers = MaxLayers;
+
+	const int64 NumSamples = static_cast<int64>(Header.SizeX) * Header.SizeY * Header.MaxLayers;
+	if (NumSamples <= 0 || NumSamples > MAX_int32 / static_cast<int64>(sizeof(FBhopSurfaceSample)))
+	{
+		UE_LOG(LogTemp, Error, TEXT("SandboxSurfaceBake: %d x %d cells is too big, use a larger -CellSize"), Header.SizeX, Header.SizeY);
+		World->RemoveFromRoot();
+		return 1;
+	}
+
+	TArray<FBhopSurfaceSample> Samples;
+	Samples.SetNumZeroed(NumSamples);
+	const float TopZ = Bounds.Max.Z + 10.f;
+	const float BottomZ = Bounds.Min.Z - 10.f;
+	const float StepTolerance = Header.HeightStep * 2.f + 1.f;
+	int32 NumSurfaces = 0;
+	int32 NumFallbacks = 0;
+
+	for (int32 CellY = 0; CellY < Header.SizeY; CellY++)
+	{
+		for (int32 CellX = 0; CellX < Header.SizeX; CellX++)
+		{
+			const float CenterX = Header.OriginX + (CellX + 0.5f) * CellSize;
+			const float CenterY = Header.OriginY + (CellY + 0.5f) * CellSize;
+			FBhopSurfaceSample* Layers = &Samples[(static_cast<int64>(CellY) * Header.SizeX + CellX) * Header.MaxLayers];
+
+			// Trace down through the level, keeping a surface and skipping the next LayerGap units each time
+			float StartZ = TopZ;
+			for (int32 Layer = 0; Layer < MaxLayers && StartZ > BottomZ; Layer++)
+			{
+				FHitResult Hit;
+				if (!TraceDown(World, FVector(CenterX, CenterY, StartZ), BottomZ, Hit)) break;
+				StartZ = Hit.ImpactPoint.Z - LayerGap;
+				if (Hit.bStartPenetrating || Hit.ImpactNormal.Z <= 0.f)
+				{
+					Layer--;
+					continue;
+				}
+
+				const FVector Normal = Hit.ImpactNormal;
+				EBhopSurfaceFlags Flags = SandboxSurfaceGrid::ClassifyNormal(Normal);
+				bool bFallback = !IsStaticSurface(Hit.GetComponent());
+
+				// The corners have to be on the same plane, otherwise this cell has an edge or a step and the center's normal isn't the answer everywhere in it
+				for (int32 Corner = 0; Corner < 4 && !bFallback; Corner++)
+				{
+					const float OffsetX = (Corner & 1 ? 0.5f : -0.5f) * CellSize;
+					const float OffsetY = (Corner & 2 ? 0.5f : -0.5f) * CellSize;
+					const float ExpectedZ = Hit.ImpactPoint.Z - (Normal.X * OffsetX + Normal.Y * OffsetY) / Normal.Z;
+
+					FHitResult CornerHit;
+					const FVector CornerStart(CenterX + OffsetX, CenterY + OffsetY, ExpectedZ + CellSize);
+					bFallback = !TraceDown(World, CornerStart, ExpectedZ - CellSize, CornerHit)
+						|| !IsStaticSurface(CornerHit.GetComponent())
+						|| FMath::Abs(CornerHit.ImpactPoint.Z - ExpectedZ) > StepTolerance
+						|| FVector::DotProduct(CornerHit.ImpactNormal, Normal) < 0.999f;
+				}
+
+				if (bFallback)
+				{
+					Flags |= EBhopSurfaceFlags::Fallback;
+					NumFallbacks++;
+				}
+				Layers[Layer] = FBhopSurfaceSample::Make(Hit.ImpactPoint.Z, Header.MinZ, Header.HeightStep, Normal, Flags);
+				NumSurfaces++;
+			}
+		}
+	}
+
+	// Header and then the samples, the runtime maps this as is
+	TArray<uint8> Data;
+	Data.Append(reinterpret_cast<const uint8*>(&Header), sizeof(FBhopSurfaceGridHeader));
+	Data.Append(reinterpret_cast<const uint8*>(Samples.GetData()), Samples.Num() * sizeof(FBhopSurfaceSample));
+
+	const FString Filename = SandboxSurfaceGrid::GetGridFilename(MapName);
+	const bool bSaved = FFileHelper::SaveArrayToFile(Data, *Filename);
+	UE_LOG(LogTemp, Display, TEXT("SandboxSurfaceBake: %s %s (%d x %d cells, %d surfaces, %d fallbacks, %.1f KB)"),
+		bSaved ? TEXT("Wrote") : TEXT("Failed to write"), *Filename, Header.SizeX, Header.SizeY, NumSurfaces, NumFallbacks, Data.Num() / 1024.f);
+
+	World->RemoveFromRoot();
+	return bSaved ? 0 : 1;
+#else
+	UE_LOG(LogTemp, Error, TEXT("SandboxSurfaceBake: The surface grid can only be baked from the editor"));
+	return 1;
+#endif
+}
@@ -0,0 +1,25 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "SandboxSurfaceBakeCommandlet.generated.h"
+
+
+/**
+ * Bakes the surface classification grid of a level (see SandboxSurfaceGrid.h)
+ *		UnrealEditor-Cmd Sandbox.uproject -run=SandboxSurfaceBake -Map=<LongPackageName> [-CellSize=50] [-MaxLayers=4] [-HeightStep=2] [-LayerGap=100]
+ * 
+ * Only the persistent level's static geometry is baked, so sublevels (and world partition cells) that aren't loaded with the map are left out and just use traces
+ */
+UCLASS()
+class SANDBOX_API USandboxSurfaceBakeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+
+public:
+	USandboxSurfaceBakeCommandlet();
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,228 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SandboxSurfaceGrid.h"
+#include "HAL/PlatformFileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Misc/PackageName.h"
+#include "Math/RandomStream.h"
+#include "Engine/World.h"
+#include "CollisionQueryParams.h"
+
+
+#pragma region Samples
+FVector FBhopSurfaceSample::GetNormal() const
+{
+	const float X = NormalX / 127.f;
+	const float Y = NormalY / 127.f;
+	return FVector(X, Y, FMath::Sqrt(FMath::Max(1.f - X * X - Y * Y, 0.f)));
+}
+
+
+FBhopSurfaceSample FBhopSurfaceSample::Make(float Z, float MinZ, float HeightStep, const FVector& Normal, EBhopSurfaceFlags Flags)
+{
+	FBhopSurfaceSample Sample;
+	Sample.Height = static_cast<int16>(FMath::Clamp(FMath::RoundToInt((Z - MinZ) / HeightStep), 0, MAX_int16));
+	Sample.NormalX = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(Normal.X * 127.f), -127, 127));
+	Sample.NormalY = static_cast<int8>(FMath::Clamp(FMath::RoundToInt(Normal.Y * 127.f), -127, 127));
+	Sample.Flags = static_cast<uint8>(Flags);
+	return Sample;
+}
+
+
+namespace SandboxSurfaceGrid
+{
+	FString GetGridFilename(const FString& MapName)
+	{
+		return FPaths::ProjectContentDir() / TEXT("SurfaceGrids") / (FPackageName::GetShortName(MapName) + TEXT(".bsgrid"));
+	}
+
+
+	EBhopSurfaceFlags ClassifyNormal(const FVector& Normal)
+	{
+		// The same thresholds as RampCheck (more than 2 degrees) and ApplyTrimp (a dot product of 0.05 with the direction we're moving, at best the slope's sine)
+		EBhopSurfaceFlags Flags = EBhopSurfaceFlags::Valid;
+		const float SlopeSine = Normal.Size2D();
+		if (Normal.Z < FMath::Cos(FMath::DegreesToRadians(2.f))) Flags |= EBhopSurfaceFlags::Slope;
+		if (SlopeSine > 0.05f) Flags |= EBhopSurfaceFlags::Trimp;
+		return Flags;
+	}
+}
+#pragma endregion
+
+
+#pragma region Subsystem
+bool USandboxSurfaceGridSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const UWorld* World = Cast<UWorld>(Outer);
+	return World && World->IsGameWorld() && Super::ShouldCreateSubsystem(Outer);
+}
+
+
+void USandboxSurfaceGridSubsystem::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	// The grid is named after the persistent level (without the PIE prefix)
+	const FString MapName = UWorld::RemovePIEPrefix(InWorld.GetOutermost()->GetName());
+	const FString Filename = SandboxSurfaceGrid::GetGridFilename(MapName);
+	if (!LoadGrid(Filename))
+	{
+		UE_LOG(LogTemp, Log, TEXT("SurfaceGrid: No baked grid for %s, RampCheck will use traces"), *MapName);
+	}
+}
+
+
+void USandboxSurfaceGridSubsystem::Deinitialize()
+{
+	UnloadGrid();
+	Super::Deinitialize();
+}
+
+
+bool USandboxSurfaceGridSubsystem::LoadGrid(const FString& Filename)
+{
+	UnloadGrid();
+
+	const uint8* Data = nullptr;
+	int64 DataSize = 0;
+
+	// Map the file if we can, otherwise read the whole thing (the grid is small either way)
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	MappedFile.Reset(PlatformFile.OpenMapped(*Filename));
+	if (MappedFile.IsValid())
+	{
+		MappedRegion.Reset(MappedFile->MapRegion(0, MappedFile->GetFileSize()));
+		if (MappedRegion.IsValid())
+		{
+			Data = MappedRegion->GetMappedPtr();
+			DataSize = MappedRegion->GetMappedSize();
+		}
+	}
+	if (!Data)
+	{
+		MappedRegion.Reset();
+		MappedFile.Reset();
+		if (!FFileHelper::LoadFileToArray(LoadedData, *Filename, FILEREAD_Silent)) return false;
+		Data = LoadedData.GetData();
+		DataSize = LoadedData.Num();
+	}
+
+	// Make sure it's a grid we understand and that the samples are all there
+	const FBhopSurfaceGridHeader* FileHeader = reinterpret_cast<const FBhopSurfaceGridHeader*>(Data);
+	const bool bValidHeader = DataSize >= static_cast<int64>(sizeof(FBhopSurfaceGridHeader))
+		&& FileHeader->Magic == FBhopSurfaceGridHeader::ExpectedMagic
+		&& FileHeader->Version == FBhopSurfaceGridHeader::ExpectedVersion
+		&& FileHeader->SizeX > 0 && FileHeader->SizeY > 0 && FileHeader->MaxLayers > 0 && FileHeader->CellSize > 0.f;
+	const int64 NumSamples = bValidHeader ? static_cast<int64>(FileHeader->SizeX) * FileHeader->SizeY * FileHeader->MaxLayers : 0;
+	if (!bValidHeader || DataSize < static_cast<int64>(sizeof(FBhopSurfaceGridHeader)) + NumSamples * static_cast<int64>(sizeof(FBhopSurfaceSample)))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("SurfaceGrid: %s isn't a valid surface grid, rebake it with the SandboxSurfaceBake commandlet"), *Filename);
+		UnloadGrid();
+		return false;
+	}
+
+	Header = FileHeader;
+	Samples = reinterpret_cast<const FBhopSurfaceSample*>(Data + sizeof(FBhopSurfaceGridHeader));
+	UE_LOG(LogTemp, Log, TEXT("SurfaceGrid: Loaded %s (%d x %d cells, %d layers, %s)"), *Filename, Header->SizeX, Header->SizeY, Header->MaxLayers, MappedRegion.IsValid() ? TEXT("mapped") : TEXT("loaded"));
+	return true;
+}
+
+
+void USandboxSurfaceGridSubsystem::UnloadGrid()
+{
+	Header = nullptr;
+	Samples = nullptr;
+	MappedRegion.Reset();
+	MappedFile.Reset();
+	LoadedData.Empty();
+}
+
+
+bool USandboxSurfaceGridSubsystem::FindSurface(const FVector& Location, float MaxDistance, FVector& OutNormal, EBhopSurfaceFlags& OutFlags) const
+{
+	if (!Header) return false;
+
+	const int32 CellX = FMath::FloorToInt((Location.X - Header->OriginX) / Header->CellSize);
+	const int32 CellY = FMath::FloorToInt((Location.Y - Header->OriginY) / Header->CellSize);
+	if (CellX < 0 || CellY < 0 || CellX >= Header->SizeX || CellY >= Header->SizeY) return false;
+
+	// The first surface below us is the highest layer that isn't above us (the layers are sorted highest first)
+	const FBhopSurfaceSample* Layers = Samples + (static_cast<int64>(CellY) * Header->SizeX + CellX) * Header->MaxLayers;
+	for (int32 Layer = 0; Layer < Header->MaxLayers; Layer++)
+	{
+		const FBhopSurfaceSample& Sample = Layers[Layer];
+		if (!Sample.HasFlag(EBhopSurfaceFlags::Valid)) break;
+
+		const float SurfaceZ = Header->MinZ + Sample.Height * Header->HeightStep;
+		if (SurfaceZ > Location.Z) continue;
+		if (Location.Z - SurfaceZ > MaxDistance || Sample.HasFlag(EBhopSurfaceFlags::Fallback)) return false;
+
+		OutNormal = Sample.GetNormal();
+		OutFlags = static_cast<EBhopSurfaceFlags>(Sample.Flags);
+		return true;
+	}
+
+	return false;
+}
+#pragma endregion
+
+
+#pragma region Benchmark
+static FAutoConsoleCommand SurfaceGridBenchmarkCommand(
+	TEXT("Sandbox.SurfaceGrid.Benchmark"),
+	TEXT("Compares the surface grid lookups per second with the RampCheck traces per second over the baked surfaces of the current level. Usage: Sandbox.SurfaceGrid.Benchmark [Samples=100000]"),
+	FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+	{
+		const USandboxSurfaceGridSubsystem* SurfaceGrid = World ? World->GetSubsystem<USandboxSurfaceGridSubsystem>() : nullptr;
+		if (!SurfaceGrid || !SurfaceGrid->HasGrid())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Sandbox.SurfaceGrid.Benchmark: The current level doesn't have a baked surface grid"));
+			return;
+		}
+
+		// Standing height above random baked surfaces (the same 100 unit trace RampCheck does)
+		const int32 NumSamples = Args.Num() > 0 ? FMath::Max(FCString::Atoi(*Args[0]), 1) : 100000;
+		const FBhopSurfaceGridHeader& Header = *SurfaceGrid->GetHeader();
+		FRandomStream Stream(1337);
+		TArray<FVector> Locations;
+		Locations.Reserve(NumSamples);
+		for (int32 Attempt = 0; Locations.Num() < NumSamples && Attempt < NumSamples * 10; Attempt++)
+		{
+			const int32 CellX = Stream.RandRange(0, Header.SizeX - 1);
+			const int32 CellY = Stream.RandRange(0, Header.SizeY - 1);
+			const FBhopSurfaceSample& Sample = SurfaceGrid->GetSamples()[(static_cast<int64>(CellY) * Header.SizeX + CellX) * Header.MaxLayers];
+			if (!Sample.HasFlag(EBhopSurfaceFlags::Valid)) continue;
+
+			const FVector Location(Header.OriginX + (CellX + Stream.FRand()) * Header.CellSize, Header.OriginY + (CellY + Stream.FRand()) * Header.CellSize, Header.MinZ + Sample.Height * Header.HeightStep + 90.f);
+			Locations.Add(Location);
+		}
+		if (Locations.Num() == 0) return;
+
+		int32 NumHits = 0;
+		const uint64 LookupStart = FPlatformTime::Cycles64();
+		for (const FVector& Location : Locations)
+		{
+			FVector Normal;
+			EBhopSurfaceFlags Flags;
+			NumHits += SurfaceGrid->FindSurface(Location, 100.f, Normal, Flags) ? 1 : 0;
+		}
+		const double LookupSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - LookupStart);
+
+		int32 NumTraceHits = 0;
+		FCollisionQueryParams CollisionParams;
+		const uint64 TraceStart = FPlatformTime::Cycles64();
+		for (const FVector& Location : Locations)
+		{
+			FHitResult Hit;
+			NumTraceHits += World->LineTraceSingleByChannel(Hit, Location, Location - FVector(0.f, 0.f, 100.f), ECollisionChannel::ECC_Visibility, CollisionParams) ? 1 : 0;
+		}
+		const double TraceSeconds = FPlatformTime::ToSeconds64(FPlatformTime::Cycles64() - TraceStart);
+
+		UE_LOG(LogTemp, Log, TEXT("Sandbox.SurfaceGrid.Benchmark: %d samples. Lookups: %.0f/s (%d answered, the rest fall back to traces), Traces: %.0f/s (%d hits)"),
+			Locations.Num(), LookupSeconds > 0.0 ? Locations.Num() / LookupSeconds : 0.0, NumHits, TraceSeconds > 0.0 ? Locations.Num() / TraceSeconds : 0.0, NumTraceHits);
+	})
+);
+#pragma endregion
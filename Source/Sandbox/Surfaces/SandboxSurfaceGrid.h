@@ -0,0 +1,121 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Async/MappedFileHandle.h"
+#include "SandboxSurfaceGrid.generated.h"
+
+
+/*
+	Baked surface classification grid
+
+	RampCheck only needs the normal of the ground under the character, and for the static level geometry that never changes. The surface bake commandlet traces the level once
+	on a 2D grid and writes the surfaces under each cell to Content/SurfaceGrids/<Map>.bsgrid, so at runtime the normal is a couple of array lookups instead of a trace:
+		UnrealEditor-Cmd Sandbox.uproject -run=SandboxSurfaceBake -Map=/Game/Imports/Maps/bhopMap/Maps/movement_test [-CellSize=50] [-MaxLayers=4]
+
+	Each cell keeps up to MaxLayers surfaces (stacked floors, bridges, etc.) as a quantized height, a packed normal and a few flags. A layer is marked Fallback when the cell
+	isn't a single flat or sloped surface (an edge, a step, or a movable component), and those still use a trace. So does anything that isn't in the grid (moving platforms,
+	spawned actors, or a level that hasn't been baked), so the grid is only ever a shortcut for the answer the trace would've given.
+
+	The file is memory mapped where the platform supports it (and read into memory when it doesn't, like from a pak file). Rebake whenever the level geometry changes,
+	"Sandbox.SurfaceGrid.Benchmark" compares the lookups per second against the traces per second in the current level.
+*/
+
+
+/** Flags of a baked surface */
+enum class EBhopSurfaceFlags : uint8
+{
+	None		= 0,
+	Valid		= 1 << 0,	// There's a surface in this layer
+	Slope		= 1 << 1,	// Steeper than 2 degrees, a ramp slide candidate (RampCheck still checks the direction we're moving)
+	Trimp		= 1 << 2,	// Steep enough for the trimp impulse to do something
+	Fallback	= 1 << 3,	// Not a single surface (an edge, step, or movable component), use a trace
+};
+ENUM_CLASS_FLAGS(EBhopSurfaceFlags);
+
+
+/** A single baked surface, 6 bytes */
+struct FBhopSurfaceSample
+{
+	int16 Height = 0;		// (Z - MinZ) / HeightStep
+	int8 NormalX = 0;		// Normal x and y * 127, surfaces are only baked tracing down so the z is always positive
+	int8 NormalY = 0;
+	uint8 Flags = 0;		// EBhopSurfaceFlags
+	uint8 Padding = 0;
+
+	FORCEINLINE bool HasFlag(EBhopSurfaceFlags Flag) const { return (Flags & static_cast<uint8>(Flag)) != 0; }
+	FVector GetNormal() const;
+	static FBhopSurfaceSample Make(float Z, float MinZ, float HeightStep, const FVector& Normal, EBhopSurfaceFlags Flags);
+};
+static_assert(sizeof(FBhopSurfaceSample) == 6, "The surface grid file layout depends on the sample size");
+
+
+/** The start of a .bsgrid file, followed by SizeX * SizeY * MaxLayers samples (row major, layers highest first) */
+struct FBhopSurfaceGridHeader
+{
+	static constexpr uint32 ExpectedMagic = 0x52475342; // "BSGR"
+	static constexpr uint32 ExpectedVersion = 1;
+
+	uint32 Magic = ExpectedMagic;
+	uint32 Version = ExpectedVersion;
+	float OriginX = 0.f;	// The min corner of the grid
+	float OriginY = 0.f;
+	float CellSize = 50.f;
+	float MinZ = 0.f;
+	float HeightStep = 2.f;
+	int32 SizeX = 0;
+	int32 SizeY = 0;
+	int32 MaxLayers = 4;
+};
+
+
+namespace SandboxSurfaceGrid
+{
+	/** Content/SurfaceGrids/<ShortMapName>.bsgrid */
+	SANDBOX_API FString GetGridFilename(const FString& MapName);
+
+	/** The flags for a surface with this normal */
+	SANDBOX_API EBhopSurfaceFlags ClassifyNormal(const FVector& Normal);
+}
+
+
+/**
+ * Loads the baked surface grid of the current level and answers the ground normal lookups for RampCheck
+ */
+UCLASS()
+class SANDBOX_API USandboxSurfaceGridSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
+	virtual void Deinitialize() override;
+
+	/** Loads (or maps) a grid file, returns false if the file is missing or doesn't match the layout */
+	bool LoadGrid(const FString& Filename);
+	void UnloadGrid();
+	bool HasGrid() const { return Header != nullptr; }
+
+	/**
+	 * Finds the highest baked surface between Location and MaxDistance below it
+	 * Returns false if the caller has to trace instead (no grid, outside of the grid, no baked surface in range, or the surface is marked Fallback)
+	 */
+	bool FindSurface(const FVector& Location, float MaxDistance, FVector& OutNormal, EBhopSurfaceFlags& OutFlags) const;
+
+	const FBhopSurfaceGridHeader* GetHeader() const { return Header; }
+	const FBhopSurfaceSample* GetSamples() const { return Samples; }
+
+
+private:
+	// Either the mapped file or the loaded copy, Header and Samples point into whichever one we have
+	TUniquePtr<IMappedFileHandle> MappedFile;
+	TUniquePtr<IMappedFileRegion> MappedRegion;
+	TArray<uint8> LoadedData;
+
+	const FBhopSurfaceGridHeader* Header = nullptr;
+	const FBhopSurfaceSample* Samples = nullptr;
+};
@@ -0,0 +1,126 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Math/RandomStream.h"
+#include "Sandbox/Characters/BhopProto/BhopAccelerationKernel.h"
+
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	// The original math from ABhopCharacter::AccelerateGround and AccelerateAir (before the kernel), in double precision
+	FBhopAccelOutput ReferenceAccelerate(const FBhopAccelInput& Input, bool bAir, double& OutMaxAccelSpeed)
+	{
+		const FVector& InputDirection = Input.InputDirection;
+		const FVector& Velocity = Input.Velocity;
+		const double ProjectedVelocity = FVector::DotProduct(bAir ? Velocity : FVector(Velocity.X, Velocity.Y, 0.0), InputDirection);
+		const double InputSpeed = (InputDirection * Input.DefaultMaxWalkSpeed).Length();
+		const double MaxAccelSpeed = (bAir ? FMath::Clamp(InputSpeed, 0.0, static_cast<double>(BHOP_AIR_ACCEL_SPEED_CAP)) : InputSpeed) - ProjectedVelocity;
+		OutMaxAccelSpeed = MaxAccelSpeed;
+
+		FBhopAccelOutput Output;
+		if (MaxAccelSpeed > 0.0)
+		{
+			const double Accelspeed = FMath::Clamp(Input.FrameTime * InputSpeed * Input.Accelerate, 0.0, MaxAccelSpeed);
+			const FVector Impulse = InputDirection * Accelspeed;
+			const double Speed = bAir ? Impulse.Length() + Input.PrevVelocity.Length() : (Input.PrevVelocity + Impulse).Length();
+
+			Output.bApplyingAccel = true;
+			Output.CalcMaxSpeed = FMath::Clamp(Speed, static_cast<double>(Input.DefaultMaxWalkSpeed), static_cast<double>(Input.MaxSeaDemonSpeed));
+		}
+		return Output;
+	}
+
+
+	// Random inputs in the range the characters actually see
+	FBhopAccelInput MakeRandomInput(FRandomStream& Stream)
+	{
+		FBhopAccelInput Input;
+		Input.InputDirection = Stream.FRand() < 0.1f ? FVector::ZeroVector : (Stream.GetUnitVector() * FVector(1.f, 1.f, 0.f)).GetSafeNormal();
+		Input.Velocity = Stream.GetUnitVector() * Stream.FRandRange(0.f, 4000.f);
+		Input.PrevVelocity = Input.Velocity + Stream.GetUnitVector() * Stream.FRandRange(0.f, 50.f);
+		Input.FrameTime = Stream.FRandRange(1.f / 240.f, 1.f / 20.f);
+		Input.DefaultMaxWalkSpeed = 840.f;
+		Input.Accelerate = Stream.FRandRange(1.f, 100.f);
+		Input.MaxSeaDemonSpeed = 12069.f;
+		return Input;
+	}
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBhopAccelerationKernelTest, "Sandbox.Movement.AccelKernel", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBhopAccelerationKernelTest::RunTest(const FString& Parameters)
+{
+	FRandomStream Stream(1337);
+	for (int32 Index = 0; Index < 4096; Index++)
+	{
+		const FBhopAccelInput Input = MakeRandomInput(Stream);
+
+		for (const bool bAir : { false, true })
+		{
+			const FBhopAccelOutput Kernel = bAir ? BhopAccelKernel::AccelerateAir(Input) : BhopAccelKernel::AccelerateGround(Input);
+			double MaxAccelSpeed = 0.0;
+			const FBhopAccelOutput Reference = ReferenceAccelerate(Input, bAir, MaxAccelSpeed);
+			const TCHAR* Path = bAir ? TEXT("Air") : TEXT("Ground");
+
+			// Right on the edge of applying acceleration the float projection can round either way, the speed only has to match when both agree
+			if (Kernel.bApplyingAccel != Reference.bApplyingAccel)
+			{
+				if (!TestTrue(FString::Printf(TEXT("%s input %d only disagrees on applying acceleration at the edge"), Path, Index), FMath::IsNearlyZero(MaxAccelSpeed, 0.01))) return false;
+				continue;
+			}
+			if (!TestEqual(FString::Printf(TEXT("%s input %d max speed"), Path, Index), Kernel.CalcMaxSpeed, Reference.CalcMaxSpeed, 0.05f)) return false;
+		}
+	}
+
+	return true;
+}
+
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBhopAccelerationKernelBatchTest, "Sandbox.Movement.AccelKernelBatch", EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FBhopAccelerationKernelBatchTest::RunTest(const FString& Parameters)
+{
+	// An odd count so the last set of lanes is partly padding
+	FRandomStream Stream(7331);
+	FBhopAccelBatch Batch;
+	TArray<FBhopAccelInput> Inputs;
+	for (int32 Index = 0; Index < 4093; Index++)
+	{
+		Inputs.Add(MakeRandomInput(Stream));
+		Batch.Add(Inputs.Last());
+	}
+	TestEqual(TEXT("Batch size"), Batch.Num(), Inputs.Num());
+	TestEqual(TEXT("Batch padding"), Batch.NumPadded() % FBhopAccelBatch::LaneCount, 0);
+
+	for (const bool bAir : { false, true })
+	{
+		TArray<FBhopAccelOutput> Outputs;
+		if (bAir) BhopAccelKernel::AccelerateAirBatch(Batch, Outputs);
+		else BhopAccelKernel::AccelerateGroundBatch(Batch, Outputs);
+		const TCHAR* Path = bAir ? TEXT("Air") : TEXT("Ground");
+		if (!TestEqual(FString::Printf(TEXT("%s outputs"), Path), Outputs.Num(), Inputs.Num())) return false;
+
+		for (int32 Index = 0; Index < Inputs.Num(); Index++)
+		{
+			const FBhopAccelOutput Scalar = bAir ? BhopAccelKernel::AccelerateAir(Inputs[Index]) : BhopAccelKernel::AccelerateGround(Inputs[Index]);
+			double MaxAccelSpeed = 0.0;
+			ReferenceAccelerate(Inputs[Index], bAir, MaxAccelSpeed);
+
+			// The batch is single precision, so it can only disagree with the scalar path right on the edge of applying acceleration
+			if (Scalar.bApplyingAccel != Outputs[Index].bApplyingAccel)
+			{
+				if (!TestTrue(FString::Printf(TEXT("%s lane %d only disagrees on applying acceleration at the edge"), Path, Index), FMath::IsNearlyZero(MaxAccelSpeed, 0.01))) return false;
+				continue;
+			}
+			if (!TestEqual(FString::Printf(TEXT("%s lane %d max speed"), Path, Index), Outputs[Index].CalcMaxSpeed, Scalar.CalcMaxSpeed, 0.05f)) return false;
+		}
+	}
+
+	return true;
+}
+
+#endif